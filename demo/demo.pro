@@ -16,29 +16,48 @@ CONFIG += c++11
 SOURCES += main.cpp\
         mainwindow.cpp \
     ../tl_backgroundsubtractors/onlinebackgroundsubtractor.cpp \
+    ../tl_batch/batchjob.cpp \
+    ../tl_batch/batchrunner.cpp \
+    ../tl_batch/sweep.cpp \
     ../tl_core/backgroundsubtractor.cpp \
     ../tl_core/detector.cpp \
     ../tl_core/filter.cpp \
+    ../tl_core/framecontext.cpp \
     ../tl_core/tracker.cpp \
     ../tl_detectors/meanshiftdetector.cpp \
     ../tl_detectors/nodetector.cpp \
     ../tl_detectors/templatematchingdetector.cpp \
+    ../tl_evaluation/evaluation.cpp \
+    ../tl_filters/constantvelocityfilter.cpp \
     ../tl_filters/kalmanfilter.cpp \
     ../tl_gpu/templatematchingdetectorgpu.cpp \
+    ../tl_trackers/dataassociation.cpp \
+    ../tl_util/bitmask.cpp \
+    ../tl_util/blobextractor.cpp \
     ../tl_util/color.cpp \
     ../tl_util/conversions.cpp \
+    ../tl_util/framecache.cpp \
+    ../tl_util/framering.cpp \
     ../tl_util/geometry.cpp \
+    ../tl_util/integralimages.cpp \
+    ../tl_util/matpool.cpp \
+    ../tl_util/multitemplatematcher.cpp \
+    ../tl_util/snapshot.cpp \
+    ../tl_util/spatialindex.cpp \
     abstractplayer.cpp \
     exportdialog.cpp \
     frameplayer.cpp \
     param.cpp \
     project.cpp \
+    projectfile.cpp \
     projectinfowidget.cpp \
     projectwidget.cpp \
     recentproject.cpp \
+    resultsexporter.cpp \
     sourceform.cpp \
     trackingtask.cpp \
     trackingtaskdialog.cpp \
+    trackstore.cpp \
     videoplayer.cpp \
     welcomewidget.cpp
 
@@ -46,29 +65,48 @@ HEADERS  += mainwindow.h \
     ../common.h \
     ../tracklib.h \
     ../tl_backgroundsubtractors/onlinebackgroundsubtractor.h \
+    ../tl_batch/batchjob.h \
+    ../tl_batch/batchrunner.h \
+    ../tl_batch/sweep.h \
     ../tl_core/backgroundsubtractor.h \
     ../tl_core/detector.h \
     ../tl_core/filter.h \
+    ../tl_core/framecontext.h \
     ../tl_core/tracker.h \
     ../tl_detectors/meanshiftdetector.h \
     ../tl_detectors/nodetector.h \
     ../tl_detectors/templatematchingdetector.h \
+    ../tl_evaluation/evaluation.h \
+    ../tl_filters/constantvelocityfilter.h \
     ../tl_filters/kalmanfilter.h \
     ../tl_gpu/templatematchingdetectorgpu.h \
+    ../tl_trackers/dataassociation.h \
+    ../tl_util/bitmask.h \
+    ../tl_util/blobextractor.h \
     ../tl_util/color.h \
     ../tl_util/conversions.h \
+    ../tl_util/framecache.h \
+    ../tl_util/framering.h \
     ../tl_util/geometry.h \
+    ../tl_util/integralimages.h \
+    ../tl_util/matpool.h \
+    ../tl_util/multitemplatematcher.h \
+    ../tl_util/snapshot.h \
+    ../tl_util/spatialindex.h \
     abstractplayer.h \
     exportdialog.h \
     frameplayer.h \
     param.h \
     project.h \
+    projectfile.h \
     projectinfowidget.h \
     projectwidget.h \
     recentproject.h \
+    resultsexporter.h \
     sourceform.h \
     trackingtask.h \
     trackingtaskdialog.h \
+    trackstore.h \
     videoplayer.h \
     welcomewidget.h
 
@@ -3,19 +3,21 @@
 #include "exportdialog.h"
 #include "ui_exportdialog.h"
 
-#include <QFile>
+#include <QCloseEvent>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QStandardPaths>
 #include <QString>
-#include <QTextStream>
+
+#include "resultsexporter.h"
 
 namespace Multitrack {
 
-ExportDialog::ExportDialog(QWidget *parent, const QVector<QRect>& results) :
+ExportDialog::ExportDialog(QWidget *parent,
+                           const QVector<TrackingTask *> &tasks, int selected) :
   QDialog(parent),
   ui(new Ui::ExportDialog),
-  results_(results) {
+  tasks_(tasks), selected_(selected), thread_export_(nullptr) {
   ui->setupUi(this);
 
   setFixedSize(size());
@@ -35,68 +37,90 @@ ExportDialog::~ExportDialog() {
 }
 
 void ExportDialog::accept() {
-  QString filename = QFileDialog::getSaveFileName(
+  if (thread_export_ != nullptr) return;  // Export already running.
+
+  filename_ = QFileDialog::getSaveFileName(
       this, "Export to file...",
       QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation));
+  if (filename_.isEmpty()) return;
+
+  QString frame_sep;
+  QString element_sep;
+  if (ui->radioButtonFrameChar->isChecked()) {
+    frame_sep = ui->comboBoxFrameSep->currentText();
+  } else if (ui->radioButtonFrameSpace->isChecked()) {
+    frame_sep = " ";
+  } else if (ui->radioButtonFrameLine->isChecked()) {
+    frame_sep = "\n";
+  }
+  if (ui->radioButtonElementChar->isChecked()) {
+    element_sep = ui->comboBoxElementSep->currentText();
+  } else if (ui->radioButtonElementSpace->isChecked()) {
+    element_sep = " ";
+  } else if (ui->radioButtonElementLine->isChecked()) {
+    element_sep = "\n";
+  }
 
-  if (!filename.isEmpty()) {
-    QFile file(filename);
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-      QTextStream file_stream(&file);
-
-      QString frame_sep;
-      QString element_sep;
-      if (ui->radioButtonFrameChar->isChecked()) {
-        frame_sep = ui->comboBoxFrameSep->currentText();
-      } else if (ui->radioButtonFrameSpace->isChecked()) {
-        frame_sep = " ";
-      } else if (ui->radioButtonFrameLine->isChecked()) {
-        frame_sep = "\n";
-      }
-      if (ui->radioButtonElementChar->isChecked()) {
-        element_sep = ui->comboBoxElementSep->currentText();
-      } else if (ui->radioButtonElementSpace->isChecked()) {
-        element_sep = " ";
-      } else if (ui->radioButtonElementLine->isChecked()) {
-        element_sep = "\n";
-      }
-
-      bool first = true;
-      for (const QRect &rect : results_) {
-        if (first) first = false;
-        else file_stream << frame_sep;
-
-        if (ui->comboBoxFormat->currentIndex() == 0) {
-          // Center, Width, Height.
-          file_stream << rect.center().x() << element_sep <<
-                         rect.center().y() << element_sep <<
-                         rect.width() << element_sep <<
-                         rect.height();
-        } else if (ui->comboBoxFormat->currentIndex() == 1) {
-          // TopLeft, BottomRight.
-          file_stream << rect.topLeft().x() << element_sep <<
-                         rect.topLeft().y() << element_sep <<
-                         rect.bottomRight().x() << element_sep <<
-                         rect.bottomRight().y();
-        } else if (ui->comboBoxFormat->currentIndex() == 2) {
-          // TopLeft, Width, Height.
-          file_stream << rect.topLeft().x() << element_sep <<
-                         rect.topLeft().y() << element_sep <<
-                         rect.width() << element_sep <<
-                         rect.height();
-        }
-      }
-
-      file.close();
-      QMessageBox::information(this, "", "Results exported to " + filename +
-                                         ".");
-      QDialog::accept();
-    } else {
-      QMessageBox::critical(this, "Error", "Could not open " + filename +
-                                           " for writing.");
-      return;
+  ResultsExporter *exporter = new ResultsExporter(
+      filename_,
+      static_cast<ResultsExporter::Format>(ui->comboBoxFormat->currentIndex()));
+  exporter->set_separators(frame_sep, element_sep);
+  for (int i = 0; i < tasks_.count(); ++i) {
+    const TrackingTask *task = tasks_.at(i);
+    if ((ui->checkBoxAllTasks->isChecked() || i == selected_) &&
+        task->completed()) {
+      exporter->AddTask(static_cast<int>(task->uid()), task->first_frame(),
+                        task->results());
     }
   }
+
+  // Write the file in a worker thread.
+  thread_export_ = new QThread;
+  exporter->moveToThread(thread_export_);
+  connect(exporter, SIGNAL(Progress(int)), ui->progressBar, SLOT(setValue(int)),
+          Qt::QueuedConnection);
+  connect(exporter, SIGNAL(Finished()), this, SLOT(OnExportFinished()),
+          Qt::QueuedConnection);
+  connect(exporter, SIGNAL(Failed(QString)), this, SLOT(OnExportFailed(QString)),
+          Qt::QueuedConnection);
+  connect(thread_export_, SIGNAL(finished()), exporter, SLOT(deleteLater()));
+  connect(thread_export_, SIGNAL(finished()),
+          thread_export_, SLOT(deleteLater()));
+  thread_export_->start();
+
+  ui->buttonBox->setEnabled(false);
+  QMetaObject::invokeMethod(exporter, "Run", Qt::QueuedConnection);
+}
+
+void ExportDialog::OnExportFinished() {
+  thread_export_->quit();
+  thread_export_ = nullptr;
+  ui->buttonBox->setEnabled(true);
+  QMessageBox::information(this, "", "Results exported to " + filename_ + ".");
+  QDialog::accept();
+}
+
+void ExportDialog::OnExportFailed(const QString &error) {
+  thread_export_->quit();
+  thread_export_ = nullptr;
+  ui->buttonBox->setEnabled(true);
+  ui->progressBar->setValue(0);
+  QMessageBox::critical(this, "Error", error);
+}
+
+// The export thread is only stopped by the end of the export: the dialog
+// stays open until then.
+void ExportDialog::reject() {
+  if (thread_export_ != nullptr) return;
+  QDialog::reject();
+}
+
+void ExportDialog::closeEvent(QCloseEvent *event) {
+  if (thread_export_ != nullptr) {
+    event->ignore();
+    return;
+  }
+  QDialog::closeEvent(event);
 }
 
 bool ExportDialog::eventFilter(QObject *object, QEvent *event) {
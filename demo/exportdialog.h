@@ -4,9 +4,12 @@
 #define MULTITRACK_EXPORTDIALOG_H
 
 #include <QDialog>
-#include <QRect>
+#include <QString>
+#include <QThread>
 #include <QVector>
 
+#include "trackingtask.h"
+
 namespace Ui {
 class ExportDialog;
 }
@@ -17,15 +20,27 @@ class ExportDialog : public QDialog {
   Q_OBJECT
 
 public:
-  explicit ExportDialog(QWidget *parent, const QVector<QRect> &results);
+  // selected is the index of the task exported unless all tasks are.
+  explicit ExportDialog(QWidget *parent, const QVector<TrackingTask *> &tasks,
+                        int selected);
   ~ExportDialog();
 
+private slots:
+  void OnExportFinished();
+  void OnExportFailed(const QString &error);
+
 private:
   void accept();
+  // Ignored while an export is running.
+  void reject();
+  void closeEvent(QCloseEvent *event);
   bool eventFilter(QObject *object, QEvent *event);
 
   Ui::ExportDialog *ui;
-  const QVector<QRect> &results_;
+  const QVector<TrackingTask *> &tasks_;
+  int selected_;
+  QString filename_;
+  QThread *thread_export_;
 };
 
 }  // namespace Multitrack
@@ -20,7 +20,6 @@
 //     * Use one thread per pending task to allow several tasks to run at the
 //       same time
 //     * Allow to edit non-pending tasks even when some tasks are pending
-//     * Allow to cancel a running task
 //     * Measure running time of a task
 //   - Projects:
 //     * Allow to duplicate projects
@@ -109,13 +109,10 @@ void MainWindow::OpenProject() {
 
 void MainWindow::OpenProject(const QString &filename) {
   if (!is_project_open_ || project_widget_->Close()) {
-    QFile file(filename);
-    if (!file.open(QIODevice::ReadOnly)) {
-      QMessageBox::critical(this, "Error", "Could not open file " + filename);
+    QString error;
+    if (!project_->Load(filename, &error)) {
+      QMessageBox::critical(this, "Error", error);
     } else {
-      QDataStream ds(&file);
-      ds >> *project_;
-      file.close();
       ViewProject(filename, true);
 
       // Update recent projects.
@@ -72,6 +72,21 @@ bool Param::GetB() const {
   return b_;
 }
 
+bool Param::operator==(const Param &other) const {
+  if (type_ != other.type_) return false;
+  switch (type_) {
+    case Param::kString: return s_ == other.s_;
+    case Param::kFloat: return f_ == other.f_;
+    case Param::kInt: return i_ == other.i_;
+    case Param::kBool: return b_ == other.b_;
+  }
+  return false;
+}
+
+bool Param::operator!=(const Param &other) const {
+  return !(*this == other);
+}
+
 QDataStream &operator<<(QDataStream &out, const Param &p) {
   if (p.type_ == Param::kString) {
     out << 0 << p.s_;
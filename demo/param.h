@@ -26,6 +26,9 @@ public:
   int GetI() const;
   bool GetB() const;
 
+  // Same type and value.
+  bool operator==(const Param &other) const;
+  bool operator!=(const Param &other) const;
 
 private:
   enum {
@@ -9,7 +9,8 @@
 
 namespace Multitrack {
 
-Project::Project() {
+Project::Project() :
+  last_uid_(0) {
 }
 
 const QString &Project::name() const {
@@ -117,17 +118,12 @@ bool Project::IsValid(QString *error) const {
   return true;
 }
 
-QDataStream &operator<<(QDataStream &out, const Project &p) {
-  int c = (p.source_type_ == Project::kSourceTypeVideo) ? 1 : 2;
-  out << p.name_ << quint32(c) << p.video_path_ <<
-         quint32(p.first_frame_) << quint32(p.last_frame_) << p.frame_paths_ <<
-         p.fps_;
-
-  out << p.tasks_.count();
-  for (const TrackingTask *task : p.tasks_)
-    out << task;
+bool Project::Load(const QString &path, QString *error) {
+  return file_.Load(path, this, error);
+}
 
-  return out;
+bool Project::Save(const QString &path, QString *error) {
+  return file_.Save(path, this, error);
 }
 
 QDataStream &operator>>(QDataStream &in, Project &p) {
@@ -137,10 +133,11 @@ QDataStream &operator>>(QDataStream &in, Project &p) {
 
   int n = 0;
   in >> n;
-  p.tasks_.resize(n);
+  p.clear_tasks();
   for (int i = 0; i < n; ++i) {
-    p.tasks_[i] = new TrackingTask;
-    in >> p.tasks_[i];
+    TrackingTask *task = new TrackingTask;
+    task->ReadLegacy(in);
+    p.add_tracking_task(task);
   }
 
   p.source_type_ = (c == 1) ? Project::kSourceTypeVideo :
@@ -150,6 +147,8 @@ QDataStream &operator>>(QDataStream &in, Project &p) {
 }
 
 void Project::add_tracking_task(TrackingTask *task) {
+  if (task->uid() == 0) task->set_uid(last_uid_ + 1);
+  last_uid_ = qMax(last_uid_, task->uid());
   tasks_.push_back(task);
 }
 
@@ -10,6 +10,7 @@
 #include <QStringList>
 #include <QVector>
 
+#include "projectfile.h"
 #include "trackingtask.h"
 
 namespace Multitrack {
@@ -47,6 +48,11 @@ public:
 
   bool IsValid(QString *error) const;
 
+  // Read from and write to a project file. Return false and set error on
+  // failure.
+  bool Load(const QString &path, QString *error);
+  bool Save(const QString &path, QString *error);
+
 private:
   QString name_;
   SourceType source_type_;
@@ -61,11 +67,12 @@ private:
   float fps_;
 
   QVector<TrackingTask *> tasks_;
+  quint32 last_uid_;  // Largest task uid given so far.
 
+  ProjectFile file_;
 
 public:
-  // Serialization.
-  friend QDataStream &operator<<(QDataStream &out, const Project &p);
+  // Read a project in the former single-stream format.
   friend QDataStream &operator>>(QDataStream &in, Project &p);
 };
 
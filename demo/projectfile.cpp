@@ -0,0 +1,405 @@
+// projectfile.cpp
+
+#include "projectfile.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QVector>
+
+#ifdef Q_OS_UNIX
+# include <unistd.h>
+#endif
+
+#include "project.h"
+#include "trackingtask.h"
+
+namespace Multitrack {
+
+namespace {
+
+const quint32 kMagic = 0x4D545046;  // "MTPF".
+const quint32 kVersion = 1;
+
+// Header: magic, version and two commit slots, padded to kHeaderSize.
+const int kSlotSize = 24;
+const qint64 kSlotOffsets[2] = {8, 8 + kSlotSize};
+const int kHeaderSize = 64;
+
+// Files smaller than this are never compacted.
+const qint64 kMinCompactionSize = 1 << 20;
+
+// Commit slot: sequence number and location of the directory.
+struct Slot {
+  quint64 sequence;
+  quint64 directory_offset;
+  quint32 directory_size;
+  quint16 directory_checksum;
+};
+
+QByteArray EncodeSlot(const Slot &slot) {
+  QByteArray bytes;
+  QDataStream ds(&bytes, QIODevice::WriteOnly);
+  ds << slot.sequence << slot.directory_offset << slot.directory_size <<
+        slot.directory_checksum;
+  ds << qChecksum(bytes.constData(), bytes.size());
+  return bytes;
+}
+
+bool DecodeSlot(const QByteArray &bytes, Slot *slot) {
+  if (bytes.size() != kSlotSize) return false;
+  QDataStream ds(bytes);
+  quint16 checksum = 0;
+  ds >> slot->sequence >> slot->directory_offset >> slot->directory_size >>
+        slot->directory_checksum >> checksum;
+  return slot->sequence > 0 &&
+         checksum == qChecksum(bytes.constData(), kSlotSize - 2);
+}
+
+QByteArray ReadAt(QFile *file, quint64 offset, quint32 size) {
+  if (!file->seek(offset)) return QByteArray();
+  return file->read(size);
+}
+
+// Flush file to disk so that a commit never precedes the data it refers to.
+bool Sync(QFile *file) {
+  if (!file->flush()) return false;
+#ifdef Q_OS_UNIX
+  return fsync(file->handle()) == 0;
+#else
+  return true;
+#endif
+}
+
+}  // namespace
+
+ProjectFile::ProjectFile() :
+  sequence_(0), file_size_(0) {}
+
+bool ProjectFile::Load(const QString &path, Project *project, QString *error) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    *error = "Could not open file " + path;
+    return false;
+  }
+
+  path_.clear();
+  directory_.clear();
+
+  QByteArray header = file.read(kHeaderSize);
+  quint32 magic = 0;
+  quint32 version = 0;
+  QDataStream hs(header);
+  hs >> magic >> version;
+  if (header.size() < kHeaderSize || magic != kMagic) {
+    // Former format: the whole project in one stream. It is converted to the
+    // chunked format on the next save.
+    file.seek(0);
+    QDataStream ds(&file);
+    ds >> *project;
+    if (ds.status() != QDataStream::Ok) {
+      *error = "Invalid project file " + path;
+      return false;
+    }
+    return true;
+  }
+  if (version > kVersion) {
+    *error = "Project file " + path + " was written by a newer version.";
+    return false;
+  }
+
+  // Use the most recent valid commit.
+  Slot slot;
+  QByteArray directory_bytes;
+  slot.sequence = 0;
+  for (qint64 slot_offset : kSlotOffsets) {
+    Slot candidate;
+    if (!DecodeSlot(header.mid(slot_offset, kSlotSize), &candidate) ||
+        candidate.sequence <= slot.sequence) {
+      continue;
+    }
+    QByteArray bytes = ReadAt(&file, candidate.directory_offset,
+                              candidate.directory_size);
+    if (bytes.size() == static_cast<int>(candidate.directory_size) &&
+        qChecksum(bytes.constData(), bytes.size()) ==
+        candidate.directory_checksum) {
+      slot = candidate;
+      directory_bytes = bytes;
+    }
+  }
+  if (slot.sequence == 0) {
+    *error = "Corrupted project file " + path;
+    return false;
+  }
+
+  Directory directory;
+  QDataStream dds(directory_bytes);
+  quint32 nb_chunks = 0;
+  dds >> nb_chunks;
+  for (quint32 i = 0; i < nb_chunks && dds.status() == QDataStream::Ok; ++i) {
+    Chunk chunk;
+    dds >> chunk.kind >> chunk.task >> chunk.offset >> chunk.size >>
+           chunk.fingerprint;
+    directory.insert(qMakePair(chunk.kind, chunk.task), chunk);
+  }
+
+  // Metadata.
+  ChunkKey metadata_key = qMakePair(quint8(kMetadata), quint32(0));
+  if (dds.status() != QDataStream::Ok || !directory.contains(metadata_key)) {
+    *error = "Corrupted project file " + path;
+    return false;
+  }
+  const Chunk &metadata = directory[metadata_key];
+  QDataStream mds(ReadAt(&file, metadata.offset, metadata.size));
+  QString name;
+  quint32 source_type = 0;
+  QString video_path;
+  qint32 first_frame = 0;
+  qint32 last_frame = 0;
+  QStringList frame_paths;
+  float fps = 0.0f;
+  QVector<quint32> uids;
+  mds >> name >> source_type >> video_path >> first_frame >> last_frame >>
+         frame_paths >> fps >> uids;
+  project->set_name(name);
+  project->set_source_type(source_type == 1 ? Project::kSourceTypeVideo :
+                                              Project::kSourceTypeFrames);
+  project->set_video_path(video_path);
+  project->set_first_frame(first_frame);
+  project->set_last_frame(last_frame);
+  project->set_frame_paths(frame_paths);
+  project->set_fps(fps);
+
+  // Tasks. Results are mapped, not read.
+  project->clear_tasks();
+  for (quint32 uid : uids) {
+    ChunkKey definition_key = qMakePair(quint8(kTaskDefinition), uid);
+    if (!directory.contains(definition_key)) {
+      *error = "Corrupted project file " + path;
+      return false;
+    }
+    const Chunk &definition = directory[definition_key];
+    QDataStream tds(ReadAt(&file, definition.offset, definition.size));
+    TrackingTask *task = new TrackingTask;
+    task->set_uid(uid);
+    tds >> task;
+
+    ChunkKey results_key = qMakePair(quint8(kTaskResults), uid);
+    if (directory.contains(results_key)) {
+      const Chunk &results = directory[results_key];
+      if (!task->results_.Map(path, results.offset, results.size)) {
+        task->results_.Deserialize(ReadAt(&file, results.offset,
+                                          results.size));
+      }
+    }
+    project->add_tracking_task(task);
+  }
+
+  path_ = path;
+  sequence_ = slot.sequence;
+  file_size_ = file.size();
+  directory_ = directory;
+  return true;
+}
+
+bool ProjectFile::Save(const QString &path, Project *project, QString *error) {
+  bool incremental = !path_.isEmpty() && path == path_ &&
+                     QFileInfo(path).size() == file_size_;
+
+  // Compact when dead chunks take more than half of the file.
+  if (file_size_ > kMinCompactionSize &&
+      2 * LiveSize(directory_) < file_size_) {
+    incremental = false;
+  }
+
+  return incremental ? SaveIncremental(path, project, error) :
+                       SaveFull(path, project, error);
+}
+
+bool ProjectFile::WriteChunks(QIODevice *device, Project *project,
+                              bool rewrite, Directory *directory,
+                              QList<PendingMap> *pending) const {
+  Directory updated;
+
+  // Append a chunk to device.
+  auto write = [&](quint8 kind, quint32 task, const QByteArray &data,
+                   const QByteArray &fingerprint) -> bool {
+    Chunk chunk;
+    chunk.kind = kind;
+    chunk.task = task;
+    chunk.offset = device->pos();
+    chunk.size = data.size();
+    chunk.fingerprint = fingerprint;
+    if (device->write(data) != data.size()) return false;
+    updated.insert(qMakePair(kind, task), chunk);
+    return true;
+  };
+
+  // Keep the chunk already in the file if it has the same content.
+  auto write_if_changed = [&](quint8 kind, quint32 task,
+                              const QByteArray &data) -> bool {
+    ChunkKey key = qMakePair(kind, task);
+    QByteArray fingerprint = Fingerprint(data);
+    if (!rewrite && directory->contains(key) &&
+        (*directory)[key].fingerprint == fingerprint) {
+      updated.insert(key, (*directory)[key]);
+      return true;
+    }
+    return write(kind, task, data, fingerprint);
+  };
+
+  // Metadata.
+  QVector<quint32> uids;
+  for (const TrackingTask *task : project->tasks()) uids.push_back(task->uid());
+  QByteArray metadata;
+  QDataStream mds(&metadata, QIODevice::WriteOnly);
+  quint32 source_type =
+      (project->source_type() == Project::kSourceTypeVideo) ? 1 : 2;
+  mds << project->name() << source_type << project->video_path() <<
+         qint32(project->first_frame()) << qint32(project->last_frame()) <<
+         project->frame_paths() << project->fps() << uids;
+  if (!write_if_changed(kMetadata, 0, metadata)) return false;
+
+  for (TrackingTask *task : project->tasks()) {
+    // Definition.
+    QByteArray definition;
+    QDataStream tds(&definition, QIODevice::WriteOnly);
+    tds << static_cast<const TrackingTask *>(task);
+    if (!write_if_changed(kTaskDefinition, task->uid(), definition))
+      return false;
+
+    // Results. Only complete results are kept; they are up to date if they
+    // are still mapped from their chunk.
+    if (!task->completed()) continue;
+    ChunkKey key = qMakePair(quint8(kTaskResults), task->uid());
+    if (!rewrite && directory->contains(key) &&
+        task->results_.IsMappedFrom(path_, (*directory)[key].offset)) {
+      updated.insert(key, (*directory)[key]);
+      continue;
+    }
+    if (!write(kTaskResults, task->uid(), task->results_.Serialize(),
+               QByteArray())) {
+      return false;
+    }
+    pending->append(qMakePair(task, updated[key]));
+  }
+
+  *directory = updated;
+  return true;
+}
+
+bool ProjectFile::WriteDirectory(QIODevice *device, const Directory &directory,
+                                 QByteArray *slot, quint64 sequence) const {
+  QByteArray data;
+  QDataStream ds(&data, QIODevice::WriteOnly);
+  ds << quint32(directory.count());
+  for (const Chunk &chunk : directory) {
+    ds << chunk.kind << chunk.task << chunk.offset << chunk.size <<
+          chunk.fingerprint;
+  }
+
+  Slot s;
+  s.sequence = sequence;
+  s.directory_offset = device->pos();
+  s.directory_size = data.size();
+  s.directory_checksum = qChecksum(data.constData(), data.size());
+  if (device->write(data) != data.size()) return false;
+  *slot = EncodeSlot(s);
+  return true;
+}
+
+bool ProjectFile::SaveIncremental(const QString &path, Project *project,
+                                  QString *error) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadWrite) || !file.seek(file.size())) {
+    *error = "Could not open " + path + " for writing";
+    return false;
+  }
+
+  Directory directory = directory_;
+  QList<PendingMap> pending;
+  QByteArray slot;
+  quint64 sequence = sequence_ + 1;
+  if (!WriteChunks(&file, project, false, &directory, &pending) ||
+      !WriteDirectory(&file, directory, &slot, sequence)) {
+    *error = "Could not write " + path;
+    return false;
+  }
+  qint64 size = file.pos();
+
+  // Commit: the new directory only becomes visible once it is on disk.
+  if (!Sync(&file) || !file.seek(kSlotOffsets[sequence % 2]) ||
+      file.write(slot) != slot.size() || !Sync(&file)) {
+    *error = "Could not write " + path;
+    return false;
+  }
+
+  sequence_ = sequence;
+  file_size_ = size;
+  directory_ = directory;
+  MapResults(path, pending);
+  return true;
+}
+
+bool ProjectFile::SaveFull(const QString &path, Project *project,
+                           QString *error) {
+  // Write to a temporary file and rename it, so that results mapped from the
+  // previous version stay valid until they are remapped.
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly)) {
+    *error = "Could not open " + path + " for writing";
+    return false;
+  }
+
+  QByteArray header;
+  QDataStream hs(&header, QIODevice::WriteOnly);
+  hs << kMagic << kVersion;
+  header.append(QByteArray(kHeaderSize - header.size(), '\0'));
+
+  Directory directory;
+  QList<PendingMap> pending;
+  QByteArray slot;
+  const quint64 sequence = 1;
+  if (file.write(header) != header.size() ||
+      !WriteChunks(&file, project, true, &directory, &pending) ||
+      !WriteDirectory(&file, directory, &slot, sequence)) {
+    file.cancelWriting();
+    *error = "Could not write " + path;
+    return false;
+  }
+  qint64 size = file.pos();
+  if (!file.seek(kSlotOffsets[sequence % 2]) ||
+      file.write(slot) != slot.size() || !file.commit()) {
+    *error = "Could not write " + path;
+    return false;
+  }
+
+  path_ = path;
+  sequence_ = sequence;
+  file_size_ = size;
+  directory_ = directory;
+  MapResults(path, pending);
+  return true;
+}
+
+void ProjectFile::MapResults(const QString &path,
+                             const QList<PendingMap> &pending) {
+  // Written results are released from memory and mapped from the file.
+  for (const PendingMap &p : pending) {
+    p.first->results_.Map(path, p.second.offset, p.second.size);
+  }
+}
+
+qint64 ProjectFile::LiveSize(const Directory &directory) {
+  qint64 size = kHeaderSize;
+  for (const Chunk &chunk : directory) size += chunk.size;
+  return size;
+}
+
+QByteArray ProjectFile::Fingerprint(const QByteArray &data) {
+  return QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+}
+
+}  // namespace Multitrack
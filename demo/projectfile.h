@@ -0,0 +1,83 @@
+// projectfile.h
+//
+// Chunked on-disk storage of a project (.mtpro).
+//
+// The file starts with a header holding two commit slots, followed by chunks:
+// one for the project metadata, one per task definition and one per task
+// results, plus a directory listing the live chunks. Saving appends the dirty
+// chunks and a new directory at the end of the file, then commits by writing
+// the other slot. Chunks are never overwritten in place, so results mapped
+// from the file stay valid. When dead chunks make up most of the file, it is
+// compacted by a full rewrite.
+
+#ifndef MULTITRACK_PROJECTFILE_H
+#define MULTITRACK_PROJECTFILE_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QString>
+
+namespace Multitrack {
+
+class Project;
+class TrackingTask;
+
+class ProjectFile {
+public:
+  ProjectFile();
+
+  // Read project from path. Files in the former single-stream format are
+  // still accepted.
+  bool Load(const QString &path, Project *project, QString *error);
+
+  // Write project to path. Only chunks that changed since the last load or
+  // save of the same path are written.
+  bool Save(const QString &path, Project *project, QString *error);
+
+private:
+  enum ChunkKind { kMetadata = 0, kTaskDefinition, kTaskResults };
+
+  struct Chunk {
+    quint8 kind;
+    quint32 task;  // Task uid, 0 for metadata.
+    quint64 offset;
+    quint32 size;
+    QByteArray fingerprint;  // Hash of the content, empty for results.
+  };
+
+  typedef QPair<quint8, quint32> ChunkKey;
+  typedef QMap<ChunkKey, Chunk> Directory;
+
+  // Results chunk written during a save, to be mapped once committed.
+  typedef QPair<TrackingTask *, Chunk> PendingMap;
+
+  // Append to device the chunks of project that are not up to date in
+  // directory (all of them if rewrite is true) and update directory.
+  bool WriteChunks(QIODevice *device, Project *project, bool rewrite,
+                   Directory *directory, QList<PendingMap> *pending) const;
+
+  // Append a directory chunk and fill the commit slot fields.
+  bool WriteDirectory(QIODevice *device, const Directory &directory,
+                      QByteArray *slot, quint64 sequence) const;
+
+  bool SaveIncremental(const QString &path, Project *project, QString *error);
+  bool SaveFull(const QString &path, Project *project, QString *error);
+
+  void MapResults(const QString &path, const QList<PendingMap> &pending);
+  static qint64 LiveSize(const Directory &directory);
+
+  static QByteArray Fingerprint(const QByteArray &data);
+
+  // State of the file as of the last load or save.
+  QString path_;
+  quint64 sequence_;
+  qint64 file_size_;
+  Directory directory_;
+};
+
+}  // namespace Multitrack
+
+#endif  // MULTITRACK_PROJECTFILE_H
@@ -3,12 +3,14 @@
 #include "projectwidget.h"
 #include "ui_projectwidget.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 
 #include <QCheckBox>
 #include <QColorDialog>
 #include <QDataStream>
+#include <QDir>
 #include <QEvent>
 #include <QFile>
 #include <QFileDialog>
@@ -38,16 +40,46 @@
 
 namespace Multitrack {
 
+namespace {
+
+// Refresh period of the progress bars of the running tasks, in ms. Tasks only
+// bump a counter at every frame: the UI reads it at its own rate.
+const int kProgressRefreshMs = 100;
+
+// Weight of the last measure in the smoothed speed of a task.
+const double kSpeedSmoothing = 0.3;
+
+// Frame cache of the tasks, opted in by setting MULTITRACK_FRAME_CACHE_MB to
+// its size in megabytes. Empty directory if none.
+QString FrameCacheDirectory(qint64 *max_bytes) {
+  bool ok = false;
+  qint64 megabytes = qgetenv("MULTITRACK_FRAME_CACHE_MB").toLongLong(&ok);
+  if (!ok || megabytes <= 0) return QString();
+
+  QString directory = QDir::cleanPath(
+        QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+        QDir::separator() + "frames");
+  if (!QDir().mkpath(directory)) return QString();
+  *max_bytes = megabytes << 20;
+  return directory;
+}
+
+}  // namespace
+
 ProjectWidget::ProjectWidget(Project *project, QString location, bool saved,
                              QWidget *parent) :
   QWidget(parent),
   ui(new Ui::ProjectWidget),
   project_(project), location_(location), saved_(saved),
-  player_(nullptr), nb_pending_tasks_(0) {
+  player_(nullptr), nb_pending_tasks_(0), progress_timer_(new QTimer(this)) {
   assert(project != nullptr);
 
   ui->setupUi(this);
 
+  progress_timer_->setInterval(kProgressRefreshMs);
+  connect(progress_timer_, SIGNAL(timeout()), this, SLOT(UpdateProgress()));
+  progress_clock_.start();
+
   untouched_pixmap_ = new QPixmap;
 
   QString error;
@@ -142,17 +174,13 @@ ProjectWidget::~ProjectWidget() {
 bool ProjectWidget::Save() {
   if (saved_) return true;
   if (location_.isEmpty()) return SaveAs();
-  QFile file(location_);
-  if (file.open(QIODevice::WriteOnly)) {
-    QDataStream ds(&file);
-    ds << *project_;
-    file.close();
+  QString error;
+  if (project_->Save(location_, &error)) {
     saved_ = true;
     emit ProjectSaved(location_);
     return true;
   } else {
-    QMessageBox::critical(this, "Error", "Could not open " + location_ +
-                          " for writing");
+    QMessageBox::critical(this, "Error", error);
     return false;
   }
 }
@@ -300,11 +328,14 @@ void ProjectWidget::UpdateTaskList() {
   task_model_->removeRows(0, ui->tableViewTasks->model()->rowCount());
   const QVector<TrackingTask *> &tasks = project_->tasks();
   task_model_->setRowCount(tasks.count());
+  qint64 cache_bytes = 0;
+  QString cache_directory = FrameCacheDirectory(&cache_bytes);
   int row = 0;
   for (TrackingTask *task : tasks) {
     task->set_project_details(
           project_->source_type() == Project::kSourceTypeVideo,
           project_->video_path(), project_->frame_paths());
+    task->set_frame_cache(cache_directory, cache_bytes);
 
     QSignalMapper *mapper = new QSignalMapper;
 
@@ -352,7 +383,12 @@ void ProjectWidget::UpdateTaskList() {
     status->setMinimum(0);
     int max = nb_frames_ - task->first_frame() + 1;
     status->setMaximum(max);
-    status->setValue(task->completed() ? max : 0);
+    if (task->partial()) {
+      status->setValue(task->results().count());
+      status->setFormat("%p% (partial)");
+    } else {
+      status->setValue(task->completed() ? max : 0);
+    }
     status->setAlignment(Qt::AlignVCenter);
     QVBoxLayout *layout_status = new QVBoxLayout(widget_status);
     layout_status->addWidget(status);
@@ -362,8 +398,6 @@ void ProjectWidget::UpdateTaskList() {
                                        widget_status);
 
     // Connections.
-    connect(task, SIGNAL(Processed(int)), status, SLOT(setValue(int)),
-            Qt::QueuedConnection);
     connect(task, SIGNAL(Finished()), mapper, SLOT(map()));
     mapper->setMapping(task, row);
     connect(mapper, SIGNAL(mapped(int)), this, SLOT(TrackingFinished(int)),
@@ -377,6 +411,11 @@ void ProjectWidget::UpdateTaskList() {
     connect(task, SIGNAL(Preview()), mapper3, SLOT(map()));
     mapper3->setMapping(task, row);
     connect(mapper3, SIGNAL(mapped(int)), this, SLOT(ShowPreview(int)));
+    QSignalMapper *mapper4 = new QSignalMapper;
+    connect(task, SIGNAL(Cancelled()), mapper4, SLOT(map()));
+    mapper4->setMapping(task, row);
+    connect(mapper4, SIGNAL(mapped(int)), this, SLOT(TrackingCancelled(int)),
+            Qt::QueuedConnection);
 
     ++row;
   }
@@ -398,11 +437,23 @@ void ProjectWidget::RunTracker(int id) {
   stop->setStyleSheet("border: 0");
   stop->setIcon(QIcon(":/icons/images/wait.png"));
   stop->setIconSize(QSize(18, 18));
+  stop->setCursor(Qt::PointingHandCursor);
+  stop->setToolTip("Cancel");
   ui->tableViewTasks->setIndexWidget(task_model_->index(id, 3), stop);
+  QSignalMapper *mapper = new QSignalMapper;
+  connect(stop, SIGNAL(clicked()), mapper, SLOT(map()));
+  mapper->setMapping(stop, id);
+  connect(mapper, SIGNAL(mapped(int)), this, SLOT(CancelTracker(int)));
   QCheckBox *active = static_cast<QCheckBox *>(
       ui->tableViewTasks->indexWidget(task_model_->index(id, 0)));
   active->setEnabled(false);
   active->setChecked(false);
+  StatusBar(id)->setFormat("%p%");
+
+  project_->tasks().at(id)->ResetProgress();
+  TaskProgress progress = {-1, progress_clock_.elapsed(), 0};
+  running_tasks_.insert(id, progress);
+  if (!progress_timer_->isActive()) progress_timer_->start();
 
   QString text_preview = QString::number(id + 1) + " - " +
                          project_->tasks().at(id)->algorithm_str();
@@ -410,6 +461,7 @@ void ProjectWidget::RunTracker(int id) {
   ui->comboBoxPreview->setCurrentText(text_preview);
   ui->labelPreview->clear();
 
+  project_->tasks().at(id)->set_preview_size(ui->labelPreview->size());
   QMetaObject::invokeMethod(project_->tasks().at(id), "Run",
                             Qt::QueuedConnection);
 }
@@ -428,7 +480,23 @@ void ProjectWidget::DisplayRunButton(int row) {
           Qt::QueuedConnection);
 }
 
+QProgressBar *ProjectWidget::StatusBar(int row) const {
+  QWidget *widget_status =
+      ui->tableViewTasks->indexWidget(task_model_->index(row, 7));
+  return static_cast<QProgressBar *>(
+        widget_status->layout()->itemAt(0)->widget());
+}
+
+void ProjectWidget::StopProgress(int id) {
+  running_tasks_.remove(id);
+  if (running_tasks_.isEmpty()) progress_timer_->stop();
+}
+
 void ProjectWidget::TrackingFinished(int id) {
+  StopProgress(id);
+  QProgressBar *status = StatusBar(id);
+  status->setValue(status->maximum());
+  status->setFormat("%p%");
   DisplayRunButton(id);
   QCheckBox *active = static_cast<QCheckBox *>(
       ui->tableViewTasks->indexWidget(task_model_->index(id, 0)));
@@ -443,7 +511,39 @@ void ProjectWidget::TrackingFinished(int id) {
   ui->labelPreview->clear();
 }
 
+void ProjectWidget::CancelTracker(int id) {
+  // Disable the control until the task acknowledges, at the next frame.
+  QWidget *stop = ui->tableViewTasks->indexWidget(task_model_->index(id, 3));
+  if (stop != nullptr) stop->setEnabled(false);
+  project_->tasks().at(id)->Cancel();
+}
+
+void ProjectWidget::TrackingCancelled(int id) {
+  TrackingTask *task = project_->tasks().at(id);
+  StopProgress(id);
+  DisplayRunButton(id);
+  QCheckBox *active = static_cast<QCheckBox *>(
+      ui->tableViewTasks->indexWidget(task_model_->index(id, 0)));
+  active->setEnabled(task->completed());
+  active->setChecked(task->active());
+  QProgressBar *status = StatusBar(id);
+  status->setFormat("%p%");
+  if (task->partial()) {
+    status->setValue(task->results().count());
+    status->setFormat("%p% (partial)");
+  }
+  MarkProjectChange();
+  --nb_pending_tasks_;
+
+  QString text_preview = QString::number(id + 1) + " - " +
+                         task->algorithm_str();
+  ui->comboBoxPreview->removeItem(ui->comboBoxPreview->findText(text_preview));
+  ui->labelPreview->clear();
+}
+
 void ProjectWidget::OnTrackingError(int id) {
+  StopProgress(id);
+  StatusBar(id)->setFormat("%p%");
   QCheckBox *active = static_cast<QCheckBox *>(
       ui->tableViewTasks->indexWidget(task_model_->index(id, 0)));
   active->setEnabled(false);
@@ -458,6 +558,35 @@ void ProjectWidget::OnTrackingError(int id) {
                         "Tracking error: " + project_->tasks().at(id)->error());
 }
 
+void ProjectWidget::UpdateProgress() {
+  qint64 now = progress_clock_.elapsed();
+  for (QMap<int, TaskProgress>::iterator it = running_tasks_.begin();
+       it != running_tasks_.end(); ++it) {
+    int frames = project_->tasks().at(it.key())->progress();
+    if (frames < 0) continue;  // Not started yet.
+    TaskProgress &progress = it.value();
+    QProgressBar *status = StatusBar(it.key());
+    status->setValue(frames);
+
+    if (progress.frames >= 0 && now > progress.time) {
+      double fps = 1000.0 * (frames - progress.frames) / (now - progress.time);
+      progress.fps = progress.fps > 0 ?
+                     (1 - kSpeedSmoothing) * progress.fps +
+                     kSpeedSmoothing * fps :
+                     fps;
+    }
+    progress.frames = frames;
+    progress.time = now;
+
+    if (progress.fps > 0) {
+      int remaining = std::max(status->maximum() - frames, 0);
+      status->setFormat(QString("%p% (%1 fps, %2 left)")
+                        .arg(qRound(progress.fps))
+                        .arg(FrameToTime(remaining, progress.fps)));
+    }
+  }
+}
+
 void ProjectWidget::ShowPreview(int id) {
   if (ui->comboBoxPreview->currentText().startsWith(QString::number(id + 1) +
                                                     " -")) {
@@ -671,7 +800,7 @@ void ProjectWidget::on_toolButtonExportTask_clicked() {
   if (0 <= ind && ind < project_->tasks().count()) {
     TrackingTask* task = project_->tasks().at(ind);
     if (task->completed()) {
-      (new ExportDialog(this, task->results()))->show();
+      (new ExportDialog(this, project_->tasks(), ind))->show();
     } else {
       QMessageBox::critical(this, "Error", "Run task before exporting.");
       return;
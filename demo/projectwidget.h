@@ -3,13 +3,17 @@
 #ifndef MULTITRACK_PROJECTWIDGET_H
 #define MULTITRACK_PROJECTWIDGET_H
 
+#include <QElapsedTimer>
 #include <QImage>
+#include <QMap>
 #include <QPixmap>
+#include <QProgressBar>
 #include <QSize>
 #include <QStandardItemModel>
 #include <QString>
 #include <QThread>
 #include <QTime>
+#include <QTimer>
 #include <QWidget>
 
 #include <opencv2/core/core.hpp>
@@ -58,9 +62,12 @@ private slots:
   void UpdateTaskList();
   void RunTracker(int id);
   void DisplayRunButton(int row);
+  void CancelTracker(int id);
   void TrackingFinished(int id);
+  void TrackingCancelled(int id);
   void OnTrackingError(int id);
   void ShowPreview(int id);
+  void UpdateProgress();  // Poll the progress of the running tasks.
 
   void MarkProjectChange();  // Indicate that the project changed.
 
@@ -82,6 +89,19 @@ private:
 
   static QString FrameToTime(int frame, float fps);
 
+  // Progress bar in the status column of the task list.
+  QProgressBar *StatusBar(int row) const;
+
+  // Stop polling the progress of a task.
+  void StopProgress(int id);
+
+  // Progress of a running task at the last poll.
+  struct TaskProgress {
+    int frames;  // -1 until the task starts.
+    qint64 time;  // Time of the poll on progress_clock_, in ms.
+    double fps;  // Smoothed tracking speed, 0 until known.
+  };
+
   bool eventFilter(QObject *object, QEvent *event);
   void keyPressEvent(QKeyEvent *event);
   void keyReleaseEvent(QKeyEvent *event);
@@ -102,6 +122,9 @@ private:
   QStandardItemModel *task_model_;
   QThread *thread_tracking_;
   int nb_pending_tasks_;
+  QTimer *progress_timer_;
+  QElapsedTimer progress_clock_;
+  QMap<int, TaskProgress> running_tasks_;  // By id.
 
   QPixmap *untouched_pixmap_;
 };
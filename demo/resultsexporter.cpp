@@ -0,0 +1,332 @@
+// resultsexporter.cpp
+
+#include "resultsexporter.h"
+
+#include <cstring>
+
+#include <QFile>
+#include <QRect>
+#include <QtEndian>
+
+namespace Multitrack {
+
+namespace {
+
+const int kBufferSize = 1 << 20;
+
+// Write the decimal representation of v at p and return the end.
+char *FormatInt(char *p, qint32 v) {
+  quint32 u = static_cast<quint32>(v);
+  if (v < 0) {
+    *p++ = '-';
+    u = 0u - u;
+  }
+  char digits[10];
+  int n = 0;
+  do {
+    digits[n++] = static_cast<char>('0' + u % 10);
+    u /= 10;
+  } while (u != 0);
+  while (n > 0) *p++ = digits[--n];
+  return p;
+}
+
+// Write confidence in [0;1] with three decimals.
+char *FormatConfidence(char *p, float confidence) {
+  int m = qBound(0, qRound(confidence * 1000.0f), 1000);
+  p = FormatInt(p, m / 1000);
+  *p++ = '.';
+  *p++ = static_cast<char>('0' + (m / 100) % 10);
+  *p++ = static_cast<char>('0' + (m / 10) % 10);
+  *p++ = static_cast<char>('0' + m % 10);
+  return p;
+}
+
+char *Copy(char *p, const QByteArray &s) {
+  memcpy(p, s.constData(), s.size());
+  return p + s.size();
+}
+
+char *PutLittleEndian(char *p, quint32 v) {
+  qToLittleEndian<quint32>(v, reinterpret_cast<uchar *>(p));
+  return p + 4;
+}
+
+}  // namespace
+
+// Buffered output to a file.
+class ResultsExporter::Writer {
+public:
+  explicit Writer(QFile *file) :
+    file_(file), buffer_(kBufferSize, Qt::Uninitialized), pos_(0), ok_(true) {}
+
+  // Return a pointer where at most n bytes can be written.
+  char *Reserve(int n) {
+    if (pos_ + n > buffer_.size()) Flush();
+    if (n > buffer_.size()) buffer_.resize(n);
+    return buffer_.data() + pos_;
+  }
+
+  // Mark bytes up to end as written.
+  void Commit(const char *end) {
+    pos_ = end - buffer_.constData();
+  }
+
+  bool Flush() {
+    if (pos_ > 0 && file_->write(buffer_.constData(), pos_) != pos_)
+      ok_ = false;
+    pos_ = 0;
+    return ok_;
+  }
+
+private:
+  QFile *file_;
+  QByteArray buffer_;
+  int pos_;
+  bool ok_;
+};
+
+ResultsExporter::ResultsExporter(const QString &filename, Format format) :
+  filename_(filename), format_(format),
+  nb_rows_(0), nb_rows_done_(0), percent_(-1) {}
+
+void ResultsExporter::set_separators(const QString &frame_sep,
+                                     const QString &element_sep) {
+  frame_sep_ = frame_sep.toUtf8();
+  element_sep_ = element_sep.toUtf8();
+}
+
+void ResultsExporter::AddTask(int id, int first_frame,
+                              const TrackStore &results) {
+  Task task;
+  task.id = id;
+  task.first_frame = first_frame;
+  task.results = results.Serialize();
+  tasks_.push_back(task);
+  nb_rows_ += results.count();
+}
+
+void ResultsExporter::Run() {
+  QFile file(filename_);
+  if (!file.open(QIODevice::WriteOnly)) {
+    emit Failed("Could not open " + filename_ + " for writing.");
+    return;
+  }
+
+  QVector<TrackStore *> stores;
+  for (const Task &task : tasks_) {
+    TrackStore *store = new TrackStore;
+    store->Deserialize(task.results);
+    stores.push_back(store);
+  }
+
+  Writer writer(&file);
+  switch (format_) {
+    case kCenterSize:
+    case kCorners:
+    case kTopLeftSize:
+      WriteDelimited(&writer, stores);
+      break;
+    case kCsv:
+      WriteCsv(&writer, stores);
+      break;
+    case kMotChallenge:
+      WriteMotChallenge(&writer, stores);
+      break;
+    case kBinary:
+      WriteBinary(&writer, stores);
+      break;
+  }
+  qDeleteAll(stores);
+
+  bool ok = writer.Flush();
+  file.close();
+  if (!ok || file.error() != QFileDevice::NoError) {
+    emit Failed("Could not write " + filename_ + ".");
+    return;
+  }
+  emit Finished();
+}
+
+void ResultsExporter::WriteDelimited(Writer *writer,
+                                     const QVector<TrackStore *> &stores) {
+  const int max_row = 4 * 11 + 3 * element_sep_.size() + frame_sep_.size();
+  const QByteArray task_label = "task ";
+  for (int t = 0; t < stores.count(); ++t) {
+    // Several tasks are told apart by a line with their id before their rows.
+    if (stores.count() > 1) {
+      char *p = writer->Reserve(task_label.size() + 13);
+      if (t > 0) *p++ = '\n';
+      p = Copy(p, task_label);
+      p = FormatInt(p, tasks_.at(t).id);
+      *p++ = '\n';
+      writer->Commit(p);
+    }
+
+    TrackStore::Cursor cursor(*stores.at(t));
+    QRect rect;
+    bool first = true;
+    while (cursor.Next(&rect, nullptr)) {
+      char *p = writer->Reserve(max_row);
+      if (first) first = false;
+      else p = Copy(p, frame_sep_);
+
+      int a, b, c, d;
+      if (format_ == kCenterSize) {
+        a = rect.center().x();
+        b = rect.center().y();
+        c = rect.width();
+        d = rect.height();
+      } else if (format_ == kCorners) {
+        a = rect.topLeft().x();
+        b = rect.topLeft().y();
+        c = rect.bottomRight().x();
+        d = rect.bottomRight().y();
+      } else {
+        a = rect.topLeft().x();
+        b = rect.topLeft().y();
+        c = rect.width();
+        d = rect.height();
+      }
+      p = FormatInt(p, a);
+      p = Copy(p, element_sep_);
+      p = FormatInt(p, b);
+      p = Copy(p, element_sep_);
+      p = FormatInt(p, c);
+      p = Copy(p, element_sep_);
+      p = FormatInt(p, d);
+      writer->Commit(p);
+      RowsDone(1);
+    }
+  }
+}
+
+void ResultsExporter::WriteCsv(Writer *writer,
+                               const QVector<TrackStore *> &stores) {
+  const QByteArray header = "task,frame,x,y,width,height,confidence\n";
+  writer->Commit(Copy(writer->Reserve(header.size()), header));
+
+  const int max_row = 7 * 12;
+  for (int t = 0; t < stores.count(); ++t) {
+    TrackStore::Cursor cursor(*stores.at(t));
+    QRect rect;
+    float confidence = 0.0f;
+    int frame = tasks_.at(t).first_frame;
+    while (cursor.Next(&rect, &confidence)) {
+      char *p = writer->Reserve(max_row);
+      p = FormatInt(p, tasks_.at(t).id);
+      *p++ = ',';
+      p = FormatInt(p, frame++);
+      *p++ = ',';
+      p = FormatInt(p, rect.x());
+      *p++ = ',';
+      p = FormatInt(p, rect.y());
+      *p++ = ',';
+      p = FormatInt(p, rect.width());
+      *p++ = ',';
+      p = FormatInt(p, rect.height());
+      *p++ = ',';
+      p = FormatConfidence(p, confidence);
+      *p++ = '\n';
+      writer->Commit(p);
+      RowsDone(1);
+    }
+  }
+}
+
+void ResultsExporter::WriteMotChallenge(Writer *writer,
+                                        const QVector<TrackStore *> &stores) {
+  // Merge the tasks frame by frame, each one read sequentially.
+  QVector<TrackStore::Cursor *> cursors;
+  int first_frame = 0;
+  int end_frame = 0;
+  for (int t = 0; t < stores.count(); ++t) {
+    cursors.push_back(new TrackStore::Cursor(*stores.at(t)));
+    int first = tasks_.at(t).first_frame;
+    int end = first + stores.at(t)->count();
+    if (t == 0 || first < first_frame) first_frame = first;
+    if (t == 0 || end > end_frame) end_frame = end;
+  }
+
+  const int max_row = 7 * 12;
+  for (int frame = first_frame; frame < end_frame; ++frame) {
+    for (int t = 0; t < stores.count(); ++t) {
+      int first = tasks_.at(t).first_frame;
+      if (frame < first || frame >= first + stores.at(t)->count()) continue;
+
+      QRect rect;
+      float confidence = 0.0f;
+      cursors.at(t)->Next(&rect, &confidence);
+      char *p = writer->Reserve(max_row);
+      p = FormatInt(p, frame);
+      *p++ = ',';
+      p = FormatInt(p, tasks_.at(t).id);
+      *p++ = ',';
+      p = FormatInt(p, rect.x());
+      *p++ = ',';
+      p = FormatInt(p, rect.y());
+      *p++ = ',';
+      p = FormatInt(p, rect.width());
+      *p++ = ',';
+      p = FormatInt(p, rect.height());
+      *p++ = ',';
+      p = FormatConfidence(p, confidence);
+      *p++ = '\n';
+      writer->Commit(p);
+      RowsDone(1);
+    }
+  }
+  qDeleteAll(cursors);
+}
+
+// Layout (little-endian):
+//   char magic[4] = "MTRB"
+//   quint32 version = 1
+//   quint32 nb_tasks
+//   for each task:
+//     quint32 id, first_frame, count
+//     count records of qint32 x, y, width, height and float confidence
+void ResultsExporter::WriteBinary(Writer *writer,
+                                  const QVector<TrackStore *> &stores) {
+  char *p = writer->Reserve(12);
+  p = Copy(p, QByteArray("MTRB"));
+  p = PutLittleEndian(p, 1);
+  p = PutLittleEndian(p, stores.count());
+  writer->Commit(p);
+
+  for (int t = 0; t < stores.count(); ++t) {
+    p = writer->Reserve(12);
+    p = PutLittleEndian(p, tasks_.at(t).id);
+    p = PutLittleEndian(p, tasks_.at(t).first_frame);
+    p = PutLittleEndian(p, stores.at(t)->count());
+    writer->Commit(p);
+
+    TrackStore::Cursor cursor(*stores.at(t));
+    QRect rect;
+    float confidence = 0.0f;
+    while (cursor.Next(&rect, &confidence)) {
+      quint32 confidence_bits;
+      memcpy(&confidence_bits, &confidence, 4);
+      p = writer->Reserve(20);
+      p = PutLittleEndian(p, rect.x());
+      p = PutLittleEndian(p, rect.y());
+      p = PutLittleEndian(p, rect.width());
+      p = PutLittleEndian(p, rect.height());
+      p = PutLittleEndian(p, confidence_bits);
+      writer->Commit(p);
+      RowsDone(1);
+    }
+  }
+}
+
+void ResultsExporter::RowsDone(qint64 rows) {
+  nb_rows_done_ += rows;
+  int percent = (nb_rows_ > 0) ?
+                  static_cast<int>(100 * nb_rows_done_ / nb_rows_) : 100;
+  if (percent != percent_) {
+    percent_ = percent;
+    emit Progress(percent);
+  }
+}
+
+}  // namespace Multitrack
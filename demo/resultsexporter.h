@@ -0,0 +1,86 @@
+// resultsexporter.h
+//
+// Export the results of one or several tasks to a file. Meant to be moved to
+// a worker thread and started with Run().
+//
+// Results are copied in their compact encoded form when added, so the tasks
+// can be modified while the export runs. Rows are formatted by hand into a
+// large buffer that is written to the file in big blocks.
+
+#ifndef MULTITRACK_RESULTSEXPORTER_H
+#define MULTITRACK_RESULTSEXPORTER_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include "trackstore.h"
+
+namespace Multitrack {
+
+class ResultsExporter : public QObject {
+  Q_OBJECT
+
+public:
+  // Same order as in the export dialog.
+  enum Format {
+    kCenterSize = 0,  // Center.x, Center.y, Width, Height.
+    kCorners,         // TopLeft.x, TopLeft.y, BottomRight.x, BottomRight.y.
+    kTopLeftSize,     // TopLeft.x, TopLeft.y, Width, Height.
+    kCsv,             // task,frame,x,y,width,height,confidence.
+    kMotChallenge,    // frame,id,x,y,w,h,conf, sorted by frame.
+    kBinary           // See WriteBinary().
+  };
+
+  ResultsExporter(const QString &filename, Format format);
+
+  // Separators used by kCenterSize, kCorners and kTopLeftSize. With several
+  // tasks, these formats write the rows of each task on their own line(s),
+  // after a line "task <id>".
+  void set_separators(const QString &frame_sep, const QString &element_sep);
+
+  // Add the results of a task. id identifies the task in its project (see
+  // TrackingTask::uid()), whatever its place in the task list, and
+  // first_frame is the frame of the first result.
+  void AddTask(int id, int first_frame, const TrackStore &results);
+
+signals:
+  void Progress(int percent);
+  void Finished();
+  void Failed(const QString &error);
+
+public slots:
+  void Run();
+
+private:
+  struct Task {
+    int id;
+    int first_frame;
+    QByteArray results;  // Serialized TrackStore.
+  };
+
+  class Writer;
+
+  void WriteDelimited(Writer *writer, const QVector<TrackStore *> &stores);
+  void WriteCsv(Writer *writer, const QVector<TrackStore *> &stores);
+  void WriteMotChallenge(Writer *writer, const QVector<TrackStore *> &stores);
+  void WriteBinary(Writer *writer, const QVector<TrackStore *> &stores);
+
+  // Emit Progress() when the percentage changes.
+  void RowsDone(qint64 rows);
+
+  QString filename_;
+  Format format_;
+  QByteArray frame_sep_;
+  QByteArray element_sep_;
+  QVector<Task> tasks_;
+
+  qint64 nb_rows_;
+  qint64 nb_rows_done_;
+  int percent_;
+};
+
+}  // namespace Multitrack
+
+#endif  // MULTITRACK_RESULTSEXPORTER_H
@@ -2,7 +2,9 @@
 
 #include "trackingtask.h"
 
+#include <algorithm>
 #include <cassert>
+#include <thread>
 
 #include <QTime>
 
@@ -15,13 +17,43 @@ using namespace tl;
 
 namespace Multitrack {
 
+namespace {
+
+// Frames between checkpoints, before any thinning.
+const int kCheckpointInterval = 100;
+
+// Bytes of checkpoints kept per task.
+const qint64 kCheckpointBudget = 64 * 1024 * 1024;
+
+// Frames decoded ahead of tracking.
+const int kDecodeAhead = 4;
+
+// Read frame index of a video (from 0): from cache if it is open, else the
+// next frame decoded by cap, reusing the buffer of frame. Empty past the end.
+void ReadVideoFrame(const FrameCache &cache, cv::VideoCapture *cap, int index,
+                    cv::Mat *frame) {
+  if (!cache.is_open())
+    *cap >> *frame;
+  else if (index < cache.nb_frames())
+    *frame = cache.frame(index);
+  else
+    frame->release();
+}
+
+}  // namespace
+
 TrackingTask::TrackingTask() :
-  filter_(kNoFilter), bgs_(kNoBgs),
-  completed_(false), active_(false) {
+  algo_(kTemplateMatching), filter_(kNoFilter), bgs_(kNoBgs), uid_(0), first_frame_(1),
+  completed_(false), partial_(false),
+  checkpoint_interval_(kCheckpointInterval), checkpoints_size_(0),
+  cancel_requested_(0), progress_(-1), frame_cache_bytes_(0),
+  active_(false) {
   set_random_color();
 }
 
-TrackingTask::TrackingTask(const TrackingTask *task) {
+TrackingTask::TrackingTask(const TrackingTask *task) :
+  uid_(0), checkpoint_interval_(kCheckpointInterval), checkpoints_size_(0),
+  cancel_requested_(0), progress_(-1), frame_cache_bytes_(0) {
   algo_ = task->algo_;
   params_ = task->params_;
   filter_ = task->filter_;
@@ -30,25 +62,32 @@ TrackingTask::TrackingTask(const TrackingTask *task) {
   bgs_params_ = task->bgs_params_;
   object_ = task->object_;
   first_frame_ = task->first_frame_;
+  corrections_ = task->corrections_;
   set_random_color();
   ClearResults();
 }
 
 void TrackingTask::set_tracker(Algorithm algo,
                                const QVector<Param> &params) {
+  if (algo == algo_ && params == params_) return;
   algo_ = algo;
   params_ = params;
+  Invalidate(first_frame_);
 }
 
 void TrackingTask::set_filter(Filter filter,
                               const QVector<Param> &filter_params) {
+  if (filter == filter_ && filter_params == filter_params_) return;
   filter_ = filter;
   filter_params_ = filter_params;
+  Invalidate(first_frame_);
 }
 
 void TrackingTask::set_bgs(Bgs bgs, const QVector<Param> &bgs_params) {
+  if (bgs == bgs_ && bgs_params == bgs_params_) return;
   bgs_ = bgs;
   bgs_params_ = bgs_params;
+  Invalidate(first_frame_);
 }
 
 TrackingTask::Algorithm TrackingTask::algorithm() const {
@@ -96,11 +135,40 @@ const Param &TrackingTask::bgs_param(int i) const {
 }
 
 void TrackingTask::set_object(const cv::Rect &object) {
-  object_ = CvRect2QRect(object);
+  QRect rect = CvRect2QRect(object);
+  if (rect == object_) return;
+  object_ = rect;
+  Invalidate(first_frame_);
 }
 
 void TrackingTask::set_first_frame(int first_frame) {
+  if (first_frame == first_frame_) return;
   first_frame_ = first_frame;
+  Invalidate(first_frame_);
+
+  // Corrections before the new first frame are meaningless.
+  while (!corrections_.isEmpty() && corrections_.firstKey() <= first_frame_)
+    corrections_.erase(corrections_.begin());
+}
+
+void TrackingTask::set_correction(int frame, const QRect &object) {
+  assert(frame > first_frame_);
+  if (corrections_.contains(frame) && corrections_.value(frame) == object)
+    return;
+  corrections_.insert(frame, object);
+  Invalidate(frame);
+}
+
+const QMap<int, QRect> &TrackingTask::corrections() const {
+  return corrections_;
+}
+
+quint32 TrackingTask::uid() const {
+  return uid_;
+}
+
+void TrackingTask::set_uid(quint32 uid) {
+  uid_ = uid;
 }
 
 void TrackingTask::set_project_details(bool is_video,
@@ -111,6 +179,12 @@ void TrackingTask::set_project_details(bool is_video,
   frame_paths_ = QStringList(frame_paths);
 }
 
+void TrackingTask::set_frame_cache(const QString &directory,
+                                   qint64 max_bytes) {
+  frame_cache_directory_ = directory;
+  frame_cache_bytes_ = max_bytes;
+}
+
 void TrackingTask::set_color(const QColor &color) {
   color_ = QColor(color);
 }
@@ -121,6 +195,10 @@ void TrackingTask::set_random_color() {
                    rand_int(0, 255)));
 }
 
+void TrackingTask::set_preview_size(const QSize &size) {
+  preview_size_ = size;
+}
+
 void TrackingTask::set_active(bool active) {
   if (completed_) active_ = active;
 }
@@ -132,14 +210,33 @@ QRect TrackingTask::result(int frame) const {
   return results_.at(frame - first_frame_);
 }
 
-const QVector<QRect> &TrackingTask::results() const {
+float TrackingTask::confidence(int frame) const {
+  if (frame < first_frame_) return 0.0f;
+  if (results_.count() < frame - first_frame_ + 1) return 0.0f;
+
+  return results_.confidence(frame - first_frame_);
+}
+
+const TrackStore &TrackingTask::results() const {
   return results_;
 }
 
+Track TrackingTask::track() const {
+  Track track;
+  for (int i = 0; i < results_.count(); ++i) {
+    track.Append(first_frame_ + i, QRect2CvRect(results_.at(i)));
+  }
+  return track;
+}
+
 bool TrackingTask::completed() const {
   return completed_;
 }
 
+bool TrackingTask::partial() const {
+  return partial_;
+}
+
 bool TrackingTask::active() const {
   return active_;
 }
@@ -166,16 +263,91 @@ const cv::Mat &TrackingTask::preview() const {
 
 void TrackingTask::ClearResults() {
   completed_ = false;
+  partial_ = false;
   active_ = false;
-  results_.clear();
+  results_.Clear();
+  checkpoints_.clear();
+  checkpoint_interval_ = kCheckpointInterval;
+  checkpoints_size_ = 0;
+}
+
+void TrackingTask::Invalidate(int frame) {
+  if (frame <= first_frame_) {
+    ClearResults();
+    return;
+  }
+
+  // A checkpoint after frame - 1 went through invalid results.
+  QMap<int, QByteArray>::iterator it = checkpoints_.lowerBound(frame);
+  while (it != checkpoints_.end()) {
+    checkpoints_size_ -= it.value().size();
+    it = checkpoints_.erase(it);
+  }
+
+  int count = frame - first_frame_;
+  if (results_.count() > count) {
+    results_.Truncate(count);
+    partial_ = true;
+  }
+}
+
+void TrackingTask::AddCheckpoint(int frame, const Tracker &tracker) {
+  std::string snapshot;
+  if (!tracker.SaveState(&snapshot)) return;  // Not supported by tracker.
+
+  QByteArray data(snapshot.data(), static_cast<int>(snapshot.size()));
+  checkpoints_size_ += data.size() - checkpoints_.value(frame).size();
+  checkpoints_.insert(frame, data);
+
+  // Over budget: keep every other checkpoint, and take half as many.
+  while (checkpoints_size_ > kCheckpointBudget && !checkpoints_.isEmpty()) {
+    checkpoint_interval_ *= 2;
+    QMap<int, QByteArray>::iterator it = checkpoints_.begin();
+    while (it != checkpoints_.end()) {
+      if ((it.key() - first_frame_) % checkpoint_interval_ != 0) {
+        checkpoints_size_ -= it.value().size();
+        it = checkpoints_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+}
+
+void TrackingTask::Cancel() {
+  cancel_requested_.store(1);
+}
+
+int TrackingTask::progress() const {
+  return progress_.load();
+}
+
+void TrackingTask::ResetProgress() {
+  progress_.store(-1);
+}
+
+void TrackingTask::ReadLegacy(QDataStream &in) {
+  int c = 0;
+  int d = 0;
+  int e = 0;
+  QVector<QRect> results;
+  in >> c >> params_ >> d >> filter_params_ >> e >> bgs_params_ >>
+        object_ >> first_frame_ >> completed_ >> results >>
+        active_ >> color_;
+  partial_ = false;
+  algo_ = static_cast<TrackingTask::Algorithm>(c);
+  filter_ = static_cast<TrackingTask::Filter>(d);
+  bgs_ = static_cast<TrackingTask::Bgs>(e);
+  results_.Clear();
+  for (const QRect &rect : results) results_.Append(rect);
 }
 
 QDataStream &operator<<(QDataStream &out, const TrackingTask *t) {
   out << quint32(static_cast<int>(t->algo_)) << t->params_ <<
          quint32(static_cast<int>(t->filter_)) << t->filter_params_ <<
          quint32(static_cast<int>(t->bgs_)) << t->bgs_params_ <<
-         t->object_ << t->first_frame_ << t->completed_ << t->results_ <<
-         t->active_ << t->color_;
+         t->object_ << t->first_frame_ << t->completed_ <<
+         t->active_ << t->color_ << t->partial_ << t->corrections_;
   return out;
 }
 
@@ -185,8 +357,12 @@ QDataStream &operator>>(QDataStream &in, TrackingTask *t) {
   int d = 0;
   int e = 0;
   in >> c >> t->params_ >> d >> t->filter_params_ >> e >> t->bgs_params_ >>
-        t->object_ >> t->first_frame_ >> t->completed_ >> t->results_ >>
+        t->object_ >> t->first_frame_ >> t->completed_ >>
         t->active_ >> t->color_;
+  t->partial_ = false;
+  if (!in.atEnd()) in >> t->partial_;  // Absent before cancellation.
+  t->corrections_.clear();
+  if (!in.atEnd()) in >> t->corrections_;  // Absent before corrections.
   t->algo_ = static_cast<TrackingTask::Algorithm>(c);
   t->filter_ = static_cast<TrackingTask::Filter>(d);
   t->bgs_ = static_cast<TrackingTask::Bgs>(e);
@@ -194,19 +370,60 @@ QDataStream &operator>>(QDataStream &in, TrackingTask *t) {
 }
 
 void TrackingTask::Run() {
+  DoRun();
+  // Tasks run one after the other on the tracking thread, so a request made
+  // while this task was queued or running is not seen by the next run.
+  cancel_requested_.store(0);
+}
+
+void TrackingTask::DoRun() {
+  if (cancel_requested_.load()) {
+    // Cancelled while queued: keep the previous results.
+    emit Cancelled();
+    return;
+  }
+
+  // Restart from the last checkpoint before the first missing result, if
+  // the results up to it are still valid.
+  int resume_frame = 0;
+  QByteArray snapshot;
+  if (completed_) {
+    QMap<int, QByteArray>::const_iterator it =
+        checkpoints_.lowerBound(first_frame_ + results_.count());
+    if (it != checkpoints_.constBegin()) {
+      --it;
+      resume_frame = it.key();
+      snapshot = it.value();
+    }
+  }
+
+  // Restored if cancelled before tracking starts.
+  const bool was_completed = completed_;
+  const bool was_partial = partial_;
+  const bool was_active = active_;
   completed_ = false;
+  partial_ = false;
   active_ = false;
 
+  // Declared before the tracker, which may keep headers over its frames.
+  FrameCache cache;
+  if (is_video_ && !frame_cache_directory_.isEmpty()) {
+    cache.set_directory(frame_cache_directory_.toStdString());
+    cache.set_max_bytes(frame_cache_bytes_);
+    std::string cache_error;
+    cache.Open(video_path_.toStdString(), &cache_error);  // Else decode.
+  }
+
   cv::VideoCapture cap;
   cv::Mat frame;
   if (is_video_) {
-    cap.open(video_path_.toStdString());
-    if (!cap.isOpened()) {
+    if (!cache.is_open()) cap.open(video_path_.toStdString());
+    if (!cache.is_open() && !cap.isOpened()) {
       error_ = "Could not open video.";
       emit Failed();
       return;
     }
-    cap >> frame;
+    ReadVideoFrame(cache, &cap, 0, &frame);
     if (!frame.data) {
       error_ = "Video is empty.";
       emit Failed();
@@ -226,9 +443,17 @@ void TrackingTask::Run() {
 
   int index = 0;
   while (index + 1 < first_frame_) {
+    if (cancel_requested_.load()) {
+      // Nothing tracked yet: keep the previous results, as when queued.
+      completed_ = was_completed;
+      partial_ = was_partial;
+      active_ = was_active;
+      emit Cancelled();
+      return;
+    }
     if (is_video_) {
       ++index;
-      cap >> frame;
+      ReadVideoFrame(cache, &cap, index, &frame);
       if (!frame.data) {
         error_ = "Not enough frames";
         emit Failed();
@@ -282,10 +507,11 @@ void TrackingTask::Run() {
   switch (filter_) {
     case kKalmanFilter:
     {
-      tl::KalmanFilter *filter = new tl::KalmanFilter(
-                                   QRect2CvRect(object_),
-                                   filter_params_.at(0).GetF(),
-                                   filter_params_.at(1).GetF());
+      // Closed form of the Kalman filter of the standard tracking model.
+      tl::ConstantVelocityFilter *filter = new tl::ConstantVelocityFilter(
+                                             QRect2CvRect(object_),
+                                             filter_params_.at(0).GetF(),
+                                             filter_params_.at(1).GetF());
       tracker.set_filter(filter);
       break;
     }
@@ -313,42 +539,137 @@ void TrackingTask::Run() {
     }
   }
 
-  results_.clear();
-  results_.push_back(object_);
-  while (true) {
-    if (is_video_) {
-      ++index;
-      cap >> frame;
-      if (!frame.data)
-        break;
-    } else {
+  if (resume_frame > 0) {
+    if (!tracker.LoadState(std::string(snapshot.constData(),
+                                       snapshot.size()))) {
+      ClearResults();
+      error_ = "Invalid checkpoint.";
+      emit Failed();
+      return;
+    }
+    results_.Truncate(resume_frame - first_frame_ + 1);
+    Invalidate(resume_frame + 1);
+    partial_ = false;
+
+    // Frames up to the checkpoint were already tracked.
+    while (index + 1 < resume_frame) {
+      if (cancel_requested_.load()) {
+        completed_ = true;
+        partial_ = true;
+        active_ = true;
+        emit Cancelled();
+        return;
+      }
       ++index;
-      if (index >= frame_paths_.count())
-        break;
-      frame = cv::imread(frame_paths_.at(index).toStdString());
+      bool grabbed = !is_video_ ||
+                     (cache.is_open() ? index < cache.nb_frames() :
+                                        cap.grab());
+      if (!grabbed) {
+        ClearResults();
+        error_ = "Not enough frames";
+        emit Failed();
+        return;
+      }
+    }
+  } else {
+    ClearResults();
+    results_.Append(object_);
+  }
+
+  progress_.store(index - first_frame_ + 1);
+
+  // Decode the next frames on another thread while tracking.
+  FrameRing ring(kDecodeAhead);
+  std::thread decoder([&]() {
+    for (int next = index + 1; ; ++next) {
+      FrameSlot *slot = ring.BeginWrite(TL_RING_WAIT);
+      if (slot == nullptr) return;  // Tracking stopped.
+      if (is_video_) {
+        ReadVideoFrame(cache, &cap, next, &slot->frame);
+        slot->timestamp = cache.is_open() ? -1 :
+                                            cap.get(CV_CAP_PROP_POS_MSEC);
+      } else if (next < frame_paths_.count()) {
+        slot->frame = cv::imread(frame_paths_.at(next).toStdString());
+      } else {
+        slot->frame.release();
+      }
+      if (!slot->frame.data) break;
+      slot->index = next;
+      ring.EndWrite();
     }
+    ring.Close();
+  });
 
-    tracker.Track(frame);
+  while (true) {
+    if (cancel_requested_.load()) {
+      partial_ = true;
+      break;
+    }
+
+    const FrameSlot *slot = ring.BeginRead(0, TL_RING_WAIT);
+    if (slot == nullptr) {
+      ++index;  // End of the source.
+      break;
+    }
+    index = slot->index;
+
+    tracker.Track(slot->frame);
     cv::Rect object = tracker.state();
 
-    results_.push_back(CvRect2QRect(object));
-    emit Processed(index - first_frame_ + 1);
+    // Frame numbers start at 1.
+    int frame_number = index + 1;
+    if (corrections_.contains(frame_number)) {
+      object = QRect2CvRect(corrections_.value(frame_number));
+      tracker.set_state(object);
+    }
+
+    results_.Append(CvRect2QRect(object), tracker.confidence());
+    if ((frame_number - first_frame_) % checkpoint_interval_ == 0)
+      AddCheckpoint(frame_number, tracker);
+    progress_.store(index - first_frame_ + 1);
     if (timer.elapsed() > 100) {
-      cv::Mat overlay(frame.rows, frame.cols, frame.type(),
-                      cv::Scalar::all(0));
-      cv::rectangle(overlay, object, cv::Scalar(0, 255, 255), CV_FILLED);
-      cv::addWeighted(frame, 1.0, overlay, 0.5, 0, preview_);
+      UpdatePreview(slot->frame, object);
       emit Preview();
       timer.restart();
     }
+    ring.EndRead(0);
   }
+  ring.Close();
+  decoder.join();
 
-  emit Processed(index - first_frame_ + 1);
   completed_ = true;
   active_ = true;
+  if (partial_) {
+    emit Cancelled();
+    return;
+  }
+  progress_.store(index - first_frame_ + 1);
   emit Finished();
 }
 
+void TrackingTask::UpdatePreview(const cv::Mat &frame,
+                                 const cv::Rect &object) {
+  // Downscale first so that only display-sized pixels are touched.
+  double scale = 1.0;
+  if (!preview_size_.isEmpty()) {
+    scale = std::min(static_cast<double>(preview_size_.width()) / frame.cols,
+                     static_cast<double>(preview_size_.height()) / frame.rows);
+    scale = std::min(scale, 1.0);
+  }
+  cv::Size size(std::max(1, cvRound(frame.cols * scale)),
+                std::max(1, cvRound(frame.rows * scale)));
+  cv::resize(frame, preview_, size, 0, 0, cv::INTER_NEAREST);
+
+  // Same as blending a filled yellow rectangle at 50%, but only inside it.
+  cv::Rect rect(cvRound(object.x * scale), cvRound(object.y * scale),
+                cvRound(object.width * scale), cvRound(object.height * scale));
+  rect &= cv::Rect(0, 0, preview_.cols, preview_.rows);
+  if (rect.area() > 0) {
+    cv::Mat roi = preview_(rect);
+    roi += cv::Scalar(0, 127.5, 127.5);
+  }
+}
+
 QRect TrackingTask::CvRect2QRect(const cv::Rect &r) {
   QRect q;
   q.setX(r.x);
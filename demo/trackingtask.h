@@ -8,11 +8,14 @@
 #ifndef MULTITRACK_TRACKINGTASK_H
 #define MULTITRACK_TRACKINGTASK_H
 
+#include <QAtomicInt>
 #include <QColor>
 #include <QDataStream>
 #include <QImage>
+#include <QMap>
 #include <QObject>
 #include <QRect>
+#include <QSize>
 #include <QString>
 #include <QStringList>
 #include <QVector>
@@ -22,6 +25,12 @@
 
 #include "param.h"
 #include "project.h"
+#include "trackstore.h"
+
+namespace tl {
+class Track;
+class Tracker;
+}
 
 namespace Multitrack {
 
@@ -59,21 +68,49 @@ public:
   Bgs bgs() const;
   const Param &bgs_param(int i) const;
 
+  // Setters invalidate the results they affect when the value changes.
   void set_tracker(Algorithm algo, const QVector<Param> &params);
   void set_filter(Filter filter, const QVector<Param> &filter_params);
   void set_bgs(Bgs bgs, const QVector<Param> &bgs_params);
   void set_object(const cv::Rect &object);
   void set_first_frame(int first_frame);
 
+  // Object fixed by the user at a frame after the first one. Tracking
+  // continues from it, and results from that frame on are invalidated.
+  void set_correction(int frame, const QRect &object);
+  const QMap<int, QRect> &corrections() const;
+
+  // Identifier of the task within its project (0 until added to one).
+  quint32 uid() const;
+  void set_uid(quint32 uid);
+
   void set_project_details(bool is_video,
                            const QString &video_path,
                            const QStringList &frame_paths);
 
+  // Read the video through a frame cache in directory, of at most max_bytes,
+  // so that it is decoded once for all runs. Empty directory for none.
+  void set_frame_cache(const QString &directory, qint64 max_bytes);
+
   void set_random_color();
 
+  // Size of the label the preview is displayed in. Previews are generated at
+  // this resolution directly.
+  void set_preview_size(const QSize &size);
+
   QRect result(int frame) const;
-  const QVector<QRect> &results() const;
+  float confidence(int frame) const;
+  const TrackStore &results() const;
+
+  // Results as a track, to be scored with tl::Evaluate().
+  tl::Track track() const;
+
+  // Whether the task was run and has results. If partial, results stop
+  // before the end of the source because the run was cancelled or an edit
+  // invalidated the following ones; running the task again only computes the
+  // missing results.
   bool completed() const;
+  bool partial() const;
   bool active() const;
   int first_frame() const;
   const QColor &color() const;
@@ -84,10 +121,20 @@ public:
 
   void ClearResults();
 
+  // Ask the running or queued task to stop at the next frame. Thread-safe.
+  // Results tracked so far are kept and marked partial.
+  void Cancel();
+
+  // Number of frames with results in the current run (the progress), -1
+  // until it starts. Updated at every frame without any signal, for the UI to
+  // poll at its own rate. Thread-safe.
+  int progress() const;
+  void ResetProgress();
+
 signals:
-  void Processed(int frame);
   void Finished();
   void Failed();
+  void Cancelled();
   void Preview();  // Preview ready.
 
 public slots:
@@ -110,27 +157,63 @@ private:
   Bgs bgs_;
   QVector<Param> bgs_params_;
 
+  quint32 uid_;
+
   // Tracking problem.
   QRect object_;
   int first_frame_;
 
   // Results.
-  QVector<QRect> results_;  // Includes the object itself.
+  TrackStore results_;  // Includes the object itself.
   bool completed_;
+  bool partial_;
+
+  // Corrections by the user, by frame.
+  QMap<int, QRect> corrections_;
+
+  // Tracker snapshots taken during the last runs, by last frame tracked, to
+  // restart from the nearest one when results are invalidated. Kept in
+  // memory only: their interval doubles when they exceed a size budget.
+  QMap<int, QByteArray> checkpoints_;
+  int checkpoint_interval_;
+  qint64 checkpoints_size_;
+
+  // Set by Cancel(), checked once per frame and cleared when Run() returns.
+  QAtomicInt cancel_requested_;
+
+  // See progress().
+  QAtomicInt progress_;
 
   // Details of the project.
   bool is_video_;
   QString video_path_;
   QStringList frame_paths_;
 
+  // Frame cache, if any.
+  QString frame_cache_directory_;
+  qint64 frame_cache_bytes_;
+
   // UI properties.
   bool active_;  // Whether we visualize it or not.
   QColor color_;
-  cv::Mat preview_;
+  QSize preview_size_;
+  cv::Mat preview_;  // Reused between previews.
 
   // Error message.
   QString error_;
 
+  // Body of Run().
+  void DoRun();
+
+  // Drop results and checkpoints from frame on.
+  void Invalidate(int frame);
+
+  // Store a snapshot of tracker after frame, thinning older ones if needed.
+  void AddCheckpoint(int frame, const tl::Tracker &tracker);
+
+  // Downscale frame into preview_ and highlight object in place.
+  void UpdatePreview(const cv::Mat &frame, const cv::Rect &object);
+
   // Conversion functions.
   static QRect CvRect2QRect(const cv::Rect &r);
   static cv::Rect QRect2CvRect(const QRect &q);
@@ -138,8 +221,14 @@ private:
   // Random integer from low to high (included).
   static int rand_int(int low, int high);
 
+  // Results are stored separately by the project file.
+  friend class ProjectFile;
+
 public:
-  // Serialization.
+  // Read a task in the former format, which included the results.
+  void ReadLegacy(QDataStream &in);
+
+  // Serialization of the task definition (without results).
   friend QDataStream &operator<<(QDataStream &out, const TrackingTask *t);
   friend QDataStream &operator>>(QDataStream &in, TrackingTask *t);
 };
@@ -26,6 +26,7 @@ TrackingTaskDialog::TrackingTaskDialog(const QPixmap *pixmap,
   selecting_(false),
   selected_(false),
   moving_(kNone),
+  correcting_(false),
   task_(task) {
   assert(pixmap != nullptr);
   assert(task != nullptr);
@@ -51,9 +52,18 @@ TrackingTaskDialog::TrackingTaskDialog(const QPixmap *pixmap,
   if (!task_->object().isEmpty()) {
     ui->tabWidget->setCurrentIndex(1);
 
-    // Object selection.
-    start_point_ = RealToAbsolute(task_->object().topLeft());
-    end_point_ = RealToAbsolute(task_->object().bottomRight());
+    // Object selection. After the first frame, the object tracked there is
+    // shown and moving it corrects the track from that frame on.
+    QRect object = task_->object();
+    if (frame_number_ > task_->first_frame() &&
+        !task_->result(frame_number_).isEmpty()) {
+      object = task_->result(frame_number_);
+      correcting_ = true;
+      ui->labelFrame->setText("Frame " + QString::number(frame_number_) +
+                              " (correction)");
+    }
+    start_point_ = RealToAbsolute(object.topLeft());
+    end_point_ = RealToAbsolute(object.bottomRight());
     selected_ = true;
     Draw();
 
@@ -295,7 +305,13 @@ void TrackingTaskDialog::accept() {
   object.y = start.y();
   object.width = end.x() - start.x();
   object.height = end.y() - start.y();
-  task_->set_object(object);
+  if (!correcting_) {
+    task_->set_object(object);
+  } else if (QRect(object.x, object.y, object.width, object.height) !=
+             task_->result(frame_number_)) {
+    task_->set_correction(frame_number_, QRect(object.x, object.y,
+                                               object.width, object.height));
+  }
 
   int algo = ui->tabWidgetAlgo->currentIndex();
 
@@ -340,7 +356,7 @@ void TrackingTaskDialog::accept() {
     task_->set_bgs(TrackingTask::kNoBgs, bgs_params);
   }
 
-  task_->ClearResults();
+  // Setters invalidated the results affected by the changes.
   QDialog::accept();
 }
 
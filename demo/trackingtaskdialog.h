@@ -84,6 +84,7 @@ private:
   bool selected_;  // Whether user has selecting an object.
   MousePos moving_;  // Side being moved.
   QPoint moving_middle_from_;
+  bool correcting_;  // Whether the selection corrects the track at this frame.
 
   TrackingTask *task_;  // Not owned.
 };
@@ -0,0 +1,327 @@
+// trackstore.cpp
+
+#include "trackstore.h"
+
+#include <cassert>
+
+#include <QVector>
+#include <QtEndian>
+
+namespace Multitrack {
+
+TrackStore::TrackStore() :
+  count_(0), file_(nullptr), map_(nullptr), map_offset_(0), map_size_(0) {
+  for (int c = 0; c < kNbColumns; ++c) last_[c] = 0;
+}
+
+TrackStore::~TrackStore() {
+  Unmap();
+}
+
+int TrackStore::count() const {
+  return count_;
+}
+
+bool TrackStore::isEmpty() const {
+  return count_ == 0;
+}
+
+QRect TrackStore::at(int i) const {
+  assert(0 <= i && i < count_);
+  View view = GetView();
+  return QRect(Decode(view, kX, i), Decode(view, kY, i),
+               Decode(view, kWidth, i), Decode(view, kHeight, i));
+}
+
+float TrackStore::confidence(int i) const {
+  assert(0 <= i && i < count_);
+  return GetView().confidences[i] / 255.0f;
+}
+
+void TrackStore::Append(const QRect &rect, float confidence) {
+  Detach();
+
+  const qint32 values[kNbColumns] = {rect.x(), rect.y(),
+                                     rect.width(), rect.height()};
+  bool new_block = (count_ % kBlockSize == 0);
+  for (int c = 0; c < kNbColumns; ++c) {
+    if (new_block) {
+      uchar offset[4];
+      qToLittleEndian<quint32>(data_[c].size(), offset);
+      offsets_[c].append(reinterpret_cast<const char *>(offset), 4);
+      PutVarint(&data_[c], values[c]);
+    } else {
+      PutVarint(&data_[c], values[c] - last_[c]);
+    }
+    last_[c] = values[c];
+  }
+  confidences_.append(static_cast<char>(
+                        qBound(0, qRound(confidence * 255.0f), 255)));
+  ++count_;
+}
+
+void TrackStore::Clear() {
+  Unmap();
+  count_ = 0;
+  confidences_.clear();
+  for (int c = 0; c < kNbColumns; ++c) {
+    offsets_[c].clear();
+    data_[c].clear();
+    last_[c] = 0;
+  }
+}
+
+void TrackStore::Truncate(int count) {
+  if (count >= count_) return;
+  if (count <= 0) {
+    Clear();
+    return;
+  }
+  Detach();
+
+  // Cut at the start of the block holding the last kept result, then append
+  // the kept part of that block again.
+  int block = (count - 1) / kBlockSize;
+  int first = block * kBlockSize;
+  QVector<QRect> rects;
+  QVector<float> confidences;
+  for (int i = first; i < count; ++i) {
+    rects.push_back(at(i));
+    confidences.push_back(confidence(i));
+  }
+  for (int c = 0; c < kNbColumns; ++c) {
+    data_[c].truncate(qFromLittleEndian<quint32>(
+                        reinterpret_cast<const uchar *>(
+                          offsets_[c].constData()) + 4 * block));
+    offsets_[c].truncate(4 * block);
+  }
+  confidences_.truncate(first);
+  count_ = first;
+  for (int i = 0; i < rects.count(); ++i) {
+    Append(rects.at(i), confidences.at(i));
+  }
+}
+
+bool TrackStore::IsMapped() const {
+  return map_ != nullptr;
+}
+
+void TrackStore::Detach() {
+  if (!IsMapped()) return;
+  QByteArray data(reinterpret_cast<const char *>(map_), map_size_);
+  Unmap();
+  Deserialize(data);
+}
+
+bool TrackStore::IsMappedFrom(const QString &path, qint64 offset) const {
+  return IsMapped() && map_offset_ == offset && file_->fileName() == path;
+}
+
+bool TrackStore::Map(const QString &path, qint64 offset, qint64 size) {
+  QFile *file = new QFile(path);
+  uchar *map = nullptr;
+  if (file->open(QIODevice::ReadOnly)) {
+    map = file->map(offset, size);
+  }
+  View view;
+  int count = 0;
+  if (map == nullptr || !ParseView(map, size, &view, &count)) {
+    delete file;  // Also unmaps.
+    return false;
+  }
+
+  Clear();
+  file_ = file;
+  map_ = map;
+  map_offset_ = offset;
+  map_size_ = size;
+  map_view_ = view;
+  count_ = count;
+  return true;
+}
+
+// Layout (little-endian):
+//   quint32 count
+//   uchar confidences[count]
+//   for each column:
+//     quint32 size
+//     quint32 offsets[nb_blocks]
+//     uchar data[size]
+QByteArray TrackStore::Serialize() const {
+  if (IsMapped())
+    return QByteArray(reinterpret_cast<const char *>(map_), map_size_);
+
+  QByteArray out;
+  uchar word[4];
+  qToLittleEndian<quint32>(count_, word);
+  out.append(reinterpret_cast<const char *>(word), 4);
+  out.append(confidences_);
+  for (int c = 0; c < kNbColumns; ++c) {
+    qToLittleEndian<quint32>(data_[c].size(), word);
+    out.append(reinterpret_cast<const char *>(word), 4);
+    out.append(offsets_[c]);
+    out.append(data_[c]);
+  }
+  return out;
+}
+
+bool TrackStore::Deserialize(const QByteArray &data) {
+  Clear();
+  View view;
+  int count = 0;
+  if (!ParseView(reinterpret_cast<const uchar *>(data.constData()),
+                 data.size(), &view, &count)) {
+    return false;
+  }
+
+  int nb_blocks = (count + kBlockSize - 1) / kBlockSize;
+  confidences_ = QByteArray(reinterpret_cast<const char *>(view.confidences),
+                            count);
+  for (int c = 0; c < kNbColumns; ++c) {
+    offsets_[c] = QByteArray(reinterpret_cast<const char *>(view.offsets[c]),
+                             4 * nb_blocks);
+    data_[c] = QByteArray(reinterpret_cast<const char *>(view.data[c]),
+                          view.sizes[c]);
+    if (count > 0) last_[c] = Decode(view, static_cast<Column>(c), count - 1);
+  }
+  count_ = count;
+  return true;
+}
+
+TrackStore::View TrackStore::GetView() const {
+  if (IsMapped()) return map_view_;
+
+  View view;
+  view.confidences = reinterpret_cast<const uchar *>(confidences_.constData());
+  for (int c = 0; c < kNbColumns; ++c) {
+    view.offsets[c] = reinterpret_cast<const uchar *>(offsets_[c].constData());
+    view.data[c] = reinterpret_cast<const uchar *>(data_[c].constData());
+    view.sizes[c] = data_[c].size();
+  }
+  return view;
+}
+
+bool TrackStore::ParseView(const uchar *data, qint64 size, View *view,
+                           int *count) {
+  const uchar *p = data;
+  const uchar *end = data + size;
+
+  if (end - p < 4) return false;
+  quint32 n = qFromLittleEndian<quint32>(p);
+  p += 4;
+  if (n > 0x7FFFFFFF || end - p < static_cast<qint64>(n)) return false;
+  view->confidences = p;
+  p += n;
+
+  qint64 nb_blocks = (static_cast<qint64>(n) + kBlockSize - 1) / kBlockSize;
+  for (int c = 0; c < kNbColumns; ++c) {
+    if (end - p < 4) return false;
+    quint32 column_size = qFromLittleEndian<quint32>(p);
+    p += 4;
+    if (end - p < 4 * nb_blocks) return false;
+    view->offsets[c] = p;
+    p += 4 * nb_blocks;
+    if (end - p < static_cast<qint64>(column_size)) return false;
+    view->data[c] = p;
+    view->sizes[c] = column_size;
+    p += column_size;
+
+    // Decode() and Cursor read varints without bounds: check once that every
+    // value of every block ends before the next block.
+    for (qint64 b = 0; b < nb_blocks; ++b) {
+      const uchar *offset = view->offsets[c] + 4 * b;
+      quint32 start = qFromLittleEndian<quint32>(offset);
+      quint32 stop = (b + 1 < nb_blocks) ?
+                     qFromLittleEndian<quint32>(offset + 4) : column_size;
+      if (start >= stop || stop > column_size) return false;
+      const uchar *q = view->data[c] + start;
+      qint64 nb_values = qMin<qint64>(kBlockSize, n - b * kBlockSize);
+      for (qint64 k = 0; k < nb_values; ++k) {
+        if (!SkipVarint(&q, view->data[c] + stop)) return false;
+      }
+    }
+  }
+
+  *count = static_cast<int>(n);
+  return true;
+}
+
+int TrackStore::Decode(const View &view, Column c, int i) const {
+  int block = i / kBlockSize;
+  const uchar *p = view.data[c] +
+      qFromLittleEndian<quint32>(view.offsets[c] + 4 * block);
+  qint32 value = GetVarint(&p);
+  for (int k = i % kBlockSize; k > 0; --k) value += GetVarint(&p);
+  return value;
+}
+
+void TrackStore::Unmap() {
+  if (file_ != nullptr) {
+    if (map_ != nullptr) file_->unmap(map_);
+    delete file_;
+  }
+  file_ = nullptr;
+  map_ = nullptr;
+  map_offset_ = 0;
+  map_size_ = 0;
+}
+
+void TrackStore::PutVarint(QByteArray *out, qint32 value) {
+  // Zigzag encoding so that small negative deltas stay short.
+  quint32 z = (static_cast<quint32>(value) << 1) ^
+              static_cast<quint32>(value >> 31);
+  while (z >= 0x80) {
+    out->append(static_cast<char>((z & 0x7F) | 0x80));
+    z >>= 7;
+  }
+  out->append(static_cast<char>(z));
+}
+
+qint32 TrackStore::GetVarint(const uchar **p) {
+  quint32 z = 0;
+  int shift = 0;
+  uchar byte;
+  do {
+    byte = *(*p)++;
+    z |= static_cast<quint32>(byte & 0x7F) << shift;
+    shift += 7;
+  } while ((byte & 0x80) && shift < 35);
+  return static_cast<qint32>((z >> 1) ^ (0u - (z & 1)));
+}
+
+bool TrackStore::SkipVarint(const uchar **p, const uchar *end) {
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (*p >= end) return false;
+    if (!(*(*p)++ & 0x80)) return true;
+  }
+  return true;
+}
+
+TrackStore::Cursor::Cursor(const TrackStore &store) :
+  view_(store.GetView()), count_(store.count()), index_(0) {
+  for (int c = 0; c < kNbColumns; ++c) {
+    p_[c] = nullptr;
+    values_[c] = 0;
+  }
+}
+
+bool TrackStore::Cursor::Next(QRect *rect, float *confidence) {
+  if (index_ >= count_) return false;
+
+  int k = index_ % kBlockSize;
+  for (int c = 0; c < kNbColumns; ++c) {
+    if (k == 0) {
+      p_[c] = view_.data[c] + qFromLittleEndian<quint32>(
+                view_.offsets[c] + 4 * (index_ / kBlockSize));
+      values_[c] = GetVarint(&p_[c]);
+    } else {
+      values_[c] += GetVarint(&p_[c]);
+    }
+  }
+  *rect = QRect(values_[kX], values_[kY], values_[kWidth], values_[kHeight]);
+  if (confidence != nullptr) *confidence = view_.confidences[index_] / 255.0f;
+  ++index_;
+  return true;
+}
+
+}  // namespace Multitrack
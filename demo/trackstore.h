@@ -0,0 +1,123 @@
+// trackstore.h
+//
+// Compact columnar storage of tracking results.
+//
+// Each of x, y, width and height is stored in its own column, split in blocks
+// of kBlockSize frames. The first value of a block is stored as is and the
+// following ones as deltas to their predecessor, all zigzag varint-encoded.
+// A per-block offset table makes random access O(kBlockSize) = O(1).
+// Confidences are quantized to one byte per frame.
+//
+// A store is either built in memory (Append) or mapped read-only from a
+// region of a file (Map). Mapped stores are detached into memory on the first
+// modification.
+
+#ifndef MULTITRACK_TRACKSTORE_H
+#define MULTITRACK_TRACKSTORE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QRect>
+#include <QString>
+
+namespace Multitrack {
+
+class TrackStore {
+public:
+  TrackStore();
+  ~TrackStore();
+
+  // Number of frames per block.
+  static const int kBlockSize = 64;
+
+  int count() const;
+  bool isEmpty() const;
+
+  QRect at(int i) const;
+  float confidence(int i) const;  // In [0;1].
+
+  // Sequential reader, cheaper than at() when visiting every frame.
+  class Cursor;
+
+  void Append(const QRect &rect, float confidence = 1.0f);
+  void Clear();
+
+  // Keep only the first count results.
+  void Truncate(int count);
+
+  // Whether the encoded data currently lives in a file mapping.
+  bool IsMapped() const;
+
+  // Copy mapped data into memory and release the mapping.
+  void Detach();
+
+  // Whether the data is mapped from path at offset.
+  bool IsMappedFrom(const QString &path, qint64 offset) const;
+
+  // Map size bytes of path starting at offset. The region must contain data
+  // produced by Serialize(). Return false if the file cannot be mapped or the
+  // data is invalid, in which case the store is left unchanged.
+  bool Map(const QString &path, qint64 offset, qint64 size);
+
+  QByteArray Serialize() const;
+  bool Deserialize(const QByteArray &data);
+
+private:
+  enum Column { kX = 0, kY, kWidth, kHeight, kNbColumns };
+
+  // Read-only view over the encoded data, wherever it lives.
+  struct View {
+    const uchar *confidences;
+    const uchar *offsets[kNbColumns];  // Little-endian quint32 per block.
+    const uchar *data[kNbColumns];
+    quint32 sizes[kNbColumns];  // Size of each column data.
+  };
+
+  View GetView() const;
+  static bool ParseView(const uchar *data, qint64 size, View *view,
+                        int *count);
+  int Decode(const View &view, Column c, int i) const;
+  void Unmap();
+
+  static void PutVarint(QByteArray *out, qint32 value);
+  static qint32 GetVarint(const uchar **p);
+  // Move past a varint ending before end. Return false if it does not.
+  static bool SkipVarint(const uchar **p, const uchar *end);
+
+  int count_;
+
+  // In-memory representation.
+  QByteArray confidences_;
+  QByteArray offsets_[kNbColumns];  // Little-endian quint32 per block.
+  QByteArray data_[kNbColumns];
+  qint32 last_[kNbColumns];  // Last appended value of each column.
+
+  // Mapped representation.
+  QFile *file_;
+  uchar *map_;
+  qint64 map_offset_;
+  qint64 map_size_;
+  View map_view_;
+
+  Q_DISABLE_COPY(TrackStore)
+};
+
+class TrackStore::Cursor {
+public:
+  // The store must not be modified while the cursor is in use.
+  explicit Cursor(const TrackStore &store);
+
+  // Read the next result. Return false after the last one.
+  bool Next(QRect *rect, float *confidence);
+
+private:
+  TrackStore::View view_;
+  int count_;
+  int index_;
+  const uchar *p_[TrackStore::kNbColumns];
+  qint32 values_[TrackStore::kNbColumns];
+};
+
+}  // namespace Multitrack
+
+#endif  // MULTITRACK_TRACKSTORE_H
@@ -0,0 +1,206 @@
+/*!
+ * \file main.cpp
+ * \brief Command-line batch tracker.
+ *
+ * Usage: `Tracklib <job file> [-j <cores>] [-o <output directory>] [-r]
+ * [-c <cache directory> [-m <cache megabytes>]]`.
+ * With `-r`, jobs resume from their last checkpoint.
+ * With `-c`, videos are decoded once into a FrameCache in the given directory,
+ * of at most the given size (default 4096 MB), and read from it by later runs.
+ * See LoadBatchJobs() for the format of job files and BatchRunner for the
+ * output files. A timing report is written to `<output directory>/report.csv`.
+ *
+ * Usage: `Tracklib -s <sweep file> [-j <cores>] [-o <output directory>]
+ * [-a <success rate>] [-c <cache directory> [-m <cache megabytes>]]`.
+ * Runs every configuration of a sweep (see LoadSweep()) and writes their
+ * speed and accuracy to `<output directory>/sweep.csv`. The fastest
+ * configuration with at least the given success rate (default 0) is printed.
+ * When the sweep runs configurations both without and with adaptive detection
+ * (`adaptive_detection: [ 0, 1 ]`), the speedup and accuracy loss of adaptive
+ * detection are written to `<output directory>/adaptive.csv`.
+ *
+ * Both print how many of the buffers of per-frame matrices were reused from
+ * the MatPool rather than allocated. The batch tracker resets these counters
+ * once every job is past its first frames, so that they count the buffers
+ * allocated by steady-state tracking only. Temporaries that OpenCV functions
+ * allocate themselves (e.g. in matchTemplate() and calcBackProject()) do not
+ * go through the pool and are not counted.
+ *
+ * Usage: `Tracklib -b <benchmark>`.
+ * Runs a microbenchmark (see RunBenchmark()), or all of them with `all`.
+ * \author Joachim Valente <joachim.valente@gmail.com>
+ */
+
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tracklib.h"
+#include "tl_benchmarks/benchmarks.h"
+
+using namespace tl;
+
+namespace {
+
+void PrintUsage(const char *program) {
+  std::cerr << "Usage: " << program <<
+               " <job file> [-j <cores>] [-o <output directory>] [-r]"
+               " [-c <cache directory> [-m <cache megabytes>]]" << std::endl;
+  std::cerr << "       " << program <<
+               " -s <sweep file> [-j <cores>] [-o <output directory>]"
+               " [-a <success rate>]"
+               " [-c <cache directory> [-m <cache megabytes>]]" << std::endl;
+  std::cerr << "       " << program << " -b <benchmark>, among: all";
+  for (const std::string &name : BenchmarkNames()) std::cerr << ", " << name;
+  std::cerr << std::endl;
+}
+
+int RunBenchmarks(const std::string &name) {
+  std::vector<std::string> names = BenchmarkNames();
+  if (name != "all") names.assign(1, name);
+  for (const std::string &benchmark : names) {
+    std::string error;
+    if (!RunBenchmark(benchmark, &error)) {
+      std::cerr << error << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
+
+void PrintPoolStats(const std::string &scope) {
+  MatPoolStats stats = MatPool::Instance().stats();
+  INFO(scope << ": " << stats.nb_reused << " of " << stats.nb_allocations <<
+       " buffers reused, " << stats.nb_system_allocations << " allocated, " <<
+       stats.bytes_cached / (1 << 20) << " MB kept");
+}
+
+int RunSweep(const std::string &sweep_path,
+             const std::string &output_directory, int nb_cores,
+             double min_success_rate, const std::string &cache_directory,
+             int64 cache_bytes) {
+  std::vector<BatchJob> configurations;
+  std::string reference_path;
+  std::string error;
+  if (!LoadSweep(sweep_path, &configurations, &reference_path, &error)) {
+    std::cerr << error << std::endl;
+    return EXIT_FAILURE;
+  }
+  Track reference;
+  if (!reference_path.empty() && !reference.Load(reference_path, &error)) {
+    std::cerr << error << std::endl;
+    return EXIT_FAILURE;
+  }
+  INFO(configurations.size() << " configurations on " << nb_cores <<
+       " cores");
+
+  SweepRunner runner(configurations, nb_cores);
+  runner.set_reference(reference);
+  runner.set_frame_cache(cache_directory, cache_bytes);
+  bool ok = runner.Run(&error);
+  if (!ok) std::cerr << error << std::endl;
+  PrintPoolStats("matrix pool");
+
+  std::string report_path = output_directory + "/sweep.csv";
+  if (!runner.WriteReports(report_path)) {
+    std::cerr << "could not write " << report_path << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  bool fixed = false;
+  bool adaptive = false;
+  for (const BatchJob &configuration : configurations) {
+    (configuration.adaptive_detection ? adaptive : fixed) = true;
+  }
+  std::string comparison_path = output_directory + "/adaptive.csv";
+  if (fixed && adaptive && !runner.WriteAdaptiveComparison(comparison_path)) {
+    std::cerr << "could not write " << comparison_path << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int fastest = runner.Fastest(min_success_rate);
+  if (fastest >= 0) {
+    const SweepReport &report = runner.reports()[fastest];
+    INFO("fastest with success rate >= " << min_success_rate << ": " <<
+         report.name << " (" << report.nb_frames / report.track_seconds <<
+         " fps, success rate " << report.evaluation.success_rate << ")");
+  } else {
+    INFO("no configuration with success rate >= " << min_success_rate);
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::string job_path;
+  std::string output_directory = ".";
+  int nb_cores = static_cast<int>(std::thread::hardware_concurrency());
+  bool resume = false;
+  bool sweep = false;
+  double min_success_rate = 0;
+  std::string cache_directory;
+  int cache_megabytes = 4096;
+  std::string benchmark;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-j" && i + 1 < argc) {
+      nb_cores = std::atoi(argv[++i]);
+    } else if (arg == "-o" && i + 1 < argc) {
+      output_directory = argv[++i];
+    } else if (arg == "-r") {
+      resume = true;
+    } else if (arg == "-s") {
+      sweep = true;
+    } else if (arg == "-a" && i + 1 < argc) {
+      min_success_rate = std::atof(argv[++i]);
+    } else if (arg == "-c" && i + 1 < argc) {
+      cache_directory = argv[++i];
+    } else if (arg == "-m" && i + 1 < argc) {
+      cache_megabytes = std::atoi(argv[++i]);
+    } else if (arg == "-b" && i + 1 < argc) {
+      benchmark = argv[++i];
+    } else if (job_path.empty() && !arg.empty() && arg[0] != '-') {
+      job_path = arg;
+    } else {
+      PrintUsage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (!benchmark.empty()) return RunBenchmarks(benchmark);
+  if (job_path.empty() || nb_cores < 0 || cache_megabytes < 0) {
+    PrintUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (nb_cores == 0) nb_cores = 1;
+  int64 cache_bytes = static_cast<int64>(cache_megabytes) << 20;
+
+  if (sweep) {
+    return RunSweep(job_path, output_directory, nb_cores, min_success_rate,
+                    cache_directory, cache_bytes);
+  }
+
+  std::vector<BatchJob> jobs;
+  std::string error;
+  if (!LoadBatchJobs(job_path, &jobs, &error)) {
+    std::cerr << error << std::endl;
+    return EXIT_FAILURE;
+  }
+  INFO(jobs.size() << " jobs on " << nb_cores << " cores");
+
+  BatchRunner runner(jobs, nb_cores);
+  runner.set_output_directory(output_directory);
+  runner.set_resume(resume);
+  runner.set_frame_cache(cache_directory, cache_bytes);
+  bool ok = runner.Run();
+  PrintPoolStats("matrix pool past the first frames");
+
+  std::string report_path = output_directory + "/report.csv";
+  if (!runner.WriteReports(report_path)) {
+    std::cerr << "could not write " << report_path << std::endl;
+    return EXIT_FAILURE;
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
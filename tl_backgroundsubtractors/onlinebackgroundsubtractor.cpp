@@ -2,19 +2,92 @@
 
 namespace tl {
 
+namespace {
+
+/*
+ * OpenCV subtractors keep their model in protected members. These classes
+ * only add access to them so that the model can be saved and restored.
+ */
+class MOG : public cv::BackgroundSubtractorMOG {
+public:
+  void SaveModel(SnapshotWriter *writer) const {
+    writer->WriteInt(frameSize.width);
+    writer->WriteInt(frameSize.height);
+    writer->WriteInt(frameType);
+    writer->WriteInt(nframes);
+    writer->WriteMat(bgmodel);
+  }
+
+  bool LoadModel(SnapshotReader *reader) {
+    int width = 0;
+    int height = 0;
+    int type = 0;
+    int nb_frames = 0;
+    cv::Mat model;
+    if (!reader->ReadInt(&width) || !reader->ReadInt(&height) ||
+        !reader->ReadInt(&type) || !reader->ReadInt(&nb_frames) ||
+        !reader->ReadMat(&model)) {
+      return false;
+    }
+    frameSize = cv::Size(width, height);
+    frameType = type;
+    nframes = nb_frames;
+    bgmodel = model;
+    return true;
+  }
+};
+
+class MOG2 : public cv::BackgroundSubtractorMOG2 {
+public:
+  void SaveModel(SnapshotWriter *writer) const {
+    writer->WriteInt(frameSize.width);
+    writer->WriteInt(frameSize.height);
+    writer->WriteInt(frameType);
+    writer->WriteInt(nframes);
+    writer->WriteMat(bgmodel);
+    writer->WriteMat(bgmodelUsedModes);
+  }
+
+  bool LoadModel(SnapshotReader *reader) {
+    int width = 0;
+    int height = 0;
+    int type = 0;
+    int nb_frames = 0;
+    cv::Mat model;
+    cv::Mat used_modes;
+    if (!reader->ReadInt(&width) || !reader->ReadInt(&height) ||
+        !reader->ReadInt(&type) || !reader->ReadInt(&nb_frames) ||
+        !reader->ReadMat(&model) || !reader->ReadMat(&used_modes)) {
+      return false;
+    }
+    frameSize = cv::Size(width, height);
+    frameType = type;
+    nframes = nb_frames;
+    bgmodel = model;
+    bgmodelUsedModes = used_modes;
+    return true;
+  }
+};
+
+}  // namespace
+
 OnlineBackgroundSubtractor::OnlineBackgroundSubtractor(
     const cv::Mat &initial_frame,
     BackgroundSubtractionMethod method) :
-  BackgroundSubtractor(initial_frame) {
+  BackgroundSubtractor(initial_frame),
+  method_(method),
+  opencv_bgs_(nullptr),
+  cleanup_radius_(0),
+  packed_background_() {
   switch(method) {
     case TL_GMG:
       opencv_bgs_ = new cv::BackgroundSubtractorGMG;
       break;
     case TL_MOG:
-      opencv_bgs_ = new cv::BackgroundSubtractorMOG;
+      opencv_bgs_ = new MOG;
       break;
     case TL_MOG2:
-      opencv_bgs_ = new cv::BackgroundSubtractorMOG2;
+      opencv_bgs_ = new MOG2;
       break;
   }
 }
@@ -23,8 +96,52 @@ OnlineBackgroundSubtractor::~OnlineBackgroundSubtractor() {
   delete opencv_bgs_;
 }
 
+void OnlineBackgroundSubtractor::set_cleanup_radius(int radius) {
+  CHECK(radius >= 0);
+  cleanup_radius_ = radius;
+  if (radius == 0) packed_background_ = BitMask();
+}
+
+const BitMask &OnlineBackgroundSubtractor::packed_background() const {
+  return packed_background_;
+}
+
+bool OnlineBackgroundSubtractor::SaveState(SnapshotWriter *writer) const {
+  if (method_ == TL_GMG) return false;  // Model is private in OpenCV.
+
+  BackgroundSubtractor::SaveState(writer);
+  writer->WriteInt(method_);
+  if (method_ == TL_MOG) {
+    static_cast<const MOG *>(opencv_bgs_)->SaveModel(writer);
+  } else {
+    static_cast<const MOG2 *>(opencv_bgs_)->SaveModel(writer);
+  }
+  return true;
+}
+
+bool OnlineBackgroundSubtractor::LoadState(SnapshotReader *reader) {
+  int method = 0;
+  if (!BackgroundSubtractor::LoadState(reader) || !reader->ReadInt(&method) ||
+      method != method_) {
+    return false;
+  }
+  if (method_ == TL_MOG) {
+    return static_cast<MOG *>(opencv_bgs_)->LoadModel(reader);
+  } else if (method_ == TL_MOG2) {
+    return static_cast<MOG2 *>(opencv_bgs_)->LoadModel(reader);
+  }
+  return false;
+}
+
 void OnlineBackgroundSubtractor::Compute() {
   (*opencv_bgs_)(frame_, background_);
+  if (cleanup_radius_ == 0) return;
+
+  // Shadows marked by MOG2 (127) are background.
+  packed_background_.Pack(background_, 127);
+  packed_background_.Open(cleanup_radius_, &packed_background_);
+  packed_background_.Close(cleanup_radius_, &packed_background_);
+  packed_background_.ToMat(&background_);
 }
 
 }  // namespace tl
@@ -12,6 +12,7 @@
 
 #include "common.h"
 #include "tl_core/backgroundsubtractor.h"
+#include "tl_util/bitmask.h"
 
 namespace tl {
 
@@ -29,11 +30,39 @@ public:
 
   ~OnlineBackgroundSubtractor();
 
+  //----------------------------- Cleanup -----------------------------
+  /*!
+   * \brief Clean the mask computed by OpenCV with an opening then a closing
+   * by squares of side 2 * radius + 1, done on a bit-packed copy of the mask
+   * [def. 0, no cleanup]. Shadows marked by TL_MOG2 are then left out.
+   */
+  void set_cleanup_radius(int radius);
+
+  /*!
+   * \brief Get the cleaned mask, packed (empty if there is no cleanup).
+   */
+  const BitMask &packed_background() const;
+
+  //----------------------------- Snapshot ----------------------------
+  /*!
+   * \copydoc BackgroundSubtractor::SaveState(SnapshotWriter*) const
+   * \note The model of TL_GMG cannot be saved.
+   */
+  bool SaveState(SnapshotWriter *writer) const;
+
+  /*!
+   * \copydoc BackgroundSubtractor::LoadState(SnapshotReader*)
+   */
+  bool LoadState(SnapshotReader *reader);
+
 private:
   //----------------------- Compute background ------------------------
   void Compute();
 
+  BackgroundSubtractionMethod method_;  //!< Method of opencv_bgs_.
   cv::BackgroundSubtractor *opencv_bgs_;
+  int cleanup_radius_;                  //!< Radius of the cleanup, 0 if none.
+  BitMask packed_background_;           //!< Cleaned mask.
 
   DISALLOW_COPY_AND_ASSIGN(OnlineBackgroundSubtractor);
 };
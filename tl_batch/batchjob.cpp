@@ -0,0 +1,315 @@
+#include "tl_batch/batchjob.h"
+
+#include <climits>
+#include <sstream>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "tl_backgroundsubtractors/onlinebackgroundsubtractor.h"
+#include "tl_detectors/meanshiftdetector.h"
+#include "tl_detectors/templatematchingdetector.h"
+#include "tl_filters/constantvelocityfilter.h"
+#include "tl_filters/kalmanfilter.h"
+
+using namespace cv;
+
+namespace tl {
+
+namespace {
+
+// Read a sequence of numbers, or a single number.
+std::vector<float> ReadNumbers(const FileNode &node) {
+  std::vector<float> numbers;
+  if (node.isSeq()) {
+    for (size_t i = 0; i < node.size(); ++i) {
+      numbers.push_back(static_cast<float>(node[static_cast<int>(i)]));
+    }
+  } else if (node.isInt() || node.isReal()) {
+    numbers.push_back(static_cast<float>(node));
+  }
+  return numbers;
+}
+
+bool IsIndex(float value, int count) {
+  return value >= 0 && value < count && value == static_cast<int>(value);
+}
+
+}  // namespace
+
+//--------------------------- Constructors --------------------------
+BatchJob::BatchJob() :
+  name(),
+  video(),
+  frames(),
+  first_frame(1),
+  last_frame(0),
+  object(),
+  checkpoint_interval(0),
+  algorithm(TL_BATCH_TEMPLATE_MATCHING),
+  params(),
+  filter(TL_BATCH_NO_FILTER),
+  filter_params(),
+  bgs(TL_BATCH_NO_BGS),
+  bgs_params(),
+  adaptive_detection(false) {}
+
+JobTracker::JobTracker(const BatchJob &job, const Mat &frame) :
+  detector_(),
+  filter_(),
+  bgs_(),
+  tracker_() {
+  switch (job.algorithm) {
+    case TL_BATCH_TEMPLATE_MATCHING:
+    {
+      const int methods[] = {CV_TM_SQDIFF, CV_TM_SQDIFF_NORMED,
+                             CV_TM_CCORR, CV_TM_CCORR_NORMED,
+                             CV_TM_CCOEFF, CV_TM_CCOEFF_NORMED};
+      TemplateMatchingDetector *m_detector =
+          new TemplateMatchingDetector(frame, job.object);
+      m_detector->set_opencv_method(methods[static_cast<int>(job.params[0])]);
+      if (job.params.size() > 1) {
+        m_detector->set_scales(std::vector<double>(job.params.begin() + 1,
+                                                   job.params.end()));
+      }
+      detector_.reset(m_detector);
+      break;
+    }
+    case TL_BATCH_MEANSHIFT:
+    {
+      const Channels channels[] = {TL_H, TL_S, TL_HS, TL_GRAY};
+      MeanshiftDetector *m_detector =
+          new MeanshiftDetector(frame, job.object);
+      m_detector->set_variant(
+            static_cast<MeanshiftVariant>(static_cast<int>(job.params[0])));
+      m_detector->set_channels_to_use(
+            channels[static_cast<int>(job.params[1])]);
+      m_detector->set_max_iter(static_cast<int>(job.params[2]));
+      detector_.reset(m_detector);
+      break;
+    }
+    default:
+      DIE_MSG("invalid algorithm");
+  }
+  tracker_.set_detector(detector_.get());
+  tracker_.set_adaptive_detection(job.adaptive_detection);
+
+  switch (job.filter) {
+    case TL_BATCH_KALMAN_FILTER:
+    {
+      // The closed-form filter runs the same model, unless the generic one is
+      // needed for its steady-state mode.
+      if (job.filter_params.size() > 2 && job.filter_params[2] != 0) {
+        KalmanFilter *k_filter = new KalmanFilter(job.object,
+                                                  job.filter_params[0],
+                                                  job.filter_params[1]);
+        k_filter->set_steady_state(true);
+        filter_.reset(k_filter);
+      } else {
+        filter_.reset(new ConstantVelocityFilter(job.object,
+                                                 job.filter_params[0],
+                                                 job.filter_params[1]));
+      }
+      tracker_.set_filter(filter_.get());
+      break;
+    }
+    case TL_BATCH_NO_FILTER:
+    default:
+      break;
+  }
+
+  switch (job.bgs) {
+    case TL_BATCH_ONLINE_BGS:
+    {
+      OnlineBackgroundSubtractor *o_bgs = new OnlineBackgroundSubtractor(
+          frame, static_cast<BackgroundSubtractionMethod>(
+            static_cast<int>(job.bgs_params[0])));
+      if (job.bgs_params.size() > 1)
+        o_bgs->set_cleanup_radius(static_cast<int>(job.bgs_params[1]));
+      bgs_.reset(o_bgs);
+      tracker_.set_bgs(bgs_.get());
+      break;
+    }
+    case TL_BATCH_NO_BGS:
+    default:
+      break;
+  }
+}
+
+//------------------------ Public accessors ------------------------
+Tracker &JobTracker::tracker() {
+  return tracker_;
+}
+
+//--------------------------- Job file -----------------------------
+std::string ResolveBatchPath(const std::string &directory,
+                             const std::string &path) {
+  if (path.empty() || path[0] == '/' || directory.empty()) return path;
+  return directory + "/" + path;
+}
+
+void ReadBatchJob(const FileNode &node, const std::string &directory,
+                  BatchJob *job) {
+  CHECK_NOTNULL(job);
+  if (node["name"].isString())
+    job->name = static_cast<std::string>(node["name"]);
+
+  if (node["video"].isString()) {
+    job->video = ResolveBatchPath(directory,
+                                  static_cast<std::string>(node["video"]));
+  }
+  FileNode frames = node["frames"];
+  for (size_t f = 0; frames.isSeq() && f < frames.size(); ++f) {
+    job->frames.push_back(ResolveBatchPath(
+        directory, static_cast<std::string>(frames[static_cast<int>(f)])));
+  }
+
+  if (!node["first_frame"].empty())
+    job->first_frame = static_cast<int>(node["first_frame"]);
+  if (!node["last_frame"].empty())
+    job->last_frame = static_cast<int>(node["last_frame"]);
+
+  if (!node["checkpoint_interval"].empty())
+    job->checkpoint_interval = static_cast<int>(node["checkpoint_interval"]);
+
+  std::vector<float> object = ReadNumbers(node["object"]);
+  if (object.size() == 4) {
+    job->object = Rect(cvRound(object[0]), cvRound(object[1]),
+                       cvRound(object[2]), cvRound(object[3]));
+  }
+
+  if (!node["algorithm"].empty()) {
+    job->algorithm = static_cast<BatchAlgorithm>(
+                       static_cast<int>(node["algorithm"]));
+  }
+  if (!node["params"].empty())
+    job->params = ReadNumbers(node["params"]);
+  if (!node["filter"].empty())
+    job->filter = static_cast<BatchFilter>(static_cast<int>(node["filter"]));
+  if (!node["filter_params"].empty())
+    job->filter_params = ReadNumbers(node["filter_params"]);
+  if (!node["bgs"].empty())
+    job->bgs = static_cast<BatchBgs>(static_cast<int>(node["bgs"]));
+  if (!node["bgs_params"].empty())
+    job->bgs_params = ReadNumbers(node["bgs_params"]);
+  if (node["adaptive_detection"].isInt())
+    job->adaptive_detection = static_cast<int>(node["adaptive_detection"]) != 0;
+}
+
+std::string ValidateBatchJob(const BatchJob &job) {
+  if (job.video.empty() == job.frames.empty())
+    return "exactly one of video and frames must be given";
+  if (job.first_frame < 1)
+    return "first_frame must be at least 1";
+  if (job.last_frame != 0 && job.last_frame < job.first_frame)
+    return "last_frame must be 0 or at least first_frame";
+  if (job.object.width <= 0 || job.object.height <= 0)
+    return "object must be [ x, y, width, height ] with a positive size";
+  if (job.checkpoint_interval < 0)
+    return "checkpoint_interval must be positive or 0";
+
+  switch (job.algorithm) {
+    case TL_BATCH_TEMPLATE_MATCHING:
+      if (job.params.empty() || !IsIndex(job.params[0], 6))
+        return "template matching expects params: [ method, scales... ]";
+      for (size_t i = 1; i < job.params.size(); ++i) {
+        if (job.params[i] <= 0)
+          return "template matching scales must be positive";
+      }
+      break;
+    case TL_BATCH_MEANSHIFT:
+      if (job.params.size() != 3 || !IsIndex(job.params[0], 2) ||
+          !IsIndex(job.params[1], 4) || job.params[2] < 1)
+        return "meanshift expects params: [ variant, channels, max_iter ]";
+      break;
+    default:
+      return "algorithm must be 0 (template matching) or 1 (meanshift)";
+  }
+
+  switch (job.filter) {
+    case TL_BATCH_NO_FILTER:
+      break;
+    case TL_BATCH_KALMAN_FILTER:
+      if (job.filter_params.size() != 2 && job.filter_params.size() != 3) {
+        return "Kalman filter expects filter_params: [ q, r ] or "
+               "[ q, r, steady_state ]";
+      }
+      break;
+    default:
+      return "filter must be 0 (none) or 1 (Kalman)";
+  }
+
+  switch (job.bgs) {
+    case TL_BATCH_NO_BGS:
+      break;
+    case TL_BATCH_ONLINE_BGS:
+      if (job.bgs_params.empty() || job.bgs_params.size() > 2 ||
+          !IsIndex(job.bgs_params[0], 3) ||
+          (job.bgs_params.size() == 2 &&
+           !IsIndex(job.bgs_params[1], INT_MAX))) {
+        return "online background subtractor expects bgs_params: [ method ] "
+               "or [ method, cleanup_radius ]";
+      }
+      if (static_cast<int>(job.bgs_params[0]) == TL_GMG &&
+          job.checkpoint_interval > 0) {
+        return "GMG background subtraction cannot be checkpointed: "
+               "checkpoint_interval must be 0";
+      }
+      break;
+    default:
+      return "bgs must be 0 (none) or 1 (online)";
+  }
+
+  return "";
+}
+
+bool LoadBatchJobs(const std::string &path, std::vector<BatchJob> *jobs,
+                   std::string *error) {
+  CHECK_NOTNULL(jobs);
+  CHECK_NOTNULL(error);
+
+  FileStorage fs;
+  try {
+    fs.open(path, FileStorage::READ);
+  } catch (const cv::Exception &e) {
+    *error = path + ": " + e.what();
+    return false;
+  }
+  if (!fs.isOpened()) {
+    *error = "could not open " + path;
+    return false;
+  }
+
+  FileNode nodes = fs["jobs"];
+  if (!nodes.isSeq() || nodes.size() == 0) {
+    *error = path + ": no jobs sequence";
+    return false;
+  }
+
+  size_t slash = path.rfind('/');
+  std::string directory = (slash == std::string::npos) ?
+                            "" : path.substr(0, slash);
+
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    std::ostringstream default_name;
+    default_name << "job" << i + 1;
+    BatchJob job;
+    job.name = default_name.str();
+    ReadBatchJob(nodes[static_cast<int>(i)], directory, &job);
+
+    std::string issue = ValidateBatchJob(job);
+    if (!issue.empty()) {
+      *error = path + ": " + job.name + ": " + issue;
+      return false;
+    }
+    for (const BatchJob &other : *jobs) {
+      if (other.name == job.name) {
+        *error = path + ": " + job.name + ": name is used by several jobs";
+        return false;
+      }
+    }
+    jobs->push_back(job);
+  }
+  return true;
+}
+
+}  // namespace tl
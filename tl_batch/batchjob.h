@@ -0,0 +1,167 @@
+/*!
+ * \file batchjob.h
+ * \brief Description of a tracking job run without user interface.
+ * \author Joachim Valente <joachim.valente@gmail.com>
+ */
+
+#ifndef TL_BATCHJOB_H
+#define TL_BATCHJOB_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "common.h"
+#include "tl_core/backgroundsubtractor.h"
+#include "tl_core/detector.h"
+#include "tl_core/filter.h"
+#include "tl_core/tracker.h"
+
+namespace tl {
+
+/*!
+ * \brief Detection algorithm of a job (same values as in Multitrack).
+ */
+enum BatchAlgorithm {
+  TL_BATCH_TEMPLATE_MATCHING = 0,
+  TL_BATCH_MEANSHIFT
+};
+
+/*!
+ * \brief Filter of a job (same values as in Multitrack).
+ */
+enum BatchFilter {
+  TL_BATCH_NO_FILTER = 0,
+  TL_BATCH_KALMAN_FILTER
+};
+
+/*!
+ * \brief Background subtractor of a job (same values as in Multitrack).
+ */
+enum BatchBgs {
+  TL_BATCH_NO_BGS = 0,
+  TL_BATCH_ONLINE_BGS
+};
+
+/*!
+ * \brief Tracking of one object in one source.
+ *
+ * Parameters are given in the same order as in Multitrack:
+ * - template matching: method (0 to 5 for CV_TM_SQDIFF, CV_TM_SQDIFF_NORMED,
+ * CV_TM_CCORR, CV_TM_CCORR_NORMED, CV_TM_CCOEFF, CV_TM_CCOEFF_NORMED),
+ * optionally followed by the scales of the template to match (see
+ * TemplateMatchingDetector::set_scales()),
+ * - meanshift: variant (MeanshiftVariant), channels (0 to 3 for TL_H, TL_S,
+ * TL_HS, TL_GRAY) and maximum number of iterations,
+ * - Kalman filter: q and r, optionally followed by 1 to freeze the gain once
+ * it converges (see KalmanFilter::set_steady_state()),
+ * - online background subtractor: method (BackgroundSubtractionMethod),
+ * optionally followed by the radius of the cleanup of the mask (see
+ * OnlineBackgroundSubtractor::set_cleanup_radius()).
+ * .
+ */
+struct BatchJob {
+  //--------------------------- Constructor --------------------------
+  BatchJob();
+
+  //----------------------------- Members ----------------------------
+  std::string name;                 //!< Name, also used for the result file.
+  std::string video;                //!< Path of the video, if any.
+  std::vector<std::string> frames;  //!< Paths of the frames if no video.
+  int first_frame;                  //!< Frame where object is defined (>= 1).
+  int last_frame;                   //!< Last frame to track (0 for all).
+  cv::Rect object;                  //!< Object in the first frame.
+  int checkpoint_interval;          //!< Frames between checkpoints (0: none,
+                                    //!< required with GMG).
+
+  BatchAlgorithm algorithm;         //!< Detection algorithm.
+  std::vector<float> params;        //!< Parameters of the algorithm.
+  BatchFilter filter;               //!< Filter.
+  std::vector<float> filter_params; //!< Parameters of the filter.
+  BatchBgs bgs;                     //!< Background subtractor.
+  std::vector<float> bgs_params;    //!< Parameters of the subtractor.
+  bool adaptive_detection;          //!< Whether detection is scheduled by the
+                                    //!< uncertainty of the filter (see
+                                    //!< Tracker::set_adaptive_detection()).
+};
+
+/*!
+ * \brief Tracker of a job, with the components it owns.
+ */
+class JobTracker {
+public:
+  //--------------------------- Constructor --------------------------
+  /*!
+   * \param job Valid job.
+   * \param frame Frame where the object is defined.
+   */
+  JobTracker(const BatchJob &job, const cv::Mat &frame);
+
+  //------------------------ Public accessors ------------------------
+  Tracker &tracker();
+
+private:
+  //------------------------- Private members ------------------------
+  std::unique_ptr<Detector> detector_;
+  std::unique_ptr<Filter> filter_;
+  std::unique_ptr<BackgroundSubtractor> bgs_;
+  Tracker tracker_;
+
+  DISALLOW_COPY_AND_ASSIGN(JobTracker);
+};
+
+/*!
+ * \brief Prefix a relative path with the directory of the job file.
+ */
+std::string ResolveBatchPath(const std::string &directory,
+                             const std::string &path);
+
+/*!
+ * \brief Read the fields of a job from a node of a job file, without checking
+ * them.
+ * \param node Node of the job.
+ * \param directory Directory relative paths are resolved against.
+ * \param job Job read; missing fields keep their value.
+ */
+void ReadBatchJob(const cv::FileNode &node, const std::string &directory,
+                  BatchJob *job);
+
+/*!
+ * \brief Check the fields of a job.
+ * \return Description of the first issue, empty if the job is valid.
+ */
+std::string ValidateBatchJob(const BatchJob &job);
+
+/*!
+ * \brief Read the jobs of a job file.
+ *
+ * Job files are read with cv::FileStorage (YAML or XML) and contain a `jobs`
+ * sequence whose elements have the fields of BatchJob, e.g.:
+ * \code
+ * %YAML:1.0
+ * jobs:
+ *   - name: car
+ *     video: "car.avi"
+ *     first_frame: 1
+ *     object: [ 120, 80, 40, 30 ]
+ *     algorithm: 0
+ *     params: [ 5 ]
+ *     filter: 1
+ *     filter_params: [ 0.015, 12. ]
+ *     adaptive_detection: 1
+ *     checkpoint_interval: 500
+ * \endcode
+ * Relative paths are resolved against the directory of the job file.
+ * \param path Path of the job file.
+ * \param jobs Jobs read (appended).
+ * \param error Description of the first invalid entry, if any.
+ * \return Whether all jobs are valid.
+ */
+bool LoadBatchJobs(const std::string &path, std::vector<BatchJob> *jobs,
+                   std::string *error);
+
+}  // namespace tl
+
+#endif  // TL_BATCHJOB_H
@@ -0,0 +1,399 @@
+#include "tl_batch/batchrunner.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <opencv2/highgui/highgui.hpp>
+
+#include "tl_util/framecache.h"
+#include "tl_util/matpool.h"
+#include "tl_util/snapshot.h"
+
+using namespace cv;
+
+namespace tl {
+
+namespace {
+
+const int kCheckpointMagic = 0x4B434C54;  // "TLCK".
+const int kCheckpointVersion = 1;
+
+// Frames tracked by a job before the allocations of the matrix pool are
+// counted, while the pool and the buffers of the components fill up.
+const int kNbWarmUpFrames = 10;
+
+double Seconds(int64 ticks) {
+  return static_cast<double>(ticks) / getTickFrequency();
+}
+
+// Where a job can be resumed from.
+struct Checkpoint {
+  std::string job;              // JobKey() of the job.
+  int frame = 0;                // Last frame tracked.
+  int nb_frames = 0;            // Frames tracked until frame.
+  double decode_seconds = 0;
+  double track_seconds = 0;
+  int64 results_size = 0;       // Size of the results until frame.
+  std::string tracker;          // Tracker::SaveState() after frame.
+};
+
+// Everything that affects the results of a job. Fields of BatchJob that do
+// must be added here, or checkpoints of other settings would be resumed.
+std::string JobKey(const BatchJob &job) {
+  std::ostringstream key;
+  key << job.video << '|';
+  for (const std::string &path : job.frames) key << path << '|';
+  key << job.first_frame << '|' << job.object << '|' << job.algorithm << '|';
+  for (float param : job.params) key << param << ',';
+  key << '|' << job.filter << '|';
+  for (float param : job.filter_params) key << param << ',';
+  key << '|' << job.bgs << '|';
+  for (float param : job.bgs_params) key << param << ',';
+  key << '|' << job.adaptive_detection;
+  return key.str();
+}
+
+bool ReadFile(const std::string &path, std::string *data) {
+  std::ifstream in(path.c_str(), std::ios::binary);
+  if (!in) return false;
+  std::ostringstream content;
+  content << in.rdbuf();
+  *data = content.str();
+  return !in.bad();
+}
+
+bool ReadString(SnapshotReader *reader, std::string *value) {
+  int size = 0;
+  if (!reader->ReadInt(&size) || size < 0) return false;
+  std::string result(size, '\0');
+  if (size > 0 && !reader->ReadBytes(&result[0], size)) return false;
+  *value = result;
+  return true;
+}
+
+void WriteString(SnapshotWriter *writer, const std::string &value) {
+  writer->WriteInt(static_cast<int>(value.size()));
+  writer->WriteBytes(value.data(), value.size());
+}
+
+bool ReadCheckpoint(const std::string &path, Checkpoint *checkpoint) {
+  std::string data;
+  if (!ReadFile(path, &data)) return false;
+
+  SnapshotReader reader(data);
+  int magic = 0;
+  int version = 0;
+  Checkpoint result;
+  if (!reader.ReadInt(&magic) || magic != kCheckpointMagic ||
+      !reader.ReadInt(&version) || version != kCheckpointVersion ||
+      !ReadString(&reader, &result.job) ||
+      !reader.ReadInt(&result.frame) ||
+      !reader.ReadInt(&result.nb_frames) ||
+      !reader.ReadDouble(&result.decode_seconds) ||
+      !reader.ReadDouble(&result.track_seconds) ||
+      !reader.ReadBytes(&result.results_size, sizeof(int64)) ||
+      !ReadString(&reader, &result.tracker) || !reader.AtEnd()) {
+    return false;
+  }
+  *checkpoint = result;
+  return true;
+}
+
+// Write to a temporary file first so that a crash never leaves a truncated
+// checkpoint behind.
+bool WriteCheckpoint(const std::string &path, const Checkpoint &checkpoint) {
+  SnapshotWriter writer;
+  writer.WriteInt(kCheckpointMagic);
+  writer.WriteInt(kCheckpointVersion);
+  WriteString(&writer, checkpoint.job);
+  writer.WriteInt(checkpoint.frame);
+  writer.WriteInt(checkpoint.nb_frames);
+  writer.WriteDouble(checkpoint.decode_seconds);
+  writer.WriteDouble(checkpoint.track_seconds);
+  writer.WriteBytes(&checkpoint.results_size, sizeof(int64));
+  WriteString(&writer, checkpoint.tracker);
+
+  std::string temporary_path = path + ".tmp";
+  std::ofstream out(temporary_path.c_str(), std::ios::binary);
+  out.write(writer.data().data(), writer.data().size());
+  out.close();
+  return !out.fail() &&
+         std::rename(temporary_path.c_str(), path.c_str()) == 0;
+}
+
+}  // namespace
+
+//--------------------------- Constructors --------------------------
+BatchReport::BatchReport() :
+  name(),
+  ok(false),
+  error(),
+  nb_frames(0),
+  decode_seconds(0),
+  track_seconds(0) {}
+
+BatchRunner::BatchRunner(const std::vector<BatchJob> &jobs, int nb_cores) :
+  jobs_(jobs),
+  nb_cores_(std::max(1, nb_cores)),
+  output_directory_("."),
+  resume_(false),
+  frame_cache_directory_(),
+  frame_cache_bytes_(0),
+  reports_(jobs.size()),
+  next_job_(0),
+  nb_cold_jobs_(0),
+  log_mutex_() {}
+
+//------------------------ Public accessors ------------------------
+void BatchRunner::set_output_directory(const std::string &output_directory) {
+  output_directory_ = output_directory;
+}
+
+const std::vector<BatchReport> &BatchRunner::reports() const {
+  return reports_;
+}
+
+void BatchRunner::set_resume(bool resume) {
+  resume_ = resume;
+}
+
+void BatchRunner::set_frame_cache(const std::string &directory,
+                                  int64 max_bytes) {
+  frame_cache_directory_ = directory;
+  frame_cache_bytes_ = max_bytes;
+}
+
+//-------------------------- Main functions ------------------------
+bool BatchRunner::Run() {
+  if (jobs_.empty()) return true;
+
+  int nb_workers = std::min(nb_cores_, static_cast<int>(jobs_.size()));
+  setNumThreads(std::max(1, nb_cores_ / nb_workers));
+
+  next_job_ = 0;
+  nb_cold_jobs_ = static_cast<int>(jobs_.size());
+  std::vector<std::thread> workers;
+  for (int i = 1; i < nb_workers; ++i) {
+    workers.push_back(std::thread(&BatchRunner::Work, this));
+  }
+  Work();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+
+  for (const BatchReport &report : reports_) {
+    if (!report.ok) return false;
+  }
+  return true;
+}
+
+bool BatchRunner::WriteReports(const std::string &path) const {
+  std::ofstream out(path.c_str());
+  out << "job,status,frames,decode_seconds,track_seconds,fps,error\n";
+  for (const BatchReport &report : reports_) {
+    double fps = (report.track_seconds > 0) ?
+                   report.nb_frames / report.track_seconds : 0;
+    out << report.name << ',' << (report.ok ? "ok" : "failed") << ',' <<
+           report.nb_frames << ',' << report.decode_seconds << ',' <<
+           report.track_seconds << ',' << fps << ",\"" << report.error <<
+           "\"\n";
+  }
+  out.close();
+  return !out.fail();
+}
+
+//------------------------- Private methods ------------------------
+void BatchRunner::Work() {
+  while (true) {
+    size_t i = next_job_++;
+    if (i >= jobs_.size()) return;
+
+    BatchReport *report = &reports_[i];
+    report->name = jobs_[i].name;
+    bool warm = false;
+    try {
+      RunJob(jobs_[i], report, &warm);
+    } catch (const cv::Exception &e) {
+      report->ok = false;
+      report->error = e.what();
+    }
+    EndWarmUp(&warm);
+
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    if (report->ok) {
+      INFO(report->name << ": " << report->nb_frames << " frames in " <<
+           report->track_seconds << " s");
+    } else {
+      WARNING(report->name << ": " << report->error);
+    }
+  }
+}
+
+void BatchRunner::EndWarmUp(bool *warm) {
+  if (*warm) return;
+  *warm = true;
+  if (--nb_cold_jobs_ == 0) MatPool::Instance().ResetStats();
+}
+
+void BatchRunner::RunJob(const BatchJob &job, BatchReport *report,
+                         bool *warm) {
+  report->ok = false;
+  const std::string results_path =
+      output_directory_ + "/" + job.name + ".csv";
+  const std::string checkpoint_path =
+      output_directory_ + "/" + job.name + ".ckpt";
+
+  // Find where to start from: the results are kept up to the checkpoint.
+  Checkpoint checkpoint;
+  std::string results;
+  bool resuming = resume_ && ReadCheckpoint(checkpoint_path, &checkpoint) &&
+                  checkpoint.job == JobKey(job) &&
+                  checkpoint.frame >= job.first_frame &&
+                  ReadFile(results_path, &results) &&
+                  static_cast<int64>(results.size()) >= checkpoint.results_size;
+  if (resuming) {
+    results.resize(checkpoint.results_size);
+    report->nb_frames = checkpoint.nb_frames;
+    report->decode_seconds = checkpoint.decode_seconds;
+    report->track_seconds = checkpoint.track_seconds;
+  }
+
+  std::ofstream out(results_path.c_str(), std::ios::binary);
+  if (!out) {
+    report->error = "could not write results in " + output_directory_;
+    return;
+  }
+  out << results;
+
+  // Read the frame where the object is defined.
+  int64 start = getTickCount();
+  FrameCache cache;
+  if (!job.video.empty() && !frame_cache_directory_.empty()) {
+    cache.set_directory(frame_cache_directory_);
+    cache.set_max_bytes(frame_cache_bytes_);
+    std::string cache_error;
+    if (!cache.Open(job.video, &cache_error)) {
+      std::lock_guard<std::mutex> lock(log_mutex_);
+      WARNING(job.name << ": " << cache_error << ", decoding without cache");
+    }
+  }
+  VideoCapture capture;
+  Mat frame;
+  if (cache.is_open()) {
+    if (job.first_frame <= cache.nb_frames())
+      frame = cache.frame(job.first_frame - 1);
+  } else if (!job.video.empty()) {
+    if (!capture.open(job.video)) {
+      report->error = "could not open " + job.video;
+      return;
+    }
+    for (int i = 1; i < job.first_frame; ++i) {
+      if (!capture.grab()) break;
+    }
+    capture >> frame;
+  } else if (job.first_frame <= static_cast<int>(job.frames.size())) {
+    frame = imread(job.frames[job.first_frame - 1]);
+  }
+  report->decode_seconds += Seconds(getTickCount() - start);
+  if (frame.empty()) {
+    report->error = "could not read first frame";
+    return;
+  }
+
+  JobTracker job_tracker(job, frame);
+  Tracker &tracker = job_tracker.tracker();
+
+  // Restore the tracker and skip the frames already tracked.
+  int index = job.first_frame;
+  if (resuming && !tracker.LoadState(checkpoint.tracker)) {
+    report->error = "invalid checkpoint " + checkpoint_path;
+    return;
+  }
+  if (resuming) {
+    start = getTickCount();
+    for (index = job.first_frame; index < checkpoint.frame; ++index) {
+      bool grabbed = job.video.empty() ||
+                     (cache.is_open() ? index < cache.nb_frames() :
+                                        capture.grab());
+      if (!grabbed) {
+        report->error = "source is shorter than checkpoint";
+        return;
+      }
+    }
+    report->decode_seconds += Seconds(getTickCount() - start);
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    INFO(job.name << ": resuming after frame " << index);
+  } else {
+    out << "frame,x,y,width,height,confidence\n";
+    out << job.first_frame << ',' << job.object.x << ',' << job.object.y <<
+           ',' << job.object.width << ',' << job.object.height << ",1\n";
+  }
+
+  // Track until the end of the source.
+  bool checkpoints = job.checkpoint_interval > 0;
+  int nb_tracked = 0;
+  while (job.last_frame == 0 || index < job.last_frame) {
+    ++index;
+    start = getTickCount();
+    if (cache.is_open()) {
+      frame = (index <= cache.nb_frames()) ? cache.frame(index - 1) : Mat();
+    } else if (!job.video.empty()) {
+      capture >> frame;
+    } else if (index <= static_cast<int>(job.frames.size())) {
+      frame = imread(job.frames[index - 1]);
+      if (frame.empty()) {
+        report->error = "could not read " + job.frames[index - 1];
+        return;
+      }
+    } else {
+      frame.release();
+    }
+    report->decode_seconds += Seconds(getTickCount() - start);
+    if (frame.empty()) break;
+
+    start = getTickCount();
+    tracker.Track(frame);
+    report->track_seconds += Seconds(getTickCount() - start);
+    if (++nb_tracked == kNbWarmUpFrames) EndWarmUp(warm);
+
+    Rect state = tracker.state();
+    out << index << ',' << state.x << ',' << state.y << ',' <<
+           state.width << ',' << state.height << ',' <<
+           tracker.confidence() << '\n';
+    ++report->nb_frames;
+
+    if (checkpoints &&
+        (index - job.first_frame) % job.checkpoint_interval == 0) {
+      Checkpoint next;
+      next.job = JobKey(job);
+      next.frame = index;
+      next.nb_frames = report->nb_frames;
+      next.decode_seconds = report->decode_seconds;
+      next.track_seconds = report->track_seconds;
+      out.flush();
+      next.results_size = static_cast<int64>(out.tellp());
+      if (!tracker.SaveState(&next.tracker)) {
+        std::lock_guard<std::mutex> lock(log_mutex_);
+        WARNING(job.name << ": background subtractor cannot be saved, "
+                "checkpoints disabled");
+        checkpoints = false;
+      } else if (!out || !WriteCheckpoint(checkpoint_path, next)) {
+        report->error = "could not write " + checkpoint_path;
+        return;
+      }
+    }
+  }
+
+  out.close();
+  if (out.fail()) {
+    report->error = "could not write results of " + job.name;
+    return;
+  }
+  std::remove(checkpoint_path.c_str());
+  report->ok = true;
+}
+
+}  // namespace tl
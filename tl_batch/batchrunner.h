@@ -0,0 +1,141 @@
+/*!
+ * \file batchrunner.h
+ * \brief Run tracking jobs concurrently without user interface.
+ * \author Joachim Valente <joachim.valente@gmail.com>
+ */
+
+#ifndef TL_BATCHRUNNER_H
+#define TL_BATCHRUNNER_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "tl_batch/batchjob.h"
+
+namespace tl {
+
+/*!
+ * \brief Outcome and timings of a job.
+ */
+struct BatchReport {
+  //--------------------------- Constructor --------------------------
+  BatchReport();
+
+  //----------------------------- Members ----------------------------
+  std::string name;           //!< Name of the job.
+  bool ok;                    //!< Whether the job ran until the end.
+  std::string error;          //!< Reason of the failure, if any.
+  int nb_frames;              //!< Number of frames tracked.
+  double decode_seconds;      //!< Time spent reading and decoding frames.
+  double track_seconds;       //!< Time spent in Tracker::Track.
+};
+
+/*!
+ * \brief Run jobs on a pool of threads.
+ *
+ * Each job is run by a single thread, from the frame where its object is
+ * defined until the end of the source or its last frame. Results of job
+ * `name` are written to `<output directory>/name.csv` as rows
+ * `frame,x,y,width,height,confidence`, one per frame starting with the object.
+ *
+ * The core budget is split between the jobs running at the same time and
+ * the threads OpenCV uses inside each of them.
+ *
+ * Jobs with a checkpoint interval save the state of their tracker to
+ * `<output directory>/name.ckpt` every so many frames, removed once the job
+ * succeeded. With resume enabled, a job with a checkpoint continues from it
+ * and gives the same results as an uninterrupted run.
+ *
+ * Once every job is past its first frames, the counters of the MatPool are
+ * reset, so that after Run() they count the buffers of steady-state tracking.
+ */
+class BatchRunner {
+public:
+  //--------------------------- Constructor --------------------------
+  /*!
+   * \param jobs Jobs to run.
+   * \param nb_cores Number of cores to use (at least 1).
+   */
+  BatchRunner(const std::vector<BatchJob> &jobs, int nb_cores);
+
+  //------------------------ Public accessors ------------------------
+  /*!
+   * \brief Set the existing directory where results are written (default
+   * current directory).
+   */
+  void set_output_directory(const std::string &output_directory);
+
+  /*!
+   * \brief Reports of the jobs, in the order of the jobs.
+   */
+  const std::vector<BatchReport> &reports() const;
+
+  /*!
+   * \brief Resume jobs from their last checkpoint, if any (default false).
+   */
+  void set_resume(bool resume);
+
+  /*!
+   * \brief Read videos through a FrameCache, so that each video is decoded
+   * once for all the jobs and runs on it (default none).
+   * \param directory Existing directory of the cache, empty for none.
+   * \param max_bytes Bytes the cache may take on disk.
+   */
+  void set_frame_cache(const std::string &directory, int64 max_bytes);
+
+  //-------------------------- Main functions ------------------------
+  /*!
+   * \brief Run all jobs and wait for them.
+   * \return Whether all jobs succeeded.
+   */
+  bool Run();
+
+  /*!
+   * \brief Write the reports as rows
+   * `job,status,frames,decode_seconds,track_seconds,fps,error`.
+   * \return Whether the file could be written.
+   */
+  bool WriteReports(const std::string &path) const;
+
+private:
+  //------------------------- Private methods ------------------------
+  /*!
+   * \brief Run jobs until none is left.
+   */
+  void Work();
+
+  /*!
+   * \brief Run one job and fill its report.
+   * \param warm Set by EndWarmUp() once past the first frames.
+   */
+  void RunJob(const BatchJob &job, BatchReport *report, bool *warm);
+
+  /*!
+   * \brief Note that a job is past its first frames, or ended before, and
+   * reset the counters of the pool when it is the last one.
+   * \param warm Whether the job already was, set.
+   */
+  void EndWarmUp(bool *warm);
+
+  //------------------------- Private members ------------------------
+  std::vector<BatchJob> jobs_;        //!< Jobs to run.
+  int nb_cores_;                      //!< Core budget.
+  std::string output_directory_;      //!< Where results are written.
+  bool resume_;                       //!< Whether to resume from checkpoints.
+  std::string frame_cache_directory_; //!< Frame cache, empty if none.
+  int64 frame_cache_bytes_;           //!< Size of the frame cache.
+
+  std::vector<BatchReport> reports_;  //!< One report per job.
+  std::atomic<size_t> next_job_;      //!< Index of the next job to start.
+  std::atomic<int> nb_cold_jobs_;     //!< Jobs not past their first frames.
+  std::mutex log_mutex_;              //!< Serializes progress messages.
+
+  DISALLOW_COPY_AND_ASSIGN(BatchRunner);
+};
+
+}  // namespace tl
+
+#endif  // TL_BATCHRUNNER_H
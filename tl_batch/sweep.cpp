@@ -0,0 +1,497 @@
+#include "tl_batch/sweep.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+using namespace cv;
+
+namespace tl {
+
+namespace {
+
+// Frames decoded at once. Two chunks are in memory at the same time, and the
+// derived images of one (48 bytes per pixel for integral images of color
+// frames, plus the conversions configurations ask for).
+const size_t kChunkSize = 8;
+
+typedef std::vector<std::vector<float> > Grid;
+
+double Seconds(int64 ticks) {
+  return static_cast<double>(ticks) / getTickFrequency();
+}
+
+// Read one list of values (or a single value) per parameter.
+Grid ReadGrid(const FileNode &node) {
+  Grid grid;
+  for (size_t i = 0; node.isSeq() && i < node.size(); ++i) {
+    FileNode values = node[static_cast<int>(i)];
+    std::vector<float> parameter;
+    if (values.isSeq()) {
+      for (size_t j = 0; j < values.size(); ++j) {
+        parameter.push_back(static_cast<float>(values[static_cast<int>(j)]));
+      }
+    } else if (values.isInt() || values.isReal()) {
+      parameter.push_back(static_cast<float>(values));
+    }
+    grid.push_back(parameter);
+  }
+  return grid;
+}
+
+// Every combination of one value per parameter.
+Grid Combinations(const Grid &grid) {
+  Grid combinations(1);
+  for (const std::vector<float> &values : grid) {
+    Grid next;
+    for (const std::vector<float> &combination : combinations) {
+      for (float value : values) {
+        next.push_back(combination);
+        next.back().push_back(value);
+      }
+    }
+    combinations.swap(next);
+  }
+  return combinations;
+}
+
+// Expand the entries of a section of the grid (e.g. `filters`, whose entries
+// have fields `filter` and `filter_params`) into (type, parameters) pairs.
+// An absent section gives default_type without parameters.
+bool ReadEntries(const FileNode &node, const char *type_field,
+                 const char *params_field, int default_type,
+                 std::vector<std::pair<int, std::vector<float> > > *entries) {
+  entries->clear();
+  if (node.empty()) {
+    entries->push_back(std::make_pair(default_type, std::vector<float>()));
+    return true;
+  }
+  if (!node.isSeq()) return false;
+
+  for (size_t i = 0; i < node.size(); ++i) {
+    FileNode entry = node[static_cast<int>(i)];
+    int type = static_cast<int>(entry[type_field]);
+    Grid combinations = Combinations(ReadGrid(entry[params_field]));
+    if (combinations.empty()) return false;
+    for (const std::vector<float> &params : combinations) {
+      entries->push_back(std::make_pair(type, params));
+    }
+  }
+  return !entries->empty();
+}
+
+// Short name listing the parameters of a valid configuration.
+std::string ConfigurationName(const BatchJob &job) {
+  const char *algorithms[] = {"tm", "ms"};
+  std::ostringstream name;
+  name << algorithms[job.algorithm];
+  for (float param : job.params) name << '_' << param;
+  if (job.filter == TL_BATCH_KALMAN_FILTER) {
+    name << "-kalman";
+    for (float param : job.filter_params) name << '_' << param;
+  }
+  if (job.bgs == TL_BATCH_ONLINE_BGS) {
+    name << "-bgs";
+    for (float param : job.bgs_params) name << '_' << param;
+  }
+  if (job.adaptive_detection) name << "-adaptive";
+  return name.str();
+}
+
+// Whether two configurations differ only by adaptive detection, if at all.
+bool SameComponents(const BatchJob &a, const BatchJob &b) {
+  return a.algorithm == b.algorithm && a.params == b.params &&
+         a.filter == b.filter && a.filter_params == b.filter_params &&
+         a.bgs == b.bgs && a.bgs_params == b.bgs_params;
+}
+
+double Fps(const SweepReport &report) {
+  return (report.track_seconds > 0) ?
+           report.nb_frames / report.track_seconds : 0;
+}
+
+}  // namespace
+
+//--------------------------- Constructors --------------------------
+SweepReport::SweepReport() :
+  name(),
+  error(),
+  nb_frames(0),
+  track_seconds(0),
+  nb_skipped(0),
+  nb_local(0),
+  evaluation() {}
+
+SweepRunner::SweepRunner(const std::vector<BatchJob> &configurations,
+                         int nb_cores) :
+  configurations_(configurations),
+  nb_cores_(std::max(1, nb_cores)),
+  reference_(),
+  reports_(configurations.size()),
+  decode_seconds_(0),
+  trackers_(),
+  tracks_(),
+  next_configuration_(0),
+  capture_(),
+  frame_cache_(),
+  next_frame_(0),
+  decode_error_() {
+  for (size_t i = 0; i < configurations_.size(); ++i) {
+    reports_[i].name = configurations_[i].name;
+  }
+}
+
+//--------------------------- Sweep file ---------------------------
+bool LoadSweep(const std::string &path, std::vector<BatchJob> *configurations,
+               std::string *reference, std::string *error) {
+  CHECK_NOTNULL(configurations);
+  CHECK_NOTNULL(reference);
+  CHECK_NOTNULL(error);
+
+  FileStorage fs;
+  try {
+    fs.open(path, FileStorage::READ);
+  } catch (const cv::Exception &e) {
+    *error = path + ": " + e.what();
+    return false;
+  }
+  if (!fs.isOpened()) {
+    *error = "could not open " + path;
+    return false;
+  }
+
+  FileNode node = fs["sweep"];
+  if (!node.isMap()) {
+    *error = path + ": no sweep map";
+    return false;
+  }
+
+  size_t slash = path.rfind('/');
+  std::string directory = (slash == std::string::npos) ?
+                            "" : path.substr(0, slash);
+
+  BatchJob source;
+  ReadBatchJob(node, directory, &source);
+  reference->clear();
+  if (node["reference"].isString()) {
+    *reference = ResolveBatchPath(directory,
+                                  static_cast<std::string>(node["reference"]));
+  }
+
+  std::vector<std::pair<int, std::vector<float> > > algorithms;
+  std::vector<std::pair<int, std::vector<float> > > filters;
+  std::vector<std::pair<int, std::vector<float> > > bgs;
+  if (node["algorithms"].empty() ||
+      !ReadEntries(node["algorithms"], "algorithm", "params", 0,
+                   &algorithms)) {
+    *error = path + ": algorithms must be a sequence of entries with values";
+    return false;
+  }
+  if (!ReadEntries(node["filters"], "filter", "filter_params",
+                   TL_BATCH_NO_FILTER, &filters)) {
+    *error = path + ": filters must be a sequence of entries with values";
+    return false;
+  }
+  if (!ReadEntries(node["bgs"], "bgs", "bgs_params", TL_BATCH_NO_BGS, &bgs)) {
+    *error = path + ": bgs must be a sequence of entries with values";
+    return false;
+  }
+
+  std::vector<bool> adaptive(1, source.adaptive_detection);
+  FileNode adaptive_node = node["adaptive_detection"];
+  if (adaptive_node.isSeq() && adaptive_node.size() > 0) {
+    adaptive.clear();
+    for (size_t i = 0; i < adaptive_node.size(); ++i) {
+      adaptive.push_back(static_cast<int>(adaptive_node[static_cast<int>(i)]) !=
+                         0);
+    }
+  }
+
+  for (const std::pair<int, std::vector<float> > &algorithm : algorithms) {
+    for (const std::pair<int, std::vector<float> > &filter : filters) {
+      for (const std::pair<int, std::vector<float> > &subtractor : bgs) {
+        for (bool adaptive_detection : adaptive) {
+          BatchJob job = source;
+          job.algorithm = static_cast<BatchAlgorithm>(algorithm.first);
+          job.params = algorithm.second;
+          job.filter = static_cast<BatchFilter>(filter.first);
+          job.filter_params = filter.second;
+          job.bgs = static_cast<BatchBgs>(subtractor.first);
+          job.bgs_params = subtractor.second;
+          job.adaptive_detection = adaptive_detection;
+
+          std::string issue = ValidateBatchJob(job);
+          if (!issue.empty()) {
+            *error = path + ": " + issue;
+            return false;
+          }
+          job.name = ConfigurationName(job);
+          configurations->push_back(job);
+        }
+      }
+    }
+  }
+  return true;
+}
+
+//------------------------ Public accessors ------------------------
+void SweepRunner::set_reference(const Track &reference) {
+  reference_ = reference;
+}
+
+void SweepRunner::set_frame_cache(const std::string &directory,
+                                  int64 max_bytes) {
+  frame_cache_.set_directory(directory);
+  frame_cache_.set_max_bytes(max_bytes);
+}
+
+const std::vector<SweepReport> &SweepRunner::reports() const {
+  return reports_;
+}
+
+double SweepRunner::decode_seconds() const {
+  return decode_seconds_;
+}
+
+//-------------------------- Main functions ------------------------
+bool SweepRunner::Run(std::string *error) {
+  CHECK_NOTNULL(error);
+  if (configurations_.empty()) return true;
+  const BatchJob &source = configurations_.front();
+
+  // Read the frame where the object is defined.
+  int64 start = getTickCount();
+  Mat frame;
+  if (!source.video.empty() && !frame_cache_.directory().empty()) {
+    std::string cache_error;
+    if (!frame_cache_.Open(source.video, &cache_error))
+      WARNING(cache_error << ", decoding without cache");
+  }
+  if (frame_cache_.is_open()) {
+    if (source.first_frame <= frame_cache_.nb_frames())
+      frame = frame_cache_.frame(source.first_frame - 1);
+  } else if (!source.video.empty()) {
+    if (!capture_.open(source.video)) {
+      *error = "could not open " + source.video;
+      return false;
+    }
+    for (int i = 1; i < source.first_frame; ++i) {
+      if (!capture_.grab()) break;
+    }
+    capture_ >> frame;
+  } else if (source.first_frame <= static_cast<int>(source.frames.size())) {
+    frame = imread(source.frames[source.first_frame - 1]);
+  }
+  decode_seconds_ += Seconds(getTickCount() - start);
+  if (frame.empty()) {
+    *error = "could not read first frame";
+    return false;
+  }
+  next_frame_ = source.first_frame + 1;
+
+  trackers_.clear();
+  tracks_.assign(configurations_.size(), Track());
+  for (size_t i = 0; i < configurations_.size(); ++i) {
+    trackers_.push_back(std::unique_ptr<JobTracker>(
+                          new JobTracker(configurations_[i], frame)));
+    tracks_[i].Append(source.first_frame, source.object);
+  }
+
+  // Shared images derived from the frames that detectors use: computed before
+  // tracking, so that no configuration is timed computing them for all.
+  // Configurations with a background subtractor detect on their foreground.
+  bool shared_integrals = false;
+  bool shared_hsv = false;
+  for (const BatchJob &configuration : configurations_) {
+    if (configuration.bgs != TL_BATCH_NO_BGS) continue;
+    if (configuration.algorithm == TL_BATCH_TEMPLATE_MATCHING)
+      shared_integrals = true;
+    if (configuration.algorithm == TL_BATCH_MEANSHIFT && frame.channels() == 3)
+      shared_hsv = true;
+  }
+
+  int nb_workers = std::min(nb_cores_,
+                            static_cast<int>(configurations_.size()));
+  setNumThreads(std::max(1, nb_cores_ / nb_workers));
+
+  // Decode the next chunk while all configurations track the current one.
+  std::vector<Mat> chunk;
+  std::vector<Mat> next_chunk;
+  decode_error_.clear();
+  DecodeChunk(&chunk);
+  int first_frame = source.first_frame + 1;
+  std::vector<std::unique_ptr<FrameContext> > contexts;
+  while (!chunk.empty()) {
+    std::thread decoder(&SweepRunner::DecodeChunk, this, &next_chunk);
+
+    contexts.clear();
+    for (const Mat &chunk_frame : chunk) {
+      contexts.push_back(std::unique_ptr<FrameContext>(
+                           new FrameContext(chunk_frame)));
+      if (shared_integrals) contexts.back()->integral_images().Precompute();
+      if (shared_hsv) contexts.back()->hsv();
+    }
+
+    next_configuration_ = 0;
+    std::vector<std::thread> workers;
+    for (int i = 1; i < nb_workers; ++i) {
+      workers.push_back(std::thread(&SweepRunner::TrackChunk, this,
+                                    std::cref(contexts), first_frame));
+    }
+    TrackChunk(contexts, first_frame);
+    for (std::thread &worker : workers) {
+      worker.join();
+    }
+    decoder.join();
+
+    first_frame += static_cast<int>(chunk.size());
+    chunk.swap(next_chunk);
+  }
+  trackers_.clear();
+  capture_.release();
+  frame_cache_.Close();
+
+  if (!reference_.empty()) {
+    // Tracks start with the initial object, which is not tracked.
+    std::vector<double> seconds;
+    std::vector<int> nb_tracked;
+    for (const SweepReport &report : reports_) {
+      seconds.push_back(report.track_seconds);
+      nb_tracked.push_back(report.nb_frames);
+    }
+    std::vector<Evaluation> evaluations =
+        EvaluateAll(reference_, tracks_, seconds, nb_tracked, nb_cores_);
+    for (size_t i = 0; i < reports_.size(); ++i) {
+      reports_[i].evaluation = evaluations[i];
+    }
+  }
+  tracks_.clear();
+
+  if (!decode_error_.empty()) {
+    *error = decode_error_;
+    return false;
+  }
+  return true;
+}
+
+int SweepRunner::Fastest(double min_success_rate) const {
+  int fastest = -1;
+  double fastest_fps = 0;
+  for (size_t i = 0; i < reports_.size(); ++i) {
+    const SweepReport &report = reports_[i];
+    if (!report.error.empty() || report.track_seconds <= 0 ||
+        report.evaluation.success_rate < min_success_rate) {
+      continue;
+    }
+    double fps = report.nb_frames / report.track_seconds;
+    if (fastest < 0 || fps > fastest_fps) {
+      fastest = static_cast<int>(i);
+      fastest_fps = fps;
+    }
+  }
+  return fastest;
+}
+
+bool SweepRunner::WriteReports(const std::string &path) const {
+  std::ofstream out(path.c_str());
+  out << "configuration,status,frames,track_seconds,fps,scored_frames,"
+         "mean_overlap,success_rate,success_auc,precision,mean_center_error,"
+         "losses,error\n";
+  for (const SweepReport &report : reports_) {
+    const Evaluation &evaluation = report.evaluation;
+    out << report.name << ',' << (report.error.empty() ? "ok" : "failed") <<
+           ',' << report.nb_frames << ',' << report.track_seconds << ',' <<
+           Fps(report) << ',' << evaluation.nb_frames << ',' <<
+           evaluation.mean_overlap << ',' << evaluation.success_rate << ',' <<
+           evaluation.success_auc << ',' << evaluation.precision << ',' <<
+           evaluation.mean_center_error << ',' << evaluation.losses.size() <<
+           ",\"" << report.error << "\"\n";
+  }
+  out.close();
+  return !out.fail();
+}
+
+bool SweepRunner::WriteAdaptiveComparison(const std::string &path) const {
+  std::ofstream out(path.c_str());
+  out << "configuration,fps,adaptive_fps,speedup,success_rate,"
+         "adaptive_success_rate,mean_overlap,adaptive_mean_overlap,"
+         "skipped_frames,local_frames\n";
+  for (size_t i = 0; i < configurations_.size(); ++i) {
+    if (configurations_[i].adaptive_detection) continue;
+    for (size_t j = 0; j < configurations_.size(); ++j) {
+      if (!configurations_[j].adaptive_detection ||
+          !SameComponents(configurations_[i], configurations_[j])) {
+        continue;
+      }
+      const SweepReport &fixed = reports_[i];
+      const SweepReport &adaptive = reports_[j];
+      double speedup = (Fps(fixed) > 0) ? Fps(adaptive) / Fps(fixed) : 0;
+      out << fixed.name << ',' << Fps(fixed) << ',' << Fps(adaptive) << ',' <<
+             speedup << ',' << fixed.evaluation.success_rate << ',' <<
+             adaptive.evaluation.success_rate << ',' <<
+             fixed.evaluation.mean_overlap << ',' <<
+             adaptive.evaluation.mean_overlap << ',' << adaptive.nb_skipped <<
+             ',' << adaptive.nb_local << '\n';
+    }
+  }
+  out.close();
+  return !out.fail();
+}
+
+//------------------------- Private methods ------------------------
+void SweepRunner::DecodeChunk(std::vector<Mat> *frames) {
+  frames->clear();
+  const BatchJob &source = configurations_.front();
+  int64 start = getTickCount();
+  while (frames->size() < kChunkSize && decode_error_.empty() &&
+         (source.last_frame == 0 || next_frame_ <= source.last_frame)) {
+    Mat frame;  // Not reused: frames of a chunk are kept.
+    if (frame_cache_.is_open()) {
+      if (next_frame_ <= frame_cache_.nb_frames())
+        frame = frame_cache_.frame(next_frame_ - 1);
+    } else if (!source.video.empty()) {
+      capture_ >> frame;
+    } else if (next_frame_ <= static_cast<int>(source.frames.size())) {
+      frame = imread(source.frames[next_frame_ - 1]);
+      if (frame.empty())
+        decode_error_ = "could not read " + source.frames[next_frame_ - 1];
+    }
+    if (frame.empty()) break;
+    frames->push_back(frame);
+    ++next_frame_;
+  }
+  decode_seconds_ += Seconds(getTickCount() - start);
+}
+
+void SweepRunner::TrackChunk(
+    const std::vector<std::unique_ptr<FrameContext> > &contexts,
+    int first_frame) {
+  while (true) {
+    size_t i = next_configuration_++;
+    if (i >= trackers_.size()) return;
+    if (!trackers_[i]) continue;  // Failed on a previous chunk.
+
+    Tracker &tracker = trackers_[i]->tracker();
+    SweepReport *report = &reports_[i];
+    try {
+      for (size_t f = 0; f < contexts.size(); ++f) {
+        int64 start = getTickCount();
+        tracker.Track(*contexts[f]);
+        report->track_seconds += Seconds(getTickCount() - start);
+        ++report->nb_frames;
+        tracks_[i].Append(first_frame + static_cast<int>(f), tracker.state());
+      }
+      report->nb_skipped = tracker.nb_detections(TL_DETECTION_SKIPPED);
+      report->nb_local = tracker.nb_detections(TL_DETECTION_LOCAL);
+    } catch (const cv::Exception &e) {
+      report->error = e.what();
+      trackers_[i].reset();
+    }
+  }
+}
+
+}  // namespace tl
@@ -0,0 +1,203 @@
+/*!
+ * \file sweep.h
+ * \brief Run many configurations of a tracker on the same source.
+ * \author Joachim Valente <joachim.valente@gmail.com>
+ */
+
+#ifndef TL_SWEEP_H
+#define TL_SWEEP_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include "common.h"
+#include "tl_batch/batchjob.h"
+#include "tl_evaluation/evaluation.h"
+#include "tl_util/framecache.h"
+
+namespace tl {
+
+/*!
+ * \brief Outcome, speed and accuracy of a configuration.
+ */
+struct SweepReport {
+  //--------------------------- Constructor --------------------------
+  SweepReport();
+
+  //----------------------------- Members ----------------------------
+  std::string name;           //!< Name of the configuration.
+  std::string error;          //!< Why tracking stopped early, if it did.
+  int nb_frames;              //!< Number of frames tracked.
+  double track_seconds;       //!< Time spent in Tracker::Track.
+  int nb_skipped;             //!< Frames tracked without detection.
+  int nb_local;               //!< Frames tracked with a local detection.
+  Evaluation evaluation;      //!< Accuracy against the reference, if any.
+};
+
+/*!
+ * \brief Read the configurations of a sweep file.
+ *
+ * Sweep files are read with cv::FileStorage (YAML or XML) and contain a
+ * `sweep` map with the source fields of BatchJob, the path of an optional
+ * reference track (see Track::Load()) and a grid of configurations, e.g.:
+ * \code
+ * %YAML:1.0
+ * sweep:
+ *   video: "car.avi"
+ *   object: [ 120, 80, 40, 30 ]
+ *   reference: "car_reference.csv"
+ *   algorithms:
+ *     - { algorithm: 0, params: [ [ 1, 3, 5 ] ] }
+ *     - { algorithm: 1, params: [ [ 0, 1 ], [ 2, 3 ], [ 5, 10, 20 ] ] }
+ *   filters:
+ *     - { filter: 0 }
+ *     - { filter: 1, filter_params: [ [ 0.005, 0.015 ], [ 4., 12. ] ] }
+ *   bgs:
+ *     - { bgs: 0 }
+ * \endcode
+ * Each parameter is given as a list of values (or a single value) and every
+ * combination of algorithm, filter and background subtractor entries, and of
+ * their parameter values, is a configuration: 75 in the example above.
+ * `filters` and `bgs` default to none. `adaptive_detection` may also be a
+ * list, e.g. `[ 0, 1 ]` to run every configuration in both modes and measure
+ * the speed and accuracy adaptive detection trades.
+ * \param path Path of the sweep file.
+ * \param configurations One job per configuration, named after its
+ * parameters (appended).
+ * \param reference Path of the reference track, empty if none.
+ * \param error Description of the first invalid entry, if any.
+ * \return Whether the sweep is valid.
+ */
+bool LoadSweep(const std::string &path, std::vector<BatchJob> *configurations,
+               std::string *reference, std::string *error);
+
+/*!
+ * \brief Run configurations side by side on a single decode of their source.
+ *
+ * Frames are decoded in chunks by one thread while the trackers of all
+ * configurations go through the previous chunk on a pool of threads, so that
+ * the cost of decoding is paid once whatever the number of configurations.
+ * Likewise, the images derived from each frame (see FrameContext) are
+ * computed once for all configurations.
+ * Each configuration is timed on its own and its results are scored against
+ * the reference track, if any, once all are tracked.
+ *
+ * The shared images the detectors use are computed before the configurations
+ * are timed, so that their speed assumes shared preprocessing: a
+ * configuration run alone would also pay for its integral images or HSV
+ * conversion. Times are wall-clock times of configurations running
+ * concurrently, with each other and the decoding thread: compare them
+ * between configurations of the same sweep only.
+ */
+class SweepRunner {
+public:
+  //--------------------------- Constructor --------------------------
+  /*!
+   * \param configurations Jobs on the same source and object.
+   * \param nb_cores Number of cores to use (at least 1).
+   */
+  SweepRunner(const std::vector<BatchJob> &configurations, int nb_cores);
+
+  //------------------------ Public accessors ------------------------
+  /*!
+   * \brief Set the reference track configurations are scored against.
+   */
+  void set_reference(const Track &reference);
+
+  /*!
+   * \brief Read the video through a FrameCache, so that it is decoded once
+   * for all the runs on it (default none).
+   * \param directory Existing directory of the cache, empty for none.
+   * \param max_bytes Bytes the cache may take on disk.
+   */
+  void set_frame_cache(const std::string &directory, int64 max_bytes);
+
+  /*!
+   * \brief Reports of the configurations, in the order of the
+   * configurations.
+   */
+  const std::vector<SweepReport> &reports() const;
+
+  /*!
+   * \brief Time spent reading and decoding frames, shared by all
+   * configurations.
+   */
+  double decode_seconds() const;
+
+  //-------------------------- Main functions ------------------------
+  /*!
+   * \brief Run all configurations and wait for them.
+   * \param error Reason of the failure, if any.
+   * \return Whether the source could be read until the end.
+   */
+  bool Run(std::string *error);
+
+  /*!
+   * \brief Fastest configuration that did not fail and has at least the given
+   * success rate.
+   * \return Its index, -1 if none.
+   */
+  int Fastest(double min_success_rate) const;
+
+  /*!
+   * \brief Write the reports as rows `configuration,status,frames,
+   * track_seconds,fps,scored_frames,mean_overlap,success_rate,success_auc,
+   * precision,mean_center_error,losses,error`.
+   * \return Whether the file could be written.
+   */
+  bool WriteReports(const std::string &path) const;
+
+  /*!
+   * \brief Write, for each configuration run both without and with adaptive
+   * detection, the speed and accuracy of the two runs as rows
+   * `configuration,fps,adaptive_fps,speedup,success_rate,
+   * adaptive_success_rate,mean_overlap,adaptive_mean_overlap,skipped_frames,
+   * local_frames`, the last two counting the detections of the adaptive run.
+   * \return Whether the file could be written.
+   */
+  bool WriteAdaptiveComparison(const std::string &path) const;
+
+private:
+  //------------------------- Private methods ------------------------
+  /*!
+   * \brief Read the next frames of the source, none at its end.
+   */
+  void DecodeChunk(std::vector<cv::Mat> *frames);
+
+  /*!
+   * \brief Track frames with configurations until none is left.
+   * \param contexts Contexts of the frames of the chunk.
+   * \param first_frame Number of the first frame of the chunk.
+   */
+  void TrackChunk(const std::vector<std::unique_ptr<FrameContext> > &contexts,
+                  int first_frame);
+
+  //------------------------- Private members ------------------------
+  std::vector<BatchJob> configurations_;  //!< Configurations to run.
+  int nb_cores_;                          //!< Core budget.
+  Track reference_;                       //!< Reference track.
+
+  std::vector<SweepReport> reports_;      //!< One report per configuration.
+  double decode_seconds_;                 //!< Decoding time.
+
+  //! Trackers, one per configuration.
+  std::vector<std::unique_ptr<JobTracker> > trackers_;
+  std::vector<Track> tracks_;             //!< Results, one per configuration.
+  std::atomic<size_t> next_configuration_;  //!< Next to track the chunk.
+
+  cv::VideoCapture capture_;              //!< Source, if a video.
+  FrameCache frame_cache_;                //!< Source, if a cached video.
+  int next_frame_;                        //!< Number of the next frame read.
+  std::string decode_error_;              //!< Why decoding stopped, if any.
+
+  DISALLOW_COPY_AND_ASSIGN(SweepRunner);
+};
+
+}  // namespace tl
+
+#endif  // TL_SWEEP_H
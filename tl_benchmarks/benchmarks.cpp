@@ -0,0 +1,604 @@
+#include "tl_benchmarks/benchmarks.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <utility>
+
+#include <opencv2/core/core.hpp>
+
+#include "tl_filters/constantvelocityfilter.h"
+#include "tl_filters/kalmanfilter.h"
+#include "tl_trackers/dataassociation.h"
+#include "tl_util/conversions.h"
+#include "tl_util/framering.h"
+#include "tl_util/geometry.h"
+#include "tl_util/spatialindex.h"
+
+using namespace cv;
+using namespace tl::internal;
+
+namespace tl {
+
+namespace {
+
+//--------------------------- Spatial index ------------------------
+// Tracks of about the size of the cells, in a frame where each cell holds
+// less than one on average.
+const int kNbTracks = 10000;
+const int kFrameSide = 8000;
+const int kTrackSide = 40;
+const int kCellSize = 64;
+const int kMaxSpeed = 4;          // Pixels per frame.
+const int kGateMargin = 20;       // Around a track, for gating queries.
+const int kNbNeighbors = 5;
+const int kNbIndexFrames = 20;
+
+typedef std::pair<double, int> Neighbor;
+
+double Seconds(int64 ticks) {
+  return static_cast<double>(ticks) / getTickFrequency();
+}
+
+double Microseconds(int64 ticks, int count) {
+  return 1e6 * Seconds(ticks) / std::max(count, 1);
+}
+
+Rect Gate(Rect rect) {
+  return Rect(rect.x - kGateMargin, rect.y - kGateMargin,
+              rect.width + 2 * kGateMargin, rect.height + 2 * kGateMargin);
+}
+
+double SquaredDistance(Rect rect, Point2d point) {
+  double dx = rect.x + 0.5 * rect.width - point.x;
+  double dy = rect.y + 0.5 * rect.height - point.y;
+  return dx * dx + dy * dy;
+}
+
+Point2d Center(Rect rect) {
+  return Point2d(rect.x + 0.5 * rect.width, rect.y + 0.5 * rect.height);
+}
+
+// Moves kNbTracks tracks for a few frames, each frame updating the index and
+// querying it around every track, then answers the queries of the last frame
+// again by scanning all tracks.
+bool BenchmarkSpatialIndex(std::string *error) {
+  RNG rng(12345);
+  std::vector<Rect> tracks;
+  std::vector<Point> speeds;
+  for (int i = 0; i < kNbTracks; ++i) {
+    tracks.push_back(Rect(rng.uniform(0, kFrameSide - kTrackSide),
+                          rng.uniform(0, kFrameSide - kTrackSide),
+                          rng.uniform(kTrackSide / 2, kTrackSide * 3 / 2),
+                          rng.uniform(kTrackSide / 2, kTrackSide * 3 / 2)));
+    speeds.push_back(Point(rng.uniform(-kMaxSpeed, kMaxSpeed + 1),
+                           rng.uniform(-kMaxSpeed, kMaxSpeed + 1)));
+  }
+
+  SpatialIndex index(kCellSize);
+  std::vector<int> ids;
+  for (const Rect &track : tracks) ids.push_back(index.Insert(track));
+
+  int64 update_ticks = 0;
+  int64 intersecting_ticks = 0;
+  int64 nearest_ticks = 0;
+  std::vector<std::vector<int> > intersecting(kNbTracks);
+  std::vector<std::vector<int> > nearest(kNbTracks);
+  for (int frame = 0; frame < kNbIndexFrames; ++frame) {
+    for (int i = 0; i < kNbTracks; ++i) {
+      tracks[i].x += speeds[i].x;
+      tracks[i].y += speeds[i].y;
+    }
+
+    int64 start = getTickCount();
+    for (int i = 0; i < kNbTracks; ++i) index.Update(ids[i], tracks[i]);
+    update_ticks += getTickCount() - start;
+
+    start = getTickCount();
+    for (int i = 0; i < kNbTracks; ++i) {
+      index.Intersecting(Gate(tracks[i]), &intersecting[i]);
+    }
+    intersecting_ticks += getTickCount() - start;
+
+    start = getTickCount();
+    for (int i = 0; i < kNbTracks; ++i) {
+      index.Nearest(Center(tracks[i]), kNbNeighbors, &nearest[i]);
+    }
+    nearest_ticks += getTickCount() - start;
+  }
+
+  // Same queries on the last frame by brute force.
+  int64 start = getTickCount();
+  std::vector<std::vector<int> > scanned(kNbTracks);
+  for (int i = 0; i < kNbTracks; ++i) {
+    Rect gate = Gate(tracks[i]);
+    for (int j = 0; j < kNbTracks; ++j) {
+      if ((tracks[j] & gate).area() > 0) scanned[i].push_back(ids[j]);
+    }
+  }
+  int64 scan_intersecting_ticks = getTickCount() - start;
+
+  start = getTickCount();
+  std::vector<std::vector<Neighbor> > scanned_nearest(kNbTracks);
+  std::vector<Neighbor> neighbors(kNbTracks);
+  for (int i = 0; i < kNbTracks; ++i) {
+    Point2d center = Center(tracks[i]);
+    for (int j = 0; j < kNbTracks; ++j) {
+      neighbors[j] = Neighbor(SquaredDistance(tracks[j], center), ids[j]);
+    }
+    std::partial_sort(neighbors.begin(), neighbors.begin() + kNbNeighbors,
+                      neighbors.end());
+    scanned_nearest[i].assign(neighbors.begin(),
+                              neighbors.begin() + kNbNeighbors);
+  }
+  int64 scan_nearest_ticks = getTickCount() - start;
+
+  for (int i = 0; i < kNbTracks; ++i) {
+    std::sort(intersecting[i].begin(), intersecting[i].end());
+    std::sort(scanned[i].begin(), scanned[i].end());
+    if (intersecting[i] != scanned[i]) {
+      *error = "spatial index: intersecting queries differ from a scan";
+      return false;
+    }
+    for (int k = 0; k < kNbNeighbors; ++k) {
+      if (nearest[i][k] != scanned_nearest[i][k].second) {
+        *error = "spatial index: nearest queries differ from a scan";
+        return false;
+      }
+    }
+  }
+
+  int nb_queries = kNbIndexFrames * kNbTracks;
+  INFO("spatial index, " << kNbTracks << " tracks, cells of " << kCellSize <<
+       " pixels:");
+  INFO("  update:       " << Microseconds(update_ticks, kNbIndexFrames) <<
+       " us per frame");
+  INFO("  intersecting: " << Microseconds(intersecting_ticks, nb_queries) <<
+       " us per query, " << Microseconds(scan_intersecting_ticks, kNbTracks) <<
+       " us by scan");
+  INFO("  nearest " << kNbNeighbors << ":    " <<
+       Microseconds(nearest_ticks, nb_queries) << " us per query, " <<
+       Microseconds(scan_nearest_ticks, kNbTracks) << " us by scan");
+  return true;
+}
+
+//---------------------------- Frame ring --------------------------
+// Small frames, so that the copy is negligible next to the handoff.
+const int kNbHandoffs = 200000;
+const int kRingCapacity = 8;
+const int kMaxRingConsumers = 2;
+
+// Reads every frame of the ring as a consumer, recording the ticks between
+// its publication and its read.
+void ConsumeRing(FrameRing *ring, int consumer,
+                 const std::vector<int64> *published,
+                 std::vector<int64> *latencies, bool *in_order) {
+  *in_order = true;
+  int expected = 0;
+  while (const FrameSlot *slot = ring->BeginRead(consumer, TL_RING_WAIT)) {
+    int64 now = getTickCount();
+    if (slot->index != expected || slot->frame.at<int>(0) != expected)
+      *in_order = false;
+    latencies->push_back(now - (*published)[slot->index]);
+    ++expected;
+    ring->EndRead(consumer);
+  }
+  if (expected != kNbHandoffs) *in_order = false;
+}
+
+// Publishes kNbHandoffs frames to nb_consumers threads through a ring, and
+// reports the latency of a handoff and the throughput.
+bool BenchmarkRingHandoffs(int nb_consumers, std::string *error) {
+  FrameRing ring(kRingCapacity, nb_consumers);
+  std::vector<int64> published(kNbHandoffs);
+  std::vector<std::vector<int64> > latencies(nb_consumers);
+  bool in_order[kMaxRingConsumers];
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < nb_consumers; ++i) {
+    latencies[i].reserve(kNbHandoffs);
+    consumers.push_back(std::thread(&ConsumeRing, &ring, i, &published,
+                                    &latencies[i], &in_order[i]));
+  }
+
+  int64 start = getTickCount();
+  for (int i = 0; i < kNbHandoffs; ++i) {
+    FrameSlot *slot = ring.BeginWrite(TL_RING_WAIT);
+    slot->frame.create(1, 1, CV_32SC1);
+    slot->frame.at<int>(0) = i;
+    slot->index = i;
+    published[i] = getTickCount();
+    ring.EndWrite();
+  }
+  ring.Close();
+  for (std::thread &consumer : consumers) consumer.join();
+  int64 ticks = getTickCount() - start;
+
+  std::vector<int64> all;
+  for (int i = 0; i < nb_consumers; ++i) {
+    if (!in_order[i]) {
+      *error = "frame ring: frames read out of order or missed";
+      return false;
+    }
+    all.insert(all.end(), latencies[i].begin(), latencies[i].end());
+  }
+  std::sort(all.begin(), all.end());
+
+  INFO("frame ring, " << kRingCapacity << " slots, " << nb_consumers <<
+       " consumer(s):");
+  INFO("  latency:    " << Microseconds(all[all.size() / 2], 1) <<
+       " us median, " << Microseconds(all[all.size() * 99 / 100], 1) <<
+       " us p99");
+  INFO("  throughput: " << kNbHandoffs / Seconds(ticks) << " frames/s");
+  return true;
+}
+
+// A consumer per tracked object shares the decode: one and two of them.
+bool BenchmarkFrameRing(std::string *error) {
+  for (int nb_consumers = 1; nb_consumers <= kMaxRingConsumers;
+       ++nb_consumers) {
+    if (!BenchmarkRingHandoffs(nb_consumers, error)) return false;
+  }
+  return true;
+}
+
+//------------------------- Constant velocity ----------------------
+// Tracks observed with noise, and missed on some frames as by a detector.
+const int kNbFilterTracks = 1000;
+const int kNbFilterFrames = 200;
+const int kMeasurementNoise = 3;  // Pixels.
+const int kMissedPercent = 10;
+const float kFilterQ = 0.015f;
+const float kFilterR = 12.0f;
+
+// Largest difference allowed between the states and uncertainties of the
+// two filters, relative to their magnitude (at least 1): float rounding of
+// the closed form and of the dense products differs.
+const double kFilterTolerance = 1e-3;
+
+bool SameFilterValue(double a, double b) {
+  return std::abs(a - b) <=
+         kFilterTolerance * std::max(1.0, std::max(std::abs(a), std::abs(b)));
+}
+
+bool SameFilterState(const Mat &a, const Mat &b) {
+  if (a.size() != b.size()) return false;
+  for (int i = 0; i < a.rows; ++i) {
+    if (!SameFilterValue(a.at<float>(i), b.at<float>(i))) return false;
+  }
+  return true;
+}
+
+// Runs the same tracks through KalmanFilter(q, r) and ConstantVelocityFilter
+// as Tracker does, checking after each step that they agree within
+// kFilterTolerance, and times each of them.
+bool BenchmarkConstantVelocity(std::string *error) {
+  RNG rng(12345);
+  int64 kalman_ticks = 0;
+  int64 closed_form_ticks = 0;
+  int nb_steps = 0;
+  Mat z;
+  for (int t = 0; t < kNbFilterTracks; ++t) {
+    Rect object(rng.uniform(0, 1000), rng.uniform(0, 1000),
+                rng.uniform(20, 100), rng.uniform(20, 100));
+    Point speed(rng.uniform(-kMaxSpeed, kMaxSpeed + 1),
+                rng.uniform(-kMaxSpeed, kMaxSpeed + 1));
+    KalmanFilter kalman(object, kFilterQ, kFilterR);
+    ConstantVelocityFilter closed_form(object, kFilterQ, kFilterR);
+
+    for (int frame = 0; frame < kNbFilterFrames; ++frame) {
+      object.x += speed.x;
+      object.y += speed.y;
+      bool missed = rng.uniform(0, 100) < kMissedPercent;
+      Rect measured(object.x + rng.uniform(-kMeasurementNoise,
+                                           kMeasurementNoise + 1),
+                    object.y + rng.uniform(-kMeasurementNoise,
+                                           kMeasurementNoise + 1),
+                    object.width, object.height);
+      StateRectToMat(measured, &z);
+
+      int64 start = getTickCount();
+      kalman.Predict();
+      if (missed) {
+        kalman.Extrapolate();
+      } else {
+        kalman.Update(z);
+      }
+      kalman_ticks += getTickCount() - start;
+
+      start = getTickCount();
+      closed_form.Predict();
+      if (missed) {
+        closed_form.Extrapolate();
+      } else {
+        closed_form.Update(z);
+      }
+      closed_form_ticks += getTickCount() - start;
+      ++nb_steps;
+
+      if (!SameFilterState(kalman.x(), closed_form.x()) ||
+          !SameFilterState(kalman.predicted_x(), closed_form.predicted_x()) ||
+          !SameFilterValue(kalman.PositionUncertainty(),
+                           closed_form.PositionUncertainty())) {
+        *error = "constant velocity filter: differs from KalmanFilter";
+        return false;
+      }
+    }
+  }
+
+  INFO("constant velocity filter, " << kNbFilterTracks << " tracks of " <<
+       kNbFilterFrames << " frames, same as KalmanFilter within " <<
+       kFilterTolerance << ":");
+  INFO("  KalmanFilter:           " << Microseconds(kalman_ticks, nb_steps) <<
+       " us per frame");
+  INFO("  ConstantVelocityFilter: " <<
+       Microseconds(closed_form_ticks, nb_steps) << " us per frame");
+  return true;
+}
+
+//-------------------------- Data association ----------------------
+// Crowd of tracks spread as those of the spatial index, each detected near
+// its prediction unless missed, among clutter detections.
+const int kNbCrowdTracks = 5000;
+const int kNbAssociationFrames = 20;
+const int kDetectionNoise = 4;        // Pixels.
+const int kMissedDetectionPercent = 10;
+const int kClutterPercent = 10;       // Of the number of tracks.
+const int kMaxUncertainty = 6;        // Pixels.
+
+// Small clusters solved by brute force: tracks and detections packed in a
+// square smaller than the gates.
+const int kNbSmallClusters = 2000;
+const int kMaxClusterSize = 6;
+const int kClusterSide = 60;
+const double kGateDeviations = 3;     // Defaults of DataAssociation.
+const double kDefaultGateMargin = 16;
+
+// Pairs and total cost of an association.
+struct Matching {
+  int nb_pairs;
+  double cost;
+};
+
+// Whether the association is a valid matching of gated pairs, and its pairs
+// and cost.
+bool CheckAssociation(const std::vector<Rect> &predictions,
+                      const std::vector<double> &uncertainties,
+                      const std::vector<Rect> &detections,
+                      const Association &association, Matching *matching) {
+  matching->nb_pairs = 0;
+  matching->cost = 0;
+  if (association.track_detections.size() != predictions.size() ||
+      association.detection_tracks.size() != detections.size()) {
+    return false;
+  }
+  for (size_t t = 0; t < predictions.size(); ++t) {
+    int d = association.track_detections[t];
+    if (d < 0) continue;
+    if (d >= static_cast<int>(detections.size()) ||
+        association.detection_tracks[d] != static_cast<int>(t)) {
+      return false;
+    }
+    double distance = CenterDistance(predictions[t], detections[d]);
+    if (distance > kDefaultGateMargin + kGateDeviations * uncertainties[t])
+      return false;
+    ++matching->nb_pairs;
+    matching->cost += distance;
+  }
+  for (size_t d = 0; d < detections.size(); ++d) {
+    int t = association.detection_tracks[d];
+    if (t >= 0 && association.track_detections[t] != static_cast<int>(d))
+      return false;
+  }
+  return true;
+}
+
+// Best matching of tracks from track on, with most pairs then least cost, as
+// DataAssociation solves optimally.
+void BruteForceMatching(const std::vector<Rect> &predictions,
+                        const std::vector<double> &uncertainties,
+                        const std::vector<Rect> &detections, size_t track,
+                        std::vector<bool> *used, Matching *best) {
+  if (track == predictions.size()) {
+    best->nb_pairs = 0;
+    best->cost = 0;
+    return;
+  }
+  BruteForceMatching(predictions, uncertainties, detections, track + 1, used,
+                     best);
+  double gate = kDefaultGateMargin + kGateDeviations * uncertainties[track];
+  for (size_t d = 0; d < detections.size(); ++d) {
+    double distance = CenterDistance(predictions[track], detections[d]);
+    if ((*used)[d] || distance > gate) continue;
+    (*used)[d] = true;
+    Matching rest;
+    BruteForceMatching(predictions, uncertainties, detections, track + 1, used,
+                       &rest);
+    (*used)[d] = false;
+    ++rest.nb_pairs;
+    rest.cost += distance;
+    if (rest.nb_pairs > best->nb_pairs ||
+        (rest.nb_pairs == best->nb_pairs && rest.cost < best->cost)) {
+      *best = rest;
+    }
+  }
+}
+
+bool SameMatching(const Matching &a, const Matching &b) {
+  return a.nb_pairs == b.nb_pairs &&
+         std::abs(a.cost - b.cost) <= 1e-6 * (1 + b.cost);
+}
+
+// Whether no gated pair of a free track and a free detection is left.
+bool IsMaximal(const std::vector<Rect> &predictions,
+               const std::vector<double> &uncertainties,
+               const std::vector<Rect> &detections,
+               const Association &association) {
+  for (size_t t = 0; t < predictions.size(); ++t) {
+    if (association.track_detections[t] >= 0) continue;
+    double gate = kDefaultGateMargin + kGateDeviations * uncertainties[t];
+    for (size_t d = 0; d < detections.size(); ++d) {
+      if (association.detection_tracks[d] < 0 &&
+          CenterDistance(predictions[t], detections[d]) <= gate) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Checks both solvers on small clusters against a brute force: the optimal
+// one must find a best matching, the greedy one a maximal matching, which is
+// also a best one on some of the clusters.
+bool CheckSmallClusters(RNG *rng, int *nb_greedy_best, std::string *error) {
+  DataAssociation optimal;
+  optimal.set_solver(TL_ASSIGN_OPTIMAL);
+  DataAssociation greedy;
+  greedy.set_solver(TL_ASSIGN_GREEDY);
+  *nb_greedy_best = 0;
+  for (int i = 0; i < kNbSmallClusters; ++i) {
+    std::vector<Rect> predictions(rng->uniform(1, kMaxClusterSize + 1));
+    std::vector<double> uncertainties(predictions.size());
+    std::vector<Rect> detections(rng->uniform(1, kMaxClusterSize + 1));
+    for (size_t t = 0; t < predictions.size(); ++t) {
+      predictions[t] = Rect(rng->uniform(0, kClusterSide),
+                            rng->uniform(0, kClusterSide), kTrackSide,
+                            kTrackSide);
+      uncertainties[t] = rng->uniform(0, kMaxUncertainty + 1);
+    }
+    for (Rect &detection : detections) {
+      detection = Rect(rng->uniform(0, kClusterSide),
+                       rng->uniform(0, kClusterSide), kTrackSide, kTrackSide);
+    }
+
+    std::vector<bool> used(detections.size(), false);
+    Matching best;
+    BruteForceMatching(predictions, uncertainties, detections, 0, &used,
+                       &best);
+    Association association;
+    Matching matching;
+    optimal.Associate(predictions, uncertainties, detections, &association);
+    if (!CheckAssociation(predictions, uncertainties, detections, association,
+                          &matching) ||
+        matching.nb_pairs != best.nb_pairs ||
+        !SameMatching(matching, best)) {
+      *error = "data association: optimal solver differs from brute force";
+      return false;
+    }
+
+    greedy.Associate(predictions, uncertainties, detections, &association);
+    if (!CheckAssociation(predictions, uncertainties, detections, association,
+                          &matching) ||
+        !IsMaximal(predictions, uncertainties, detections, association)) {
+      *error = "data association: greedy solver left a gated pair unmade";
+      return false;
+    }
+    if (SameMatching(matching, best)) ++*nb_greedy_best;
+  }
+  return true;
+}
+
+// Associates a crowd of tracks and detections for a few frames with each
+// solver, after checking them on small clusters.
+bool BenchmarkAssociation(std::string *error) {
+  RNG rng(12345);
+  int nb_greedy_best = 0;
+  if (!CheckSmallClusters(&rng, &nb_greedy_best, error)) return false;
+
+  std::vector<Rect> tracks;
+  std::vector<Point> speeds;
+  std::vector<double> uncertainties;
+  for (int i = 0; i < kNbCrowdTracks; ++i) {
+    tracks.push_back(Rect(rng.uniform(0, kFrameSide - kTrackSide),
+                          rng.uniform(0, kFrameSide - kTrackSide),
+                          kTrackSide, kTrackSide));
+    speeds.push_back(Point(rng.uniform(-kMaxSpeed, kMaxSpeed + 1),
+                           rng.uniform(-kMaxSpeed, kMaxSpeed + 1)));
+    uncertainties.push_back(rng.uniform(0, kMaxUncertainty + 1));
+  }
+
+  const AssignmentSolver solvers[] = {TL_ASSIGN_AUTO, TL_ASSIGN_GREEDY,
+                                      TL_ASSIGN_OPTIMAL};
+  const char *solver_names[] = {"auto:   ", "greedy: ", "optimal:"};
+  int64 ticks[3] = {0, 0, 0};
+  DataAssociation associations[3];
+  for (int s = 0; s < 3; ++s) associations[s].set_solver(solvers[s]);
+
+  Association association;
+  Matching matching;
+  int nb_detections = 0;
+  for (int frame = 0; frame < kNbAssociationFrames; ++frame) {
+    std::vector<Rect> detections;
+    for (int i = 0; i < kNbCrowdTracks; ++i) {
+      tracks[i].x += speeds[i].x;
+      tracks[i].y += speeds[i].y;
+      if (rng.uniform(0, 100) < kMissedDetectionPercent) continue;
+      detections.push_back(Rect(
+          tracks[i].x + rng.uniform(-kDetectionNoise, kDetectionNoise + 1),
+          tracks[i].y + rng.uniform(-kDetectionNoise, kDetectionNoise + 1),
+          kTrackSide, kTrackSide));
+    }
+    for (int i = 0; i < kNbCrowdTracks * kClutterPercent / 100; ++i) {
+      detections.push_back(Rect(rng.uniform(0, kFrameSide - kTrackSide),
+                                rng.uniform(0, kFrameSide - kTrackSide),
+                                kTrackSide, kTrackSide));
+    }
+    nb_detections += static_cast<int>(detections.size());
+
+    for (int s = 0; s < 3; ++s) {
+      int64 start = getTickCount();
+      associations[s].Associate(tracks, uncertainties, detections,
+                                &association);
+      ticks[s] += getTickCount() - start;
+      if (!CheckAssociation(tracks, uncertainties, detections, association,
+                            &matching)) {
+        *error = "data association: invalid association of a crowd";
+        return false;
+      }
+    }
+  }
+
+  INFO("data association, " << kNbCrowdTracks << " tracks, " <<
+       nb_detections / kNbAssociationFrames << " detections per frame:");
+  for (int s = 0; s < 3; ++s) {
+    INFO("  " << solver_names[s] << " " <<
+         Microseconds(ticks[s], kNbAssociationFrames) / 1000 <<
+         " ms per frame");
+  }
+  INFO("  small clusters: optimal as brute force on " << kNbSmallClusters <<
+       ", greedy on " << nb_greedy_best);
+  return true;
+}
+
+//---------------------------- Registry ----------------------------
+struct Benchmark {
+  const char *name;
+  bool (*run)(std::string *error);
+};
+
+const Benchmark kBenchmarks[] = {
+  {"spatialindex", &BenchmarkSpatialIndex},
+  {"framering", &BenchmarkFrameRing},
+  {"constantvelocity", &BenchmarkConstantVelocity},
+  {"association", &BenchmarkAssociation}
+};
+
+}  // namespace
+
+std::vector<std::string> BenchmarkNames() {
+  std::vector<std::string> names;
+  for (const Benchmark &benchmark : kBenchmarks) {
+    names.push_back(benchmark.name);
+  }
+  return names;
+}
+
+bool RunBenchmark(const std::string &name, std::string *error) {
+  CHECK_NOTNULL(error);
+  for (const Benchmark &benchmark : kBenchmarks) {
+    if (name == benchmark.name) return benchmark.run(error);
+  }
+  *error = "no benchmark " + name;
+  return false;
+}
+
+}  // namespace tl
@@ -0,0 +1,35 @@
+/*!
+ * \file benchmarks.h
+ * \brief Microbenchmarks of the building blocks of the tracking pipeline.
+ * \author Joachim Valente <joachim.valente@gmail.com>
+ */
+
+#ifndef TL_BENCHMARKS_H
+#define TL_BENCHMARKS_H
+
+#include <string>
+#include <vector>
+
+#include "common.h"
+
+namespace tl {
+
+/*!
+ * \brief Names of the benchmarks run by RunBenchmark().
+ */
+std::vector<std::string> BenchmarkNames();
+
+/*!
+ * \brief Run a benchmark and print its timings.
+ *
+ * Benchmarks also check the results of the structure they time against a
+ * naive implementation, or its invariants.
+ * \param name Name of the benchmark (see BenchmarkNames()).
+ * \param error Reason of the failure, if any.
+ * \return Whether the benchmark exists and its checks passed.
+ */
+bool RunBenchmark(const std::string &name, std::string *error);
+
+}  // namespace tl
+
+#endif  // TL_BENCHMARKS_H
@@ -2,18 +2,31 @@
 
 #include <iostream>
 
+#include "common.h"
+#include "tl_util/matpool.h"
+
 using namespace cv;
 
 namespace tl {
 
 BackgroundSubtractor::BackgroundSubtractor(const cv::Mat &initial_frame) :
-  frame_(initial_frame) {
+  frame_(initial_frame),
+  background_(),
+  context_(nullptr),
+  own_context_() {
   background_ = cv::Mat::zeros(initial_frame.rows, initial_frame.cols, CV_8U);
 }
 
 void BackgroundSubtractor::NextFrame(const Mat &frame) {
-  frame_ = frame.clone();
+  own_context_.Reset(PooledClone(frame));
+  NextFrame(own_context_);
+}
+
+void BackgroundSubtractor::NextFrame(const FrameContext &context) {
+  frame_ = context.frame();
+  context_ = &context;
   Compute();
+  context_ = nullptr;
 }
 
 const cv::Mat &BackgroundSubtractor::background() const {
@@ -24,8 +37,33 @@ cv::Mat BackgroundSubtractor::foreground() const {
   return 1 - background_;
 }
 
+bool BackgroundSubtractor::SaveState(SnapshotWriter *writer) const {
+  CHECK_NOTNULL(writer);
+  writer->WriteMat(background_);
+  return true;
+}
+
+bool BackgroundSubtractor::LoadState(SnapshotReader *reader) {
+  CHECK_NOTNULL(reader);
+  Mat background;
+  if (!reader->ReadMat(&background)) return false;
+  if (background.size() != background_.size() ||
+      background.type() != background_.type()) {
+    return false;
+  }
+  background_ = background;
+  return true;
+}
+
+const FrameContext &BackgroundSubtractor::context() const {
+  CHECK_MSG(context_, "context is only available during Compute()");
+  return *context_;
+}
+
 cv::Mat BackgroundSubtractor::GetForeground() const {
-  Mat fg = Mat::zeros(frame_.size(), frame_.type());
+  Mat fg = PooledMat();
+  fg.create(frame_.size(), frame_.type());
+  fg.setTo(Scalar::all(0));
   frame_.copyTo(fg, background());
   return fg;
 }
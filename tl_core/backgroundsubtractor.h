@@ -9,6 +9,10 @@
 
 #include <opencv2/core/core.hpp>
 
+#include "common.h"
+#include "tl_core/framecontext.h"
+#include "tl_util/snapshot.h"
+
 namespace tl {
 
 /*!
@@ -30,6 +34,13 @@ public:
    */
   void NextFrame(const cv::Mat &frame);
 
+  /*!
+   * \brief Feed next frame to the background subtractor along with its
+   * derived images, shared with other components working on the same frame.
+   * \param context Context of the new frame, whose frame is not copied.
+   */
+  void NextFrame(const FrameContext &context);
+
   //---------------------------- Retrieve foreground -----------------
   /*!
    * \brief Segment the foreground from the image (background appears black).
@@ -47,14 +58,42 @@ public:
    */
   cv::Mat foreground() const;
 
+  //------------------------------ Snapshot --------------------------
+  /*!
+   * \brief Write the background mask and model (extended by children
+   * classes).
+   * \return Whether the model could be written.
+   */
+  virtual bool SaveState(SnapshotWriter *writer) const;
+
+  /*!
+   * \brief Restore a state written by `SaveState()` of a background
+   * subtractor of the same class fed with frames of the same dimensions.
+   * \return Whether the snapshot was valid.
+   */
+  virtual bool LoadState(SnapshotReader *reader);
+
 protected:
   /*!
    * \brief Compute the background mask. Called by `NextFrame()`.
    */
   virtual void Compute() = 0;
 
+  /*!
+   * \brief Derived images of the current frame, only during `Compute()`.
+   */
+  const FrameContext &context() const;
+
   cv::Mat frame_;                    //!< The current frame.
   cv::Mat background_;               //!< The current background mask.
+
+private:
+  const FrameContext *context_;      //!< Context of the frame being computed.
+                                     //!  Not owned.
+  FrameContext own_context_;         //!< Context of the frames given alone,
+                                     //!  reset at every frame.
+
+  DISALLOW_COPY_AND_ASSIGN(BackgroundSubtractor);
 };
 
 }
@@ -1,6 +1,7 @@
 #include "tl_core/detector.h"
 
 #include "tl_util/geometry.h"
+#include "tl_util/matpool.h"
 
 using namespace cv;
 using namespace tl::internal;
@@ -9,6 +10,9 @@ namespace tl {
 
 //------------------------- Constructor ---------------------------
 Detector::Detector(const Mat &initial_frame, Rect initial_state) :
+  own_context_(),
+  context_(nullptr),
+  search_region_(),
   confidence_(1.0f) {
   // Safety checks.
   CHECK_NOTNULL(initial_frame.data);
@@ -27,6 +31,8 @@ Detector::Detector(const Mat &initial_frame, Rect initial_state) :
   initial_frame_ = initial_frame.clone();
   initial_state_ = initial_state;
   frame_ = initial_frame_.clone();
+  own_context_.Reset(frame_);
+  context_ = &own_context_;
   state_ = initial_state;
 }
 
@@ -39,13 +45,69 @@ void Detector::NextFrame(const Mat &frame) {
   CHECK(frame.channels() == channels_);
   CHECK(frame.depth() == depth_);
 
-  frame_ = frame.clone();
+  frame_ = PooledClone(frame);
+  own_context_.Reset(frame_);
+  context_ = &own_context_;
+}
+
+void Detector::NextFrame(const FrameContext &context) {
+  const Mat &frame = context.frame();
+  CHECK(frame.cols == width_);
+  CHECK(frame.rows == height_);
+  CHECK(frame.channels() == channels_);
+  CHECK(frame.depth() == depth_);
+
+  frame_ = frame;
+  own_context_.Reset(Mat());
+  context_ = &context;
+}
+
+void Detector::ReleaseContext() {
+  if (context_ == &own_context_) return;
+  own_context_.Reset(frame_);
+  context_ = &own_context_;
 }
 
 std::string Detector::ToString() const {
   return "undocumented detector";
 }
 
+//------------------------------- Snapshot ----------------------------
+void Detector::SaveState(SnapshotWriter *writer) const {
+  CHECK_NOTNULL(writer);
+  writer->WriteInt(width_);
+  writer->WriteInt(height_);
+  writer->WriteInt(channels_);
+  writer->WriteInt(depth_);
+  writer->WriteRect(state_);
+  writer->WriteFloat(confidence_);
+}
+
+bool Detector::LoadState(SnapshotReader *reader) {
+  CHECK_NOTNULL(reader);
+  int frame_width = 0;
+  int frame_height = 0;
+  int nb_channels = 0;
+  int frame_depth = 0;
+  Rect saved_state;
+  float saved_confidence = 0;
+  if (!reader->ReadInt(&frame_width) || !reader->ReadInt(&frame_height) ||
+      !reader->ReadInt(&nb_channels) || !reader->ReadInt(&frame_depth) ||
+      !reader->ReadRect(&saved_state) ||
+      !reader->ReadFloat(&saved_confidence)) {
+    return false;
+  }
+  if (frame_width != width_ || frame_height != height_ ||
+      nb_channels != channels_ || frame_depth != depth_ ||
+      saved_confidence < 0.0f || saved_confidence > 1.0f) {
+    return false;
+  }
+
+  state_ = saved_state;
+  confidence_ = saved_confidence;
+  return true;
+}
+
 //--------------------------- Public accessors -----------------------
 cv::Rect Detector::state() const {
   return state_;
@@ -79,6 +141,14 @@ void Detector::set_confidence(float confidence) {
   confidence_ = confidence;
 }
 
+void Detector::set_search_region(cv::Rect search_region) {
+  search_region_ = search_region;
+}
+
+cv::Rect Detector::search_region() const {
+  return search_region_;
+}
+
 //------------------------- Protected accessors ---------------------
 const cv::Mat &Detector::initial_frame() const {
   return initial_frame_;
@@ -112,4 +182,8 @@ int Detector::depth() const {
   return depth_;
 }
 
+const FrameContext &Detector::context() const {
+  return *context_;
+}
+
 }  // namespace tl
@@ -12,6 +12,8 @@
 #include <opencv2/core/core.hpp>
 
 #include "common.h"
+#include "tl_core/framecontext.h"
+#include "tl_util/snapshot.h"
 
 using namespace cv;
 
@@ -46,6 +48,21 @@ public:
    */
   void NextFrame(const cv::Mat &frame);
 
+  /*!
+   * \brief Feed new frame to the detector along with its derived images,
+   * shared with other components working on the same frame.
+   * \param context Context of the new frame, whose frame is not copied. Not
+   * owned: it must live until `ReleaseContext()` is called.
+   */
+  void NextFrame(const FrameContext &context);
+
+  /*!
+   * \brief Stop using the context given to `NextFrame()`, e.g. before it is
+   * destroyed. The detector keeps the frame and derives images from it again
+   * if needed.
+   */
+  void ReleaseContext();
+
   /*!
    * \brief Run the detection task.
    */
@@ -56,6 +73,22 @@ public:
    */
   virtual std::string ToString() const;
 
+  //----------------------- Snapshot ------------------------
+  /*!
+   * \brief Write the internal state of the detector.
+   *
+   * Children classes holding state (e.g. a template) must extend it and call
+   * the parent version first.
+   */
+  virtual void SaveState(SnapshotWriter *writer) const;
+
+  /*!
+   * \brief Restore a state written by `SaveState()` of a detector of the same
+   * class fed with frames of the same dimensions.
+   * \return Whether the snapshot was valid.
+   */
+  virtual bool LoadState(SnapshotReader *reader);
+
   //----------------------- Accessors -----------------------
   cv::Rect state() const;
 
@@ -80,6 +113,16 @@ public:
    */
   void set_confidence(float confidence);
 
+  /*!
+   * \brief Restrict the next detections to a region, e.g. around the
+   * prediction of a filter. Detectors searching the whole frame should only
+   * search there; local ones may ignore it.
+   * \param search_region Region of the frame, empty for the whole frame.
+   */
+  void set_search_region(cv::Rect search_region);
+
+  cv::Rect search_region() const;
+
 protected:
   //---------------- Protected accessors -------------------
   const cv::Mat &initial_frame() const;
@@ -91,6 +134,12 @@ protected:
   int channels() const;
   int depth() const;
 
+  /*!
+   * \brief Derived images of the current frame. Children classes should get
+   * conversions of the frame from there rather than computing their own.
+   */
+  const FrameContext &context() const;
+
 private:
   //-------------------- Internal members ---------------------
   int width_;                     //!< Width of frames.
@@ -102,6 +151,12 @@ private:
   cv::Rect initial_state_;        //!< Initial state of the object to detect.
 
   cv::Mat frame_;                 //!< Current frame in the sequence.
+  FrameContext own_context_;      //!< Its context when it was not given,
+                                  //!  reset at every frame.
+  const FrameContext *context_;   //!< Its context, own_context_ or the one
+                                  //!  given until released. Not owned.
+  cv::Rect search_region_;        //!< Where to search the object, empty for
+                                  //!  the whole frame.
   cv::Rect state_;                //!< Current estimate of the object state.
   float confidence_;              //!< Confidence \f$\in [0;1]\f$ of current
                                   //!  state estimate.
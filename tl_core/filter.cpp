@@ -1,15 +1,57 @@
 #include "tl_core/filter.h"
 
+#include "common.h"
+
 namespace tl {
 
 //------------------------ Constructor ---------------------------
 Filter::Filter() {}
 
+//------------------------ Initialization ------------------------
+void Filter::Init(const cv::Mat &x0) {
+  x_ = x0.clone();
+}
+
 //----------------------- Core functions -------------------------
+void Filter::Extrapolate() {
+  x_ = predicted_x_.clone();
+}
+
+double Filter::PositionUncertainty() const {
+  return -1;
+}
+
 std::string Filter::ToString() const {
   return "undocumented filter";
 }
 
+//--------------------------- Snapshot ----------------------------
+void Filter::SaveState(SnapshotWriter *writer) const {
+  CHECK_NOTNULL(writer);
+  writer->WriteMat(x_);
+  writer->WriteMat(predicted_x_);
+}
+
+bool Filter::LoadState(SnapshotReader *reader) {
+  CHECK_NOTNULL(reader);
+  cv::Mat x;
+  cv::Mat predicted_x;
+  if (!reader->ReadMat(&x) || !reader->ReadMat(&predicted_x) ||
+      !IsValidState(x, predicted_x)) {
+    return false;
+  }
+  x_ = x;
+  predicted_x_ = predicted_x;
+  return true;
+}
+
+bool Filter::IsValidState(const cv::Mat &x,
+                          const cv::Mat &predicted_x) const {
+  if (x.cols != 1 || x.type() != CV_32F) return false;
+  return predicted_x.empty() ||
+         (predicted_x.size() == x.size() && predicted_x.type() == CV_32F);
+}
+
 //----------------------- Public accessors ------------------------
 const cv::Mat &Filter::predicted_x() const {
   return predicted_x_;
@@ -7,8 +7,12 @@
 #ifndef TL_FILTER_H
 #define TL_FILTER_H
 
+#include <string>
+
 #include <opencv2/core/core.hpp>
 
+#include "tl_util/snapshot.h"
+
 namespace tl {
 
 /*!
@@ -19,6 +23,12 @@ public:
   //-------------------------- Constructor ------------------------
   Filter();
 
+  //------------------------- Initialization ----------------------
+  /*!
+   * \brief Initialize (or reset) with a state.
+   */
+  virtual void Init(const cv::Mat &x0);
+
   //------------------------- Core functions ----------------------
   /*!
    * \brief Predict state.
@@ -31,23 +41,59 @@ public:
    */
   virtual void Update(const cv::Mat &z) = 0;
 
+  /*!
+   * \brief Take the predicted state as the estimate, for a frame without
+   * measurement.
+   */
+  virtual void Extrapolate();
+
+  /*!
+   * \brief Standard deviation of the predicted position, in pixels.
+   * \return Largest of the deviations along x and y, or -1 if the filter
+   * does not know it.
+   */
+  virtual double PositionUncertainty() const;
+
   /*!
    * \brief Get a textual description of the filter.
    */
   virtual std::string ToString() const;
 
+  //---------------------------- Snapshot -------------------------
+  /*!
+   * \brief Write the state estimates (extended by children classes).
+   */
+  virtual void SaveState(SnapshotWriter *writer) const;
+
+  /*!
+   * \brief Restore a state written by `SaveState()` of a filter of the same
+   * class and model.
+   * \return Whether the snapshot was valid.
+   */
+  virtual bool LoadState(SnapshotReader *reader);
+
   //------------------------- Public accessors --------------------
   /*!
-   * \brief Get state estimate.
+   * \brief Get state estimate, overwritten by the next update: clone it to
+   * keep it.
    */
   const cv::Mat &x() const;
 
   /*!
-   * \brief Get predicted state.
+   * \brief Get predicted state, overwritten by the next prediction: clone it
+   * to keep it.
    */
   const cv::Mat &predicted_x() const;
 
 protected:
+  //------------------------ Protected methods ----------------------
+  /*!
+   * \brief Whether loaded estimates can be used by the filter: by default a
+   * CV_32F column, the prediction being empty or of the same size (checked
+   * before they are restored; extended by children classes).
+   */
+  virtual bool IsValidState(const cv::Mat &x, const cv::Mat &predicted_x) const;
+
   //------------------------ Protected members ----------------------
   cv::Mat x_;                 //!< State estimate.
   cv::Mat predicted_x_;       //!< Predicted state.
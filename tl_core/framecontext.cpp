@@ -0,0 +1,96 @@
+#include "tl_core/framecontext.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "tl_util/matpool.h"
+
+using namespace cv;
+
+namespace tl {
+
+//-------------------------- Constructors --------------------------
+FrameContext::FrameContext() :
+  frame_(),
+  gray_(PooledMat()),
+  gray_computed_(false),
+  gray_mutex_(),
+  hsv_(PooledMat()),
+  hsv_computed_(false),
+  hsv_mutex_(),
+  pyramid_(),
+  nb_pyramid_levels_(1),
+  pyramid_mutex_(),
+  integral_images_() {}
+
+FrameContext::FrameContext(const cv::Mat &frame) :
+  FrameContext() {
+  CHECK_NOTNULL(frame.data);
+  Reset(frame);
+}
+
+void FrameContext::Reset(const cv::Mat &frame) {
+  frame_ = frame;
+  gray_ = PooledMat();
+  gray_computed_ = false;
+  hsv_ = PooledMat();
+  hsv_computed_ = false;
+  for (int level = 1; level < nb_pyramid_levels_; ++level) {
+    pyramid_[level].release();
+  }
+  pyramid_[0] = frame;
+  nb_pyramid_levels_ = 1;
+  integral_images_.Reset(frame);
+}
+
+//------------------------ Derived images --------------------------
+const cv::Mat &FrameContext::frame() const {
+  return frame_;
+}
+
+const cv::Mat &FrameContext::gray() const {
+  std::lock_guard<std::mutex> lock(gray_mutex_);
+  if (!gray_computed_) ComputeGray();
+  gray_computed_ = true;
+  return gray_;
+}
+
+const cv::Mat &FrameContext::hsv() const {
+  CHECK_MSG(frame_.channels() == 3, "HSV needs a color frame");
+  std::lock_guard<std::mutex> lock(hsv_mutex_);
+  if (!hsv_computed_) ComputeHsv();
+  hsv_computed_ = true;
+  return hsv_;
+}
+
+const cv::Mat &FrameContext::pyramid(int level) const {
+  CHECK(0 <= level && level < kMaxPyramidLevels);
+  std::lock_guard<std::mutex> lock(pyramid_mutex_);
+  for (; nb_pyramid_levels_ <= level; ++nb_pyramid_levels_) {
+    const Mat &previous = pyramid_[nb_pyramid_levels_ - 1];
+    CHECK_MSG(previous.cols > 1 && previous.rows > 1,
+              "pyramid level " << level << " is too small");
+    Mat &next = pyramid_[nb_pyramid_levels_];
+    next = PooledMat();
+    pyrDown(previous, next);
+  }
+  return pyramid_[level];
+}
+
+const IntegralImages &FrameContext::integral_images() const {
+  return integral_images_;
+}
+
+//------------------------- Private methods ------------------------
+void FrameContext::ComputeGray() const {
+  if (frame_.channels() == 1) {
+    gray_ = frame_;
+  } else {
+    cvtColor(frame_, gray_, CV_RGB2GRAY);
+  }
+}
+
+void FrameContext::ComputeHsv() const {
+  cvtColor(frame_, hsv_, CV_RGB2HSV);
+}
+
+}  // namespace tl
@@ -0,0 +1,108 @@
+/*!
+ * \file framecontext.h
+ * \brief Images derived from a frame, shared by the components tracking on it.
+ * \author Joachim Valente <joachim.valente@gmail.com>
+ */
+
+#ifndef TL_FRAMECONTEXT_H
+#define TL_FRAMECONTEXT_H
+
+#include <mutex>
+
+#include <opencv2/core/core.hpp>
+
+#include "common.h"
+#include "tl_util/integralimages.h"
+
+namespace tl {
+
+/*!
+ * \brief A frame and the images derived from it.
+ *
+ * Detectors and background subtractors often need the same conversions of a
+ * frame (grayscale, HSV, lower resolutions, integral images). A context
+ * computes each of them on first request and keeps it for all the components
+ * working on the frame, whether they belong to one tracker or to several
+ * trackers following different objects in the same stream.
+ *
+ * A context can be reset to the next frame of a sequence, so that tracking a
+ * stream reuses the same one rather than creating one per frame.
+ *
+ * Color frames are RGB, as everywhere in Tracklib. All methods but `Reset()`
+ * are thread-safe.
+ */
+class FrameContext {
+public:
+  //-------------------------- Constructors --------------------------
+  /*!
+   * \brief No frame, to be given with `Reset()`.
+   */
+  FrameContext();
+
+  /*!
+   * \param frame Frame, not copied: it must be left unchanged while this
+   * object is used.
+   */
+  explicit FrameContext(const cv::Mat &frame);
+
+  /*!
+   * \brief Start over with another frame. The buffers of the images derived
+   * from the previous one go back to the pool.
+   * \param frame Frame, not copied, or an empty matrix to only release the
+   * previous one.
+   */
+  void Reset(const cv::Mat &frame);
+
+  //------------------------ Derived images --------------------------
+  const cv::Mat &frame() const;
+
+  /*!
+   * \brief Grayscale version of the frame, the frame itself if it is already
+   * grayscale.
+   */
+  const cv::Mat &gray() const;
+
+  /*!
+   * \brief HSV version of the frame, which must be in color.
+   */
+  const cv::Mat &hsv() const;
+
+  /*!
+   * \brief Level of the Gaussian pyramid of the frame.
+   * \param level 0 for the frame itself, each level halving the size of the
+   * previous one, up to kMaxPyramidLevels - 1.
+   */
+  const cv::Mat &pyramid(int level) const;
+
+  /*!
+   * \brief Integral images of the frame, e.g. for template matching.
+   */
+  const IntegralImages &integral_images() const;
+
+  static const int kMaxPyramidLevels = 16;  //!< Levels pyramid() can give.
+
+private:
+  //------------------------- Private methods ------------------------
+  void ComputeGray() const;
+  void ComputeHsv() const;
+
+  //------------------------- Private members ------------------------
+  cv::Mat frame_;                          //!< Frame (shared data).
+  mutable cv::Mat gray_;                   //!< Grayscale frame.
+  mutable bool gray_computed_;             //!< Whether gray_ was computed.
+  mutable std::mutex gray_mutex_;          //!< Guards gray_.
+  mutable cv::Mat hsv_;                    //!< HSV frame.
+  mutable bool hsv_computed_;              //!< Whether hsv_ was computed.
+  mutable std::mutex hsv_mutex_;           //!< Guards hsv_.
+  mutable cv::Mat pyramid_[kMaxPyramidLevels];  //!< Levels, in place so that
+                                                //!< references stay valid.
+  mutable int nb_pyramid_levels_;          //!< Levels computed so far.
+  mutable std::mutex pyramid_mutex_;       //!< Guards the pyramid.
+  IntegralImages integral_images_;         //!< Computed on first use.
+
+  DISALLOW_COPY_AND_ASSIGN(FrameContext);
+};
+
+}  // namespace tl
+
+#endif  // TL_FRAMECONTEXT_H
@@ -1,16 +1,45 @@
 #include "tl_core/tracker.h"
 
 #include "tl_util/conversions.h"
+#include "tl_util/matpool.h"
 
 using namespace tl::internal;
 
 namespace tl {
 
-//--------------------------- Constructor --------------------------
+namespace {
+
+const int kSnapshotMagic = 0x4E534C54;  // "TLSN".
+const int kSnapshotVersion = 3;
+
+}  // namespace
+
+//--------------------------- Constructors -------------------------
+DetectionSchedule::DetectionSchedule() :
+  skip_uncertainty(1.5),
+  local_uncertainty(8),
+  min_confidence(0.6f),
+  search_margin(16),
+  search_deviations(3),
+  max_skipped(2),
+  full_interval(25) {}
+
 Tracker::Tracker() :
   detector_(nullptr),
   filter_(nullptr),
-  bgs_(nullptr) {}
+  bgs_(nullptr),
+  state_(),
+  confidence_(1.0f),
+  adaptive_detection_(false),
+  schedule_(),
+  last_detection_(TL_DETECTION_FULL),
+  nb_skipped_in_row_(0),
+  nb_since_full_(0),
+  nb_detections_(),
+  frame_context_(),
+  preprocessed_context_(),
+  foreground_context_(),
+  measurement_() {}
 
 //-------------------------- Set components ------------------------
 void Tracker::set_detector(Detector *detector) {
@@ -47,46 +76,218 @@ std::string Tracker::ToString() const {
 
 //-------------------------- Main function --------------------------
 void Tracker::Track(const Mat &next_frame) {
+  frame_context_.Reset(PooledClone(next_frame));
+  Track(frame_context_);
+}
+
+void Tracker::Track(const FrameContext &context) {
   CHECK_NOTNULL(detector_);
 
-  cv::Mat frame = next_frame.clone();
-  frame = Preprocess(frame);
+  // Derived images are shared only if preprocessing leaves the frame as is.
+  const FrameContext *frame_context = &context;
+  Mat frame = Preprocess(context.frame());
+  if (frame.data != context.frame().data) {
+    preprocessed_context_.Reset(frame);
+    frame_context = &preprocessed_context_;
+  }
 
   if (bgs_ != nullptr) {
     // Segment foreground.
-    bgs_->NextFrame(frame);
-    frame = bgs_->GetForeground();
+    bgs_->NextFrame(*frame_context);
+    foreground_context_.Reset(bgs_->GetForeground());
+    frame_context = &foreground_context_;
   }
 
+  DetectionKind detection = TL_DETECTION_FULL;
+  Rect predicted;
+  double uncertainty = -1;
   if (filter_ != nullptr) {
     // Predict new position and feed it to the detector.
     filter_->Predict();
-    Mat predicted_x = filter_->predicted_x();
-    detector_->set_state(StateMatToRect(predicted_x));
+    predicted = StateMatToRect(filter_->predicted_x());
+    detector_->set_state(predicted);
+    uncertainty = filter_->PositionUncertainty();
+    if (adaptive_detection_) detection = ScheduleDetection(uncertainty);
   }
 
-  // Detect new state.
-  detector_->NextFrame(frame);
-  detector_->Detect();
+  if (detection == TL_DETECTION_SKIPPED) {
+    filter_->Extrapolate();
+    state_ = StateMatToRect(filter_->x());
+  } else {
+    // Detect new state.
+    detector_->NextFrame(*frame_context);
+    if (detection == TL_DETECTION_LOCAL) {
+      int margin = cvCeil(schedule_.search_margin +
+                          schedule_.search_deviations * uncertainty);
+      detector_->set_search_region(Rect(predicted.x - margin,
+                                        predicted.y - margin,
+                                        predicted.width + 2 * margin,
+                                        predicted.height + 2 * margin));
+      detector_->Detect();
+      if (detector_->confidence() < schedule_.min_confidence) {
+        detection = TL_DETECTION_FULL;
+        detector_->set_state(predicted);
+      }
+    }
+    if (detection == TL_DETECTION_FULL) {
+      if (adaptive_detection_) detector_->set_search_region(Rect());
+      detector_->Detect();
+    }
 
-  // Get measurement from core tracker.
-  state_ = detector_->state();
+    // Get measurement from core tracker.
+    state_ = detector_->state();
+    confidence_ = detector_->confidence();
 
-  if (filter_ != nullptr) {
-    // Feed measurement to Kalman filter and retrieve new state.
-    filter_->Update(StateRectToMat(state_));
-    state_ = StateMatToRect(filter_->x());
+    if (filter_ != nullptr) {
+      // Feed measurement to Kalman filter and retrieve new state.
+      StateRectToMat(state_, &measurement_);
+      filter_->Update(measurement_);
+      state_ = StateMatToRect(filter_->x());
+    }
   }
 
+  last_detection_ = detection;
+  ++nb_detections_[detection];
+  nb_skipped_in_row_ = (detection == TL_DETECTION_SKIPPED) ?
+                       nb_skipped_in_row_ + 1 : 0;
+  nb_since_full_ = (detection == TL_DETECTION_FULL) ? 0 : nb_since_full_ + 1;
+
+  // The contexts of the frame do not outlive this call.
+  detector_->ReleaseContext();
+
   Postprocess();
 }
 
+//----------------------- Adaptive detection ------------------------
+void Tracker::set_adaptive_detection(bool adaptive_detection) {
+  adaptive_detection_ = adaptive_detection;
+}
+
+void Tracker::set_detection_schedule(const DetectionSchedule &schedule) {
+  CHECK(schedule.skip_uncertainty >= 0);
+  CHECK(schedule.local_uncertainty >= schedule.skip_uncertainty);
+  CHECK(0.0f <= schedule.min_confidence && schedule.min_confidence <= 1.0f);
+  CHECK(schedule.search_margin >= 0 && schedule.search_deviations >= 0);
+  CHECK(schedule.max_skipped >= 0 && schedule.full_interval >= 1);
+  schedule_ = schedule;
+}
+
+DetectionKind Tracker::last_detection() const {
+  return last_detection_;
+}
+
+int Tracker::nb_detections(DetectionKind kind) const {
+  return nb_detections_[kind];
+}
+
 //------------------------ Public accessor --------------------------
 cv::Rect Tracker::state() const {
   CHECK_MSG(detector_, "detector has not been set yet");
   return state_;
 }
 
+void Tracker::set_state(cv::Rect state) {
+  CHECK_MSG(detector_, "detector has not been set yet");
+  state_ = state;
+  confidence_ = 1.0f;
+  detector_->set_state(state);
+  if (filter_ != nullptr) {
+    filter_->Init(StateRectToStandardMat(state));
+  }
+}
+
+float Tracker::confidence() const {
+  CHECK_MSG(detector_, "detector has not been set yet");
+  return confidence_;
+}
+
+//---------------------------- Snapshot -----------------------------
+bool Tracker::SaveState(std::string *snapshot) const {
+  CHECK_NOTNULL(snapshot);
+  CHECK_MSG(detector_, "detector has not been set yet");
+
+  SnapshotWriter writer;
+  writer.WriteInt(kSnapshotMagic);
+  writer.WriteInt(kSnapshotVersion);
+  writer.WriteInt(filter_ != nullptr);
+  writer.WriteInt(bgs_ != nullptr);
+  writer.WriteRect(state_);
+  writer.WriteFloat(confidence_);
+  writer.WriteInt(last_detection_);
+  writer.WriteInt(nb_skipped_in_row_);
+  writer.WriteInt(nb_since_full_);
+  for (int kind = 0; kind < kNbDetectionKinds; ++kind) {
+    writer.WriteInt(nb_detections_[kind]);
+  }
+  detector_->SaveState(&writer);
+  if (filter_ != nullptr) filter_->SaveState(&writer);
+  if (bgs_ != nullptr && !bgs_->SaveState(&writer)) return false;
+
+  *snapshot = writer.data();
+  return true;
+}
+
+bool Tracker::LoadState(const std::string &snapshot) {
+  CHECK_MSG(detector_, "detector has not been set yet");
+
+  SnapshotReader reader(snapshot);
+  int magic = 0;
+  int version = 0;
+  int has_filter = 0;
+  int has_bgs = 0;
+  Rect saved_state;
+  float saved_confidence = 0;
+  if (!reader.ReadInt(&magic) || magic != kSnapshotMagic ||
+      !reader.ReadInt(&version) || version != kSnapshotVersion ||
+      !reader.ReadInt(&has_filter) || has_filter != (filter_ != nullptr) ||
+      !reader.ReadInt(&has_bgs) || has_bgs != (bgs_ != nullptr) ||
+      !reader.ReadRect(&saved_state) || !reader.ReadFloat(&saved_confidence)) {
+    return false;
+  }
+  int saved_last_detection = 0;
+  int saved_nb_skipped_in_row = 0;
+  int saved_nb_since_full = 0;
+  int saved_nb_detections[kNbDetectionKinds];
+  if (!reader.ReadInt(&saved_last_detection) ||
+      saved_last_detection < 0 || saved_last_detection >= kNbDetectionKinds ||
+      !reader.ReadInt(&saved_nb_skipped_in_row) ||
+      !reader.ReadInt(&saved_nb_since_full)) {
+    return false;
+  }
+  for (int kind = 0; kind < kNbDetectionKinds; ++kind) {
+    if (!reader.ReadInt(&saved_nb_detections[kind])) return false;
+  }
+
+  if (!detector_->LoadState(&reader)) return false;
+  if (filter_ != nullptr && !filter_->LoadState(&reader)) return false;
+  if (bgs_ != nullptr && !bgs_->LoadState(&reader)) return false;
+  if (!reader.AtEnd()) return false;
+
+  state_ = saved_state;
+  confidence_ = saved_confidence;
+  last_detection_ = static_cast<DetectionKind>(saved_last_detection);
+  nb_skipped_in_row_ = saved_nb_skipped_in_row;
+  nb_since_full_ = saved_nb_since_full;
+  for (int kind = 0; kind < kNbDetectionKinds; ++kind) {
+    nb_detections_[kind] = saved_nb_detections[kind];
+  }
+  return true;
+}
+
+//-------------------------- Private methods ------------------------
+DetectionKind Tracker::ScheduleDetection(double uncertainty) const {
+  if (uncertainty < 0 || confidence_ < schedule_.min_confidence ||
+      nb_since_full_ + 1 >= schedule_.full_interval) {
+    return TL_DETECTION_FULL;
+  }
+  if (uncertainty <= schedule_.skip_uncertainty &&
+      nb_skipped_in_row_ < schedule_.max_skipped) {
+    return TL_DETECTION_SKIPPED;
+  }
+  if (uncertainty <= schedule_.local_uncertainty) return TL_DETECTION_LOCAL;
+  return TL_DETECTION_FULL;
+}
+
 //----------------------- Pre and post-processing --------------------
 cv::Mat Tracker::Preprocess(const Mat &frame) {
   return frame;
@@ -18,6 +18,42 @@
 
 namespace tl {
 
+/*!
+ * \brief Detection run by a tracker on a frame.
+ */
+enum DetectionKind {
+  TL_DETECTION_SKIPPED,   //!< None, the state is the prediction of the filter.
+  TL_DETECTION_LOCAL,     //!< Around the prediction of the filter.
+  TL_DETECTION_FULL       //!< On the whole frame.
+};
+
+/*!
+ * \brief Thresholds of adaptive detection (see
+ * Tracker::set_adaptive_detection()).
+ */
+struct DetectionSchedule {
+  //--------------------------- Constructor --------------------------
+  DetectionSchedule();
+
+  //----------------------------- Members ----------------------------
+  double skip_uncertainty;    //!< Largest position uncertainty, in pixels,
+                              //!< for which detection can be skipped
+                              //!< [def. 1.5].
+  double local_uncertainty;   //!< Largest one for a local detection [def. 8].
+  float min_confidence;       //!< Lowest confidence of the last detection for
+                              //!< which the next one can be skipped or local.
+                              //!< Local detections below it are redone on the
+                              //!< whole frame [def. 0.6].
+  double search_margin;       //!< Margin around the prediction searched by
+                              //!< local detections, in pixels [def. 16]...
+  double search_deviations;   //!< ...plus this many position standard
+                              //!< deviations [def. 3].
+  int max_skipped;            //!< Most consecutive frames without detection
+                              //!< [def. 2].
+  int full_interval;          //!< Most frames between two full detections
+                              //!< [def. 25].
+};
+
 /*!
  * \brief Generic tracker.
  *
@@ -56,21 +92,120 @@ public:
    */
   void Track(const cv::Mat &next_frame);
 
+  /*!
+   * \brief Track the object in the new frame, with its derived images shared
+   * with other trackers working on the same frame.
+   * \param context Context of the frame where to track the object. It is
+   * shared with the background subtractor and the detector, unless
+   * `Preprocess()` returns a new image (a context of that image is then used).
+   * The detector always gets a new one when a background subtractor is set,
+   * since it sees the foreground only.
+   */
+  void Track(const FrameContext &context);
+
+  //------------------------- Adaptive detection ----------------------
+  /*!
+   * \brief Let the uncertainty of the filter decide how much detection each
+   * frame gets [def. false].
+   *
+   * On each frame, the standard deviation of the position predicted by the
+   * filter and the confidence of the last detection give either:
+   * - no detection, the state being the prediction, when the prediction is
+   * tight and the last detection confident;
+   * - a detection in a region around the prediction (see
+   * Detector::set_search_region()) when it is loose; one with low confidence
+   * is redone on the whole frame;
+   * - a detection on the whole frame otherwise, and at least every
+   * `full_interval` frames.
+   * .
+   * Without filter, or with a filter that does not know its uncertainty,
+   * every frame gets a full detection.
+   */
+  void set_adaptive_detection(bool adaptive_detection);
+
+  void set_detection_schedule(const DetectionSchedule &schedule);
+
+  /*!
+   * \brief Detection run on the last frame.
+   */
+  DetectionKind last_detection() const;
+
+  /*!
+   * \brief Number of frames tracked with a kind of detection.
+   */
+  int nb_detections(DetectionKind kind) const;
+
   //---------------------------- Public accessor ------------------------
   cv::Rect state() const;
 
+  /*!
+   * \brief Override the current state, e.g. with a correction by the user.
+   *
+   * The detector continues from this state with full confidence and the
+   * filter, if any, is reset to it with zero velocity.
+   */
+  void set_state(cv::Rect state);
+
+  /*!
+   * \brief Confidence \f$ \in [0; 1] \f$ of the detector in the current state.
+   */
+  float confidence() const;
+
+  //------------------------------- Snapshot ---------------------------
+  /*!
+   * \brief Write the state of the tracker and of its components.
+   * \param snapshot Compact binary snapshot.
+   * \return Whether all components could be saved (see
+   * OnlineBackgroundSubtractor::SaveState()).
+   */
+  bool SaveState(std::string *snapshot) const;
+
+  /*!
+   * \brief Restore a snapshot written by `SaveState()`.
+   *
+   * The tracker must have been built like the saved one: components of the
+   * same classes and parameters, created from the same initial frame and
+   * object. Tracking then gives the same results as the saved tracker would
+   * have. After a failure, the tracker must not be used anymore.
+   * \return Whether the snapshot was valid.
+   */
+  bool LoadState(const std::string &snapshot);
+
 protected:
   //----------------------- Pre and post-processing ---------------------
   virtual cv::Mat Preprocess(const cv::Mat &frame);
   virtual void Postprocess();
 
 private:
+  //--------------------------- Private methods ------------------------
+  /*!
+   * \brief Detection to run on the current frame in adaptive mode.
+   * \param uncertainty Position uncertainty of the prediction.
+   */
+  DetectionKind ScheduleDetection(double uncertainty) const;
+
   //--------------------------- Private members ------------------------
+  static const int kNbDetectionKinds = 3;
+
   Detector *detector_;                //!< Detector. Not owned.
   Filter *filter_;                    //!< Filter. Not owned.
   BackgroundSubtractor *bgs_;         //!< Background subtractor. Not owned.
 
   cv::Rect state_;                    //!< Current state estimate.
+  float confidence_;                  //!< Confidence of current estimate.
+
+  bool adaptive_detection_;           //!< Whether detection is adaptive.
+  DetectionSchedule schedule_;        //!< Thresholds of adaptive detection.
+  DetectionKind last_detection_;      //!< Detection on the last frame.
+  int nb_skipped_in_row_;             //!< Frames without detection since the
+                                      //!< last detection.
+  int nb_since_full_;                 //!< Frames since the last full one.
+  int nb_detections_[kNbDetectionKinds];  //!< Frames by kind of detection.
+
+  FrameContext frame_context_;        //!< Contexts of the current frame, of
+  FrameContext preprocessed_context_; //!< its preprocessed version and of its
+  FrameContext foreground_context_;   //!< foreground, reset at every frame.
+  cv::Mat measurement_;               //!< Last state fed to the filter.
 
   DISALLOW_COPY_AND_ASSIGN(Tracker);
 };
@@ -1,5 +1,9 @@
 #include "tl_detectors/meanshiftdetector.h"
 
+#include <algorithm>
+
+#include "tl_util/matpool.h"
+
 using namespace cv;
 
 namespace tl {
@@ -10,37 +14,73 @@ MeanshiftDetector::MeanshiftDetector(const cv::Mat &initial_frame,
   Detector(initial_frame, initial_state),
   variant_(TL_MEANSHIFT),
   channels_to_use_(TL_H),
-  max_iter_(30) {
+  max_iter_(30),
+  template_score_(255) {
   ComputeTemplateHistogram();
 }
 
 //-------------------------- Main functions ------------------------
 void MeanshiftDetector::Detect() {
   // Compute back projection of the histogram.
-  Mat back_proj, converted_frame;
-  if (channels() == 3) {
-    cvtColor(frame(), converted_frame, CV_RGB2HSV);
-  } else {
-    converted_frame = frame();
-  }
+  Mat back_proj = PooledMat();
+  Mat converted_frame = (channels() == 3) ? context().hsv() : frame();
   calcBackProject(&converted_frame, 1, cn_, histogram_, back_proj, ranges_);
 
   // Apply meanshift or Camshift.
   TermCriteria term_crit(CV_TERMCRIT_EPS | CV_TERMCRIT_ITER, max_iter_, 1);
+  Rect s = state();
   if (variant_ == TL_MEANSHIFT) {
-    Rect s = state();
     cv::meanShift(back_proj, s, term_crit);
-    set_state(s);
   } else {
-    Rect s = state();
-    set_state(cv::CamShift(back_proj, s, term_crit).boundingRect());
+    s = cv::CamShift(back_proj, s, term_crit).boundingRect();
+  }
+
+  // Confidence: mean back projection over the window, relative to the one of
+  // the template.
+  Rect window = s & Rect(0, 0, width(), height());
+  float confidence = 0;
+  if (window.area() > 0) {
+    confidence = static_cast<float>(mean(back_proj(window))[0] /
+                                    template_score_);
   }
+  set_state(s, std::min(std::max(confidence, 0.0f), 1.0f));
 }
 
 std::string MeanshiftDetector::ToString() const {
   return (variant_ == TL_MEANSHIFT) ? "meanshift" : "camshift";
 }
 
+//----------------------------- Snapshot ---------------------------
+void MeanshiftDetector::SaveState(SnapshotWriter *writer) const {
+  Detector::SaveState(writer);
+  writer->WriteInt(variant_);
+  writer->WriteInt(channels_to_use_);
+  writer->WriteInt(max_iter_);
+  writer->WriteMat(histogram_);
+}
+
+bool MeanshiftDetector::LoadState(SnapshotReader *reader) {
+  int variant = 0;
+  int channels_to_use = 0;
+  int max_iter = 0;
+  Mat histogram;
+  if (!Detector::LoadState(reader) || !reader->ReadInt(&variant) ||
+      !reader->ReadInt(&channels_to_use) || !reader->ReadInt(&max_iter) ||
+      !reader->ReadMat(&histogram)) {
+    return false;
+  }
+  if ((variant != TL_MEANSHIFT && variant != TL_CAMSHIFT) ||
+      channels_to_use != channels_to_use_ || max_iter <= 0 ||
+      histogram.type() != CV_32F) {
+    return false;
+  }
+
+  variant_ = static_cast<MeanshiftVariant>(variant);
+  max_iter_ = max_iter;
+  histogram_ = histogram;
+  return true;
+}
+
 //----------------------- Public accessors -------------------------
 void MeanshiftDetector::set_variant(MeanshiftVariant variant) {
   variant_ = variant;
@@ -109,11 +149,18 @@ void MeanshiftDetector::ComputeTemplateHistogram() {
     inRange(hsv_object, Scalar(0, 60, 32), Scalar(180, 255, 255), mask);
     calcHist(&hsv_object, 1, cn_, mask, histogram_, nb_channels_, bin_sizes,
              ranges_);
+    object = hsv_object;
   } else {
     calcHist(&object, 1, cn_, Mat(), histogram_, nb_channels_, bin_sizes, ranges_);
   }
 
   normalize(histogram_, histogram_, 0, 255, cv::NORM_MINMAX);
+
+  // Score of the template itself, the reference of confidences. Even a good
+  // match stays well below 255 (only the most frequent bin reaches it).
+  Mat back_proj;
+  calcBackProject(&object, 1, cn_, histogram_, back_proj, ranges_);
+  template_score_ = std::max(mean(back_proj)[0], 1.0);
 }
 
 }  // namespace tl
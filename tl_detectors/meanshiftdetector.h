@@ -24,6 +24,10 @@ enum MeanshiftVariant {
 
 /*!
  * \brief Detector using meanshift or Camshift on HSV histograms.
+ *
+ * The confidence of a detection is the mean back projection of the histogram
+ * of the object over the window found, relative to its mean over the initial
+ * template (and at most 1), so that the object as first seen scores 1.
  */
 class MeanshiftDetector : public Detector {
 public:
@@ -34,6 +38,10 @@ public:
   void Detect();
   std::string ToString() const;
 
+  //--------------------------- Snapshot -----------------------------
+  void SaveState(SnapshotWriter *writer) const;
+  bool LoadState(SnapshotReader *reader);
+
   //------------------------ Public accessors ------------------------
   void set_variant(MeanshiftVariant variant);
   void set_channels_to_use(Channels channels_to_use);
@@ -55,6 +63,8 @@ private:
   cv::Mat histogram_;            //!< Color histogram of the template.
   const float *ranges_[2];        //!< Ranges used for each channel.
   int cn_[2];                    //!< Array of channel numbers.
+  double template_score_;        //!< Mean back projection of the histogram
+                                 //!< over the initial template.
 
   DISALLOW_COPY_AND_ASSIGN(MeanshiftDetector);
 };
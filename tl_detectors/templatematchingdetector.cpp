@@ -1,44 +1,273 @@
 #include "tl_detectors/templatematchingdetector.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "tl_util/geometry.h"
+#include "tl_util/matpool.h"
+
 using namespace cv;
+using namespace tl::internal;
 
 namespace tl {
 
-//------------------------- Constructor -------------------------
+namespace {
+
+// Confidence below the best one by which a scale is clearly losing.
+const float kLosingMargin = 0.15f;
+
+// Frames in a row a scale must be clearly losing to stop being matched.
+const int kNbLosingFrames = 5;
+
+// Frames between two detections matching all scales again.
+const int kRescanInterval = 50;
+
+bool IsMatchMethod(int method) {
+  return method == CV_TM_CCOEFF || method == CV_TM_CCOEFF_NORMED ||
+         method == CV_TM_CCORR || method == CV_TM_CCORR_NORMED ||
+         method == CV_TM_SQDIFF || method == CV_TM_SQDIFF_NORMED;
+}
+
+Size ScaledSize(Size size, double factor) {
+  return Size(cvRound(size.width * factor), cvRound(size.height * factor));
+}
+
+// Normalized correlation coefficient of a window and a template of the same
+// size and type, as CV_TM_CCOEFF_NORMED gives, without its buffers.
+double CorrelationCoefficient(const Mat &window, const Mat &templ) {
+  Scalar window_mean;
+  Scalar window_sdv;
+  Scalar templ_mean;
+  Scalar templ_sdv;
+  meanStdDev(window, window_mean, window_sdv);
+  meanStdDev(templ, templ_mean, templ_sdv);
+  double covariance = window.dot(templ) /
+                      (static_cast<double>(templ.rows) * templ.cols);
+  double window_variance = 0;
+  double templ_variance = 0;
+  for (int c = 0; c < templ.channels(); ++c) {
+    covariance -= window_mean[c] * templ_mean[c];
+    window_variance += window_sdv[c] * window_sdv[c];
+    templ_variance += templ_sdv[c] * templ_sdv[c];
+  }
+  if (templ_variance < DBL_EPSILON) return 1;  // As OpenCV.
+  if (window_variance < DBL_EPSILON) return 0;
+  return covariance / std::sqrt(window_variance * templ_variance);
+}
+
+}  // namespace
+
+//------------------------- Internal classes ----------------------
+/*!
+ * \brief Match a range of scales, for `cv::parallel_for_()`.
+ */
+class TemplateMatchingDetector::ScaleMatcher : public ParallelLoopBody {
+public:
+  ScaleMatcher(const TemplateMatchingDetector &detector,
+               const std::vector<Scale *> &scales) :
+    detector_(detector),
+    scales_(scales) {}
+
+  virtual void operator()(const Range &range) const {
+    for (int i = range.start; i < range.end; ++i) {
+      detector_.MatchScale(scales_[i]);
+    }
+  }
+
+private:
+  const TemplateMatchingDetector &detector_;
+  const std::vector<Scale *> &scales_;
+};
+
+//------------------------- Constructors ------------------------
+TemplateMatchingDetector::Scale::Scale(double scale_factor) :
+  factor(scale_factor),
+  templ(),
+  active(true),
+  nb_losing(0),
+  location(),
+  score(0) {}
+
 TemplateMatchingDetector::TemplateMatchingDetector(const cv::Mat &initial_frame,
                                                    cv::Rect initial_state) :
   Detector(initial_frame, initial_state),
   template_(initial_frame(initial_state).clone()),
-  opencv_method_(CV_TM_SQDIFF) {}
+  opencv_method_(CV_TM_SQDIFF),
+  scales_(),
+  active_(),
+  nb_since_rescan_(0) {
+  set_scales(std::vector<double>(1, 1.0));
+}
 
 //------------------------- Main methods ------------------------
 void TemplateMatchingDetector::Detect() {
-  Mat result;
-  matchTemplate(frame(), template_, result, opencv_method_);
+  // Match active scales concurrently; they share the integral images.
+  active_.clear();
+  for (Scale &scale : scales_) {
+    if (scale.active) active_.push_back(&scale);
+  }
+  parallel_for_(Range(0, static_cast<int>(active_.size())),
+                ScaleMatcher(*this, active_));
 
-  Point location;
-  if (opencv_method_ == CV_TM_SQDIFF || opencv_method_ == CV_TM_SQDIFF_NORMED) {
-    minMaxLoc(result, nullptr, nullptr, &location, nullptr);  // Locate min.
-  } else {
-    minMaxLoc(result, nullptr, nullptr, nullptr, &location);  // Locate max.
+  const Scale *best = active_.front();
+  for (const Scale *scale : active_) {
+    if (scale->score > best->score) best = scale;
+  }
+
+  if (scales_.size() == 1) {
+    set_state(best->location, best->score);
+    return;
+  }
+  set_state(Rect(best->location, best->templ.size()), best->score);
+
+  // Prune scales clearly losing, until all are tried again.
+  for (Scale *scale : active_) {
+    if (scale->score < best->score - kLosingMargin) {
+      if (++scale->nb_losing >= kNbLosingFrames) scale->active = false;
+    } else {
+      scale->nb_losing = 0;
+    }
+  }
+  if (++nb_since_rescan_ >= kRescanInterval) {
+    for (Scale &scale : scales_) {
+      scale.active = true;
+      scale.nb_losing = 0;
+    }
+    nb_since_rescan_ = 0;
   }
-  set_state(location);
 }
 
 std::string TemplateMatchingDetector::ToString() const {
   return "template matching detector";
 }
 
+//--------------------------- Snapshot --------------------------
+void TemplateMatchingDetector::SaveState(SnapshotWriter *writer) const {
+  Detector::SaveState(writer);
+  writer->WriteInt(opencv_method_);
+  writer->WriteMat(template_);
+  writer->WriteInt(static_cast<int>(scales_.size()));
+  for (const Scale &scale : scales_) {
+    writer->WriteDouble(scale.factor);
+    writer->WriteInt(scale.active);
+    writer->WriteInt(scale.nb_losing);
+  }
+  writer->WriteInt(nb_since_rescan_);
+}
+
+bool TemplateMatchingDetector::LoadState(SnapshotReader *reader) {
+  int method = 0;
+  Mat saved_template;
+  int nb_scales = 0;
+  if (!Detector::LoadState(reader) || !reader->ReadInt(&method) ||
+      !reader->ReadMat(&saved_template) || !reader->ReadInt(&nb_scales)) {
+    return false;
+  }
+  if (!IsMatchMethod(method) || saved_template.type() != template_.type() ||
+      saved_template.cols > width() || saved_template.rows > height() ||
+      nb_scales < 1) {
+    return false;
+  }
+  std::vector<double> factors(nb_scales);
+  std::vector<int> active(nb_scales);
+  std::vector<int> nb_losing(nb_scales);
+  for (int i = 0; i < nb_scales; ++i) {
+    if (!reader->ReadDouble(&factors[i]) || !(factors[i] > 0) ||
+        !reader->ReadInt(&active[i]) || !reader->ReadInt(&nb_losing[i])) {
+      return false;
+    }
+    // Every scale was kept when saved: none may be dropped now.
+    if (!FitsFrame(ScaledSize(saved_template.size(), factors[i])))
+      return false;
+  }
+  int saved_nb_since_rescan = 0;
+  if (!reader->ReadInt(&saved_nb_since_rescan)) return false;
+
+  // Valid: set_scales() keeps all the scales.
+  opencv_method_ = method;
+  template_ = saved_template;
+  set_scales(factors);
+  for (int i = 0; i < nb_scales; ++i) {
+    scales_[i].active = (active[i] != 0);
+    scales_[i].nb_losing = nb_losing[i];
+  }
+  nb_since_rescan_ = saved_nb_since_rescan;
+  return true;
+}
+
 //------------------------ Public accessors -------------------------
+const cv::Mat &TemplateMatchingDetector::template_image() const {
+  return template_;
+}
+
+int TemplateMatchingDetector::opencv_method() const {
+  return opencv_method_;
+}
+
 void TemplateMatchingDetector::set_opencv_method(int opencv_method) {
-  CHECK_MSG(opencv_method == CV_TM_CCOEFF ||
-            opencv_method == CV_TM_CCOEFF_NORMED ||
-            opencv_method == CV_TM_CCORR ||
-            opencv_method == CV_TM_CCORR_NORMED ||
-            opencv_method == CV_TM_SQDIFF ||
-            opencv_method == CV_TM_SQDIFF_NORMED,
-            "invalid method");
+  CHECK_MSG(IsMatchMethod(opencv_method), "invalid method");
   opencv_method_ = opencv_method;
 }
 
+void TemplateMatchingDetector::set_scales(const std::vector<double> &scales) {
+  scales_.clear();
+  for (double factor : scales) {
+    CHECK_MSG(factor > 0, "scales must be positive");
+    Size size = ScaledSize(template_.size(), factor);
+    if (!FitsFrame(size)) {
+      WARNING("scale " << factor << " dropped: template would be " << size);
+      continue;
+    }
+
+    Scale scale(factor);
+    if (size == template_.size()) {
+      scale.templ = template_;
+    } else {
+      resize(template_, scale.templ, size, 0, 0,
+             (factor < 1) ? INTER_AREA : INTER_LINEAR);
+    }
+    scales_.push_back(scale);
+  }
+  CHECK_MSG(!scales_.empty(), "no valid scale");
+  nb_since_rescan_ = 0;
+}
+
+//------------------------ Private methods --------------------------
+bool TemplateMatchingDetector::FitsFrame(Size size) const {
+  return size.width >= 1 && size.height >= 1 && size.width <= width() &&
+         size.height <= height();
+}
+
+void TemplateMatchingDetector::MatchScale(Scale *scale) const {
+  const Mat &templ = scale->templ;
+
+  // Windows inside the search region only.
+  Rect positions = WindowPositions(search_region(), templ.size(),
+                                   frame().size());
+  Rect windows(positions.tl(), positions.size() + templ.size() - Size(1, 1));
+  Mat result = PooledMat();
+  matchTemplate(frame()(windows), templ, result, CV_TM_CCORR);
+  context().integral_images().CompleteMatch(templ, opencv_method_,
+                                            positions.tl(), &result);
+
+  Point location;
+  if (opencv_method_ == CV_TM_SQDIFF || opencv_method_ == CV_TM_SQDIFF_NORMED) {
+    minMaxLoc(result, nullptr, nullptr, &location, nullptr);  // Locate min.
+  } else {
+    minMaxLoc(result, nullptr, nullptr, nullptr, &location);  // Locate max.
+  }
+  scale->location = location + positions.tl();
+
+  // Whatever the method, the confidence is the normalized correlation
+  // coefficient of the best window, so that it means the same for all
+  // methods and scales.
+  float confidence = static_cast<float>(CorrelationCoefficient(
+      frame()(Rect(scale->location, templ.size())), templ));
+  if (!(confidence > 0)) confidence = 0;  // Also when NaN.
+  scale->score = std::min(confidence, 1.0f);
+}
+
 }  // namespace tl
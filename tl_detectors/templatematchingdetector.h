@@ -8,6 +8,7 @@
 #define TL_TEMPLATEMATCHINGDETECTOR_H
 
 #include <string>
+#include <vector>
 
 #include <opencv2/core/core.hpp>
 
@@ -18,6 +19,17 @@ namespace tl {
 
 /*!
  * \brief Detector using template matching.
+ *
+ * The template is searched in the search region (see
+ * Detector::set_search_region()), the whole frame by default. The confidence
+ * of a detection is the normalized correlation coefficient of the template
+ * with the best window, negative values giving 0.
+ *
+ * With several scales (see `set_scales()`), the template is resized to each
+ * of them and all are matched concurrently on the integral images of the
+ * frame. The scale with the highest confidence gives the state, including its
+ * width and height. Scales clearly losing for several frames in a row stop
+ * being matched until all are tried again, every 50 frames.
  */
 class TemplateMatchingDetector : public Detector {
 public:
@@ -29,16 +41,65 @@ public:
 
   virtual std::string ToString() const;
 
+  //------------------------- Snapshot --------------------------
+  virtual void SaveState(SnapshotWriter *writer) const;
+  virtual bool LoadState(SnapshotReader *reader);
+
   //--------------------- Public accessors ------------------------
+  /*!
+   * \brief Template matched on each frame, e.g. to run several detectors as
+   * a batch with a MultiTemplateMatcher.
+   */
+  const cv::Mat &template_image() const;
+
+  int opencv_method() const;
   void set_opencv_method(int opencv_method);
 
+  /*!
+   * \brief Set the scales of the template to match [def. { 1 }].
+   * \param scales Positive factors applied to the size of the template.
+   * Those giving a template empty or larger than the frame are dropped.
+   */
+  void set_scales(const std::vector<double> &scales);
+
 private:
+  //---------------------- Internal structures -----------------------
+  struct Scale {
+    explicit Scale(double scale_factor);
+
+    double factor;                //!< Factor applied to the template size.
+    cv::Mat templ;                //!< Resized template.
+    bool active;                  //!< Whether it is matched.
+    int nb_losing;                //!< Frames in a row clearly losing.
+    cv::Point location;           //!< Best window on the last frame matched.
+    float score;                  //!< Its confidence.
+  };
+
+  class ScaleMatcher;
+
+  //----------------------- Private methods --------------------------
+  /*!
+   * \brief Whether a template of that size can be matched on the frame.
+   */
+  bool FitsFrame(cv::Size size) const;
+
+  /*!
+   * \brief Find the best window of a scale in the search region.
+   */
+  void MatchScale(Scale *scale) const;
+
   //---------------------- Internal members ------------------------
   cv::Mat template_;            //!< Template from the initial frame.
 
   int opencv_method_;                 //!< OpenCV comparison method (CV_TM_*)
                                       //!  [def. CV_TM_SQDIFF].
 
+  std::vector<Scale> scales_;         //!< Scales of the template.
+  std::vector<Scale *> active_;       //!< Those matched by the current
+                                      //!  detection.
+  int nb_since_rescan_;               //!< Frames since all scales were
+                                      //!  matched again.
+
   DISALLOW_COPY_AND_ASSIGN(TemplateMatchingDetector);
 };
 
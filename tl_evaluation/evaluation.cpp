@@ -0,0 +1,275 @@
+#include "tl_evaluation/evaluation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+using namespace cv;
+
+namespace tl {
+
+namespace {
+
+// Where the success rate and the precision are read on the curves.
+const int kSuccessRateIndex = 10;  // Overlap 0.5.
+const int kPrecisionIndex = 20;    // 20 pixels.
+
+// Start of the header of a CSV export of Multitrack, whose rows start with
+// the id of their task.
+const char kTaskHeader[] = "task,frame,";
+
+// Row of the values of column at indices.
+Mat Gather(const std::vector<float> &column, const std::vector<int> &indices) {
+  Mat_<float> gathered(1, static_cast<int>(indices.size()));
+  for (size_t i = 0; i < indices.size(); ++i) {
+    gathered(0, static_cast<int>(i)) = column[indices[i]];
+  }
+  return gathered;
+}
+
+}  // namespace
+
+//--------------------------- Constructors --------------------------
+Track::Track() :
+  frames_(),
+  x_(),
+  y_(),
+  width_(),
+  height_() {}
+
+Evaluation::Evaluation() :
+  nb_frames(0),
+  nb_missing(0),
+  mean_overlap(0),
+  mean_center_error(0),
+  success_rate(0),
+  success_auc(0),
+  precision(0),
+  success_curve(kNbOverlapThresholds, 0.0),
+  precision_curve(kNbDistanceThresholds, 0.0),
+  losses(),
+  fps(0) {}
+
+//------------------------ Public accessors ------------------------
+void Track::Append(int frame, cv::Rect rect) {
+  CHECK_MSG(frames_.empty() || frame > frames_.back(),
+            "frames must be increasing");
+  frames_.push_back(frame);
+  x_.push_back(static_cast<float>(rect.x));
+  y_.push_back(static_cast<float>(rect.y));
+  width_.push_back(static_cast<float>(rect.width));
+  height_.push_back(static_cast<float>(rect.height));
+}
+
+int Track::size() const {
+  return static_cast<int>(frames_.size());
+}
+
+bool Track::empty() const {
+  return frames_.empty();
+}
+
+int Track::frame(int i) const {
+  return frames_[i];
+}
+
+cv::Rect Track::rect(int i) const {
+  return Rect(cvRound(x_[i]), cvRound(y_[i]),
+              cvRound(width_[i]), cvRound(height_[i]));
+}
+
+int Track::Find(int frame) const {
+  std::vector<int>::const_iterator it =
+      std::lower_bound(frames_.begin(), frames_.end(), frame);
+  if (it == frames_.end() || *it != frame) return -1;
+  return static_cast<int>(it - frames_.begin());
+}
+
+//---------------------------- Files -------------------------------
+bool Track::Load(const std::string &path, std::string *error, int task) {
+  CHECK_NOTNULL(error);
+
+  std::ifstream in(path.c_str());
+  if (!in) {
+    *error = "could not open " + path;
+    return false;
+  }
+
+  Track track;
+  std::string line;
+  bool has_task_column = false;
+  while (std::getline(in, line)) {
+    if (line.compare(0, std::strlen(kTaskHeader), kTaskHeader) == 0) {
+      has_task_column = true;
+      continue;
+    }
+
+    int row_task = 0;
+    int frame = 0;
+    Rect rect;
+    if (has_task_column) {
+      if (std::sscanf(line.c_str(), "%d,%d,%d,%d,%d,%d", &row_task, &frame,
+                      &rect.x, &rect.y, &rect.width, &rect.height) != 6) {
+        continue;
+      }
+      if (task < 0) task = row_task;
+      if (row_task != task) continue;
+    } else if (std::sscanf(line.c_str(), "%d,%d,%d,%d,%d", &frame, &rect.x,
+                           &rect.y, &rect.width, &rect.height) != 5) {
+      continue;
+    }
+    if (!track.empty() && frame <= track.frames_.back()) {
+      *error = path + ": frames must be increasing";
+      return false;
+    }
+    track.Append(frame, rect);
+  }
+  if (in.bad()) {
+    *error = "could not read " + path;
+    return false;
+  }
+  *this = track;
+  return true;
+}
+
+//---------------------------- Evaluation --------------------------
+Evaluation Evaluate(const Track &ground_truth, const Track &results,
+                    double seconds, int nb_tracked) {
+  CHECK(nb_tracked >= 0);
+  Evaluation evaluation;
+  if (seconds > 0) evaluation.fps = nb_tracked / seconds;
+
+  // Pair frames of the ground truth with results, both being sorted.
+  std::vector<int> scored;          // Ground truth index of frames scored.
+  std::vector<int> matched;         // Position in scored of frames paired.
+  std::vector<int> truth_indices;   // Ground truth index of frames paired.
+  std::vector<int> result_indices;  // Result index of frames paired.
+  size_t r = 0;
+  for (size_t g = 0; g < ground_truth.frames_.size(); ++g) {
+    if (ground_truth.width_[g] <= 0 || ground_truth.height_[g] <= 0)
+      continue;
+    int frame = ground_truth.frames_[g];
+    while (r < results.frames_.size() && results.frames_[r] < frame) ++r;
+    if (r < results.frames_.size() && results.frames_[r] == frame) {
+      matched.push_back(static_cast<int>(scored.size()));
+      truth_indices.push_back(static_cast<int>(g));
+      result_indices.push_back(static_cast<int>(r));
+    }
+    scored.push_back(static_cast<int>(g));
+  }
+
+  int n = static_cast<int>(scored.size());
+  evaluation.nb_frames = n;
+  evaluation.nb_missing = n - static_cast<int>(matched.size());
+  if (n == 0) return evaluation;
+
+  // Overlaps and center errors of all paired frames at once.
+  Mat_<float> overlaps = Mat_<float>::zeros(1, n);  // 0 without result.
+  std::vector<float> errors;
+  if (!matched.empty()) {
+    Mat ax = Gather(ground_truth.x_, truth_indices);
+    Mat ay = Gather(ground_truth.y_, truth_indices);
+    Mat aw = Gather(ground_truth.width_, truth_indices);
+    Mat ah = Gather(ground_truth.height_, truth_indices);
+    Mat bx = Gather(results.x_, result_indices);
+    Mat by = Gather(results.y_, result_indices);
+    Mat bw = Gather(results.width_, result_indices);
+    Mat bh = Gather(results.height_, result_indices);
+
+    Mat a_right = ax + aw;
+    Mat a_bottom = ay + ah;
+    Mat b_right = bx + bw;
+    Mat b_bottom = by + bh;
+    Mat intersection_width = cv::min(a_right, b_right) - cv::max(ax, bx);
+    Mat intersection_height = cv::min(a_bottom, b_bottom) - cv::max(ay, by);
+    intersection_width = cv::max(intersection_width, 0.0);
+    intersection_height = cv::max(intersection_height, 0.0);
+    Mat intersection = intersection_width.mul(intersection_height);
+    Mat union_area = aw.mul(ah) + bw.mul(bh) - intersection;
+    Mat paired_overlaps;
+    divide(intersection, union_area, paired_overlaps);  // Union is not 0.
+
+    Mat dx = (ax + 0.5 * aw) - (bx + 0.5 * bw);
+    Mat dy = (ay + 0.5 * ah) - (by + 0.5 * bh);
+    Mat paired_errors;
+    magnitude(dx, dy, paired_errors);
+
+    for (size_t i = 0; i < matched.size(); ++i) {
+      overlaps(0, matched[i]) =
+          paired_overlaps.at<float>(0, static_cast<int>(i));
+    }
+    errors.assign(paired_errors.begin<float>(), paired_errors.end<float>());
+    evaluation.mean_center_error = mean(paired_errors)[0];
+  }
+  evaluation.mean_overlap = sum(overlaps)[0] / n;
+
+  // Curves, read on the sorted values.
+  std::vector<float> sorted(overlaps.begin(), overlaps.end());
+  std::sort(sorted.begin(), sorted.end());
+  for (int t = 0; t < Evaluation::kNbOverlapThresholds; ++t) {
+    float threshold = static_cast<float>(t) /
+                      (Evaluation::kNbOverlapThresholds - 1);
+    ptrdiff_t above = sorted.end() -
+                      std::upper_bound(sorted.begin(), sorted.end(), threshold);
+    evaluation.success_curve[t] = static_cast<double>(above) / n;
+    evaluation.success_auc += evaluation.success_curve[t] /
+                              Evaluation::kNbOverlapThresholds;
+  }
+  std::sort(errors.begin(), errors.end());
+  for (int t = 0; t < Evaluation::kNbDistanceThresholds; ++t) {
+    ptrdiff_t below = std::upper_bound(errors.begin(), errors.end(),
+                                       static_cast<float>(t)) - errors.begin();
+    evaluation.precision_curve[t] = static_cast<double>(below) / n;
+  }
+  evaluation.success_rate = evaluation.success_curve[kSuccessRateIndex];
+  evaluation.precision = evaluation.precision_curve[kPrecisionIndex];
+
+  // The object is lost when the overlap drops to 0.
+  bool lost = false;
+  for (int i = 0; i < n; ++i) {
+    bool lost_here = overlaps(0, i) <= 0;
+    if (lost_here && !lost)
+      evaluation.losses.push_back(ground_truth.frames_[scored[i]]);
+    lost = lost_here;
+  }
+
+  return evaluation;
+}
+
+std::vector<Evaluation> EvaluateAll(const Track &ground_truth,
+                                    const std::vector<Track> &results,
+                                    const std::vector<double> &seconds,
+                                    const std::vector<int> &nb_tracked,
+                                    int nb_cores) {
+  CHECK(seconds.empty() || seconds.size() == results.size());
+  CHECK(nb_tracked.size() == seconds.size());
+  std::vector<Evaluation> evaluations(results.size());
+  if (results.empty()) return evaluations;
+
+  std::atomic<size_t> next(0);
+  auto work = [&]() {
+    for (size_t i = next++; i < results.size(); i = next++) {
+      evaluations[i] = Evaluate(ground_truth, results[i],
+                                seconds.empty() ? 0 : seconds[i],
+                                nb_tracked.empty() ? 0 : nb_tracked[i]);
+    }
+  };
+
+  int nb_workers = std::min(std::max(1, nb_cores),
+                            static_cast<int>(results.size()));
+  std::vector<std::thread> workers;
+  for (int i = 1; i < nb_workers; ++i) {
+    workers.push_back(std::thread(work));
+  }
+  work();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  return evaluations;
+}
+
+}  // namespace tl
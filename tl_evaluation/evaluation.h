@@ -0,0 +1,138 @@
+/*!
+ * \file evaluation.h
+ * \brief Scores of tracking results against ground truth.
+ * \author Joachim Valente <joachim.valente@gmail.com>
+ */
+
+#ifndef TL_EVALUATION_H
+#define TL_EVALUATION_H
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "common.h"
+
+namespace tl {
+
+struct Evaluation;
+
+/*!
+ * \brief Rects of an object by frame.
+ *
+ * Coordinates are stored column by column so that whole tracks are scored
+ * with a few vectorized operations instead of rect by rect.
+ */
+class Track {
+public:
+  //--------------------------- Constructor --------------------------
+  Track();
+
+  //------------------------ Public accessors ------------------------
+  /*!
+   * \brief Add the rect of a frame after the last one.
+   */
+  void Append(int frame, cv::Rect rect);
+
+  int size() const;
+  bool empty() const;
+  int frame(int i) const;
+  cv::Rect rect(int i) const;
+
+  /*!
+   * \brief Index of a frame, -1 if absent.
+   */
+  int Find(int frame) const;
+
+  //---------------------------- Files -------------------------------
+  /*!
+   * \brief Read rows `frame,x,y,width,height[,...]`, such as the results of
+   * BatchRunner, or rows `task,frame,x,y,width,height[,...]` of a CSV export
+   * of Multitrack, recognized by its header `task,frame,...`. Other rows are
+   * skipped and frames must be increasing.
+   * \param path Path of the file.
+   * \param error Reason of the failure, if any.
+   * \param task Task to read from a CSV export of Multitrack, -1 for the
+   * first one.
+   * \return Whether the file could be read.
+   */
+  bool Load(const std::string &path, std::string *error, int task = -1);
+
+private:
+  //------------------------- Private members ------------------------
+  std::vector<int> frames_;      //!< Increasing frame numbers.
+  std::vector<float> x_;         //!< Left coordinates.
+  std::vector<float> y_;         //!< Top coordinates.
+  std::vector<float> width_;     //!< Widths.
+  std::vector<float> height_;    //!< Heights.
+
+  friend Evaluation Evaluate(const Track &ground_truth, const Track &results,
+                             double seconds, int nb_tracked);
+};
+
+/*!
+ * \brief Accuracy and speed of results against ground truth.
+ *
+ * Frames are the ones with a non-empty rect in the ground truth, so that
+ * frames where the object is absent or occluded can be marked with an empty
+ * one. A frame without result counts as a failure.
+ */
+struct Evaluation {
+  //--------------------------- Constructor --------------------------
+  Evaluation();
+
+  //------------------------------ Constants -------------------------
+  static const int kNbOverlapThresholds = 21;    //!< 0, 0.05, ..., 1.
+  static const int kNbDistanceThresholds = 51;   //!< 0, 1, ..., 50 pixels.
+
+  //----------------------------- Members ----------------------------
+  int nb_frames;              //!< Frames of the ground truth scored.
+  int nb_missing;             //!< Those without result.
+  double mean_overlap;        //!< Mean intersection over union.
+  double mean_center_error;   //!< Mean distance between centers, in pixels,
+                              //!< over frames with a result.
+  double success_rate;        //!< Fraction of frames with overlap > 0.5.
+  double success_auc;         //!< Area under the success curve.
+  double precision;           //!< Fraction of frames with a center error of
+                              //!< at most 20 pixels.
+  std::vector<double> success_curve;    //!< Fraction of frames with overlap
+                                        //!< above each overlap threshold.
+  std::vector<double> precision_curve;  //!< Fraction of frames with center
+                                        //!< error at most each threshold.
+  std::vector<int> losses;    //!< Frames where the object is lost (overlap
+                              //!< drops to 0).
+  double fps;                 //!< Frames tracked per second, 0 if unknown.
+};
+
+/*!
+ * \brief Score results against ground truth.
+ * \param ground_truth Reference track.
+ * \param results Track to score, e.g. the states of a Tracker.
+ * \param seconds Time taken to track results, 0 if unknown.
+ * \param nb_tracked Frames tracked in that time, fewer than the frames of
+ * results when they start with the initial object, which is not tracked.
+ */
+Evaluation Evaluate(const Track &ground_truth, const Track &results,
+                    double seconds, int nb_tracked);
+
+/*!
+ * \brief Score many results against the same ground truth on several
+ * threads.
+ * \param ground_truth Reference track.
+ * \param results Tracks to score.
+ * \param seconds Time taken to track each of results, or empty if unknown.
+ * \param nb_tracked Frames tracked in that time for each of results, or
+ * empty if seconds is.
+ * \param nb_cores Number of cores to use (at least 1).
+ * \return One evaluation per track, in the same order.
+ */
+std::vector<Evaluation> EvaluateAll(const Track &ground_truth,
+                                    const std::vector<Track> &results,
+                                    const std::vector<double> &seconds,
+                                    const std::vector<int> &nb_tracked,
+                                    int nb_cores);
+
+}  // namespace tl
+
+#endif  // TL_EVALUATION_H
@@ -0,0 +1,168 @@
+#include "tl_filters/constantvelocityfilter.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "tl_util/conversions.h"
+
+using namespace cv;
+using namespace tl::internal;
+
+namespace tl {
+
+namespace {
+
+// Rows of the position and the velocity of each system in the state matrix of
+// the standard tracking model. The measurement holds the positions in order.
+const int kPositionRows[] = {0, 1, 4, 5};
+const int kVelocityRows[] = {2, 3, 6, 7};
+
+}  // namespace
+
+//-------------------------- Constructors --------------------------
+ConstantVelocityFilter::Lanes::Lanes() :
+  position(),
+  velocity(),
+  P00(),
+  P01(),
+  P11() {}
+
+ConstantVelocityFilter::ConstantVelocityFilter(float q, float r) :
+  q_(q),
+  r_(r),
+  lanes_(),
+  predicted_lanes_() {
+  Pack(lanes_, &x_);
+}
+
+ConstantVelocityFilter::ConstantVelocityFilter(const cv::Mat &x0, float q,
+                                               float r) :
+  ConstantVelocityFilter(q, r) {
+  Init(x0);
+}
+
+ConstantVelocityFilter::ConstantVelocityFilter(cv::Rect x0, float q, float r) :
+  ConstantVelocityFilter(q, r) {
+  Init(StateRectToStandardMat(x0));
+}
+
+//---------------------------- Initialization ----------------------------
+void ConstantVelocityFilter::Init(const cv::Mat &x0) {
+  CHECK(x0.rows == 8 && x0.cols == 1 && x0.type() == CV_32F);
+  Unpack(x0, &lanes_);
+  Pack(lanes_, &x_);
+}
+
+//------------------------------ Update ---------------------------------
+// Closed form of the products of KalmanFilter::Update() with H = [ 1 0 ] and
+// R = r on each system.
+void ConstantVelocityFilter::Update(const cv::Mat &z) {
+  CHECK(z.rows == kNbLanes && z.cols == 1 && z.type() == CV_32F);
+  const float *measurement = z.ptr<float>();
+  const Lanes &p = predicted_lanes_;
+  Lanes &l = lanes_;
+
+  for (int i = 0; i < kNbLanes; ++i) {
+    float y = measurement[i] - p.position[i];     // Innovation.
+    float inv_S = 1.f / (p.P00[i] + r_);          // Innovation covariance.
+    float K0 = p.P00[i] * inv_S;                  // Optimal Kalman gain.
+    float K1 = p.P01[i] * inv_S;
+    l.position[i] = p.position[i] + K0 * y;       // A posteriori estimate.
+    l.velocity[i] = p.velocity[i] + K1 * y;
+    l.P00[i] = (1.f - K0) * p.P00[i];             // Updated covariance.
+    l.P01[i] = (1.f - K0) * p.P01[i];
+    l.P11[i] = p.P11[i] - K1 * p.P01[i];
+  }
+  Pack(lanes_, &x_);
+}
+
+//------------------------------- Prediction --------------------------
+// Closed form of F P F^T + Q with F = [ 1 1 ; 0 1 ] and Q = q I on each
+// system.
+void ConstantVelocityFilter::Predict() {
+  const Lanes &l = lanes_;
+  Lanes &p = predicted_lanes_;
+
+  for (int i = 0; i < kNbLanes; ++i) {
+    p.position[i] = l.position[i] + l.velocity[i];  // A priori estimate.
+    p.velocity[i] = l.velocity[i];
+    p.P00[i] = (l.P00[i] + l.P01[i]) + (l.P01[i] + l.P11[i]) + q_;
+    p.P01[i] = l.P01[i] + l.P11[i];                 // A priori covariance.
+    p.P11[i] = l.P11[i] + q_;
+  }
+  Pack(predicted_lanes_, &predicted_x_);
+}
+
+void ConstantVelocityFilter::Extrapolate() {
+  lanes_ = predicted_lanes_;
+  Pack(lanes_, &x_);
+}
+
+double ConstantVelocityFilter::PositionUncertainty() const {
+  if (predicted_x_.empty()) return -1;
+  double variance = std::max(predicted_lanes_.P00[0],
+                             predicted_lanes_.P00[1]);
+  return std::sqrt(std::max(variance, 0.0));
+}
+
+//------------------------------ Description --------------------------
+std::string ConstantVelocityFilter::ToString() const {
+  return "Kalman filter (constant velocity)";
+}
+
+//------------------------------- Snapshot ----------------------------
+void ConstantVelocityFilter::SaveState(SnapshotWriter *writer) const {
+  Filter::SaveState(writer);
+  for (const Lanes *lanes : {&lanes_, &predicted_lanes_}) {
+    for (int i = 0; i < kNbLanes; ++i) {
+      writer->WriteFloat(lanes->P00[i]);
+      writer->WriteFloat(lanes->P01[i]);
+      writer->WriteFloat(lanes->P11[i]);
+    }
+  }
+}
+
+bool ConstantVelocityFilter::LoadState(SnapshotReader *reader) {
+  if (!Filter::LoadState(reader)) return false;
+
+  Lanes lanes;
+  Lanes predicted_lanes;
+  Unpack(x_, &lanes);
+  if (!predicted_x_.empty()) Unpack(predicted_x_, &predicted_lanes);
+  for (Lanes *l : {&lanes, &predicted_lanes}) {
+    for (int i = 0; i < kNbLanes; ++i) {
+      if (!reader->ReadFloat(&l->P00[i]) || !reader->ReadFloat(&l->P01[i]) ||
+          !reader->ReadFloat(&l->P11[i])) {
+        return false;
+      }
+    }
+  }
+
+  lanes_ = lanes;
+  predicted_lanes_ = predicted_lanes;
+  return true;
+}
+
+bool ConstantVelocityFilter::IsValidState(const cv::Mat &x,
+                                          const cv::Mat &predicted_x) const {
+  return Filter::IsValidState(x, predicted_x) && x.rows == 2 * kNbLanes;
+}
+
+//----------------------------- Private methods -----------------------
+void ConstantVelocityFilter::Pack(const Lanes &lanes, cv::Mat *x) {
+  x->create(8, 1, CV_32F);
+  float *data = x->ptr<float>();
+  for (int i = 0; i < kNbLanes; ++i) {
+    data[kPositionRows[i]] = lanes.position[i];
+    data[kVelocityRows[i]] = lanes.velocity[i];
+  }
+}
+
+void ConstantVelocityFilter::Unpack(const cv::Mat &x, Lanes *lanes) {
+  for (int i = 0; i < kNbLanes; ++i) {
+    lanes->position[i] = x.at<float>(kPositionRows[i]);
+    lanes->velocity[i] = x.at<float>(kVelocityRows[i]);
+  }
+}
+
+}  // namespace tl
@@ -1,4 +1,8 @@
 #include "tl_filters/kalmanfilter.h"
+
+#include <algorithm>
+#include <cmath>
+
 #include "tl_util/conversions.h"
 
 using namespace cv;
@@ -6,9 +10,28 @@ using namespace tl::internal;
 
 namespace tl {
 
+namespace {
+
+// Relative change of the covariance below which it has converged.
+const double kConvergenceTolerance = 1e-5;
+
+// Most iterations of the Riccati equation when solving it.
+const int kMaxRiccatiIterations = 10000;
+
+bool HasConverged(const Mat &previous_P, const Mat &P) {
+  return norm(P - previous_P, NORM_INF) <=
+         kConvergenceTolerance * std::max(1.0, norm(P, NORM_INF));
+}
+
+}  // namespace
+
 //-------------------------- Constructors --------------------------
 KalmanFilter::KalmanFilter(const cv::Mat &F, const cv::Mat &H, const cv::Mat &Q,
-                           const cv::Mat &R) {
+                           const cv::Mat &R) :
+  innovation_(),
+  steady_state_(false),
+  in_steady_state_(false),
+  steady_K_() {
   CHECK(F.channels() == 1);
   CHECK(H.channels() == 1);
   CHECK(Q.channels() == 1);
@@ -41,7 +64,11 @@ KalmanFilter::KalmanFilter(const cv::Mat &F, const cv::Mat &H, const cv::Mat &Q,
   Init(StateRectToStandardMat(x0));
 }
 
-KalmanFilter::KalmanFilter(float q, float r) {
+KalmanFilter::KalmanFilter(float q, float r) :
+  innovation_(),
+  steady_state_(false),
+  in_steady_state_(false),
+  steady_K_() {
   Mat I2 = Mat::eye(2, 2, CV_32F);
 
   Mat F = Mat::zeros(8, 8, CV_32F);
@@ -89,29 +116,148 @@ KalmanFilter::KalmanFilter(cv::Rect x0, float q, float r) :
 void KalmanFilter::Init(const cv::Mat &x0) {
   CHECK(x0.rows == F_.rows && x0.cols == 1);
 
-  x_ = x0;
+  x_ = x0.clone();
 }
 
 //------------------------------ Update ---------------------------------
 void KalmanFilter::Update(const cv::Mat &z) {
   CHECK(z.rows == H_.rows);
-  Mat y = z - H_ * predicted_x_;               // Innovation.
-  Mat S = H_ * predicted_P_ * H_.t() + R_;     // Innovation covariance.
-  Mat K = predicted_P_ * H_.t() * S.inv();     // Optimal Kalman gain.
-  x_ = predicted_x_ + K * y;                   // A posteriori state estimate.
-  Mat I = cv::Mat::eye(P_.rows, P_.cols, CV_32F);
-  P_ = (I - K * H_) * predicted_P_;            // Updated state covariance.
+  gemm(H_, predicted_x_, -1, z, 1, innovation_);  // z - H x.
+  if (in_steady_state_) {
+    gemm(steady_K_, innovation_, 1, predicted_x_, 1, x_);
+    return;
+  }
+
+  Mat K;
+  Mat P;
+  ComputeGain(predicted_P_, &K, &P);
+  x_ = predicted_x_ + K * innovation_;         // A posteriori state estimate.
+  if (steady_state_ && HasConverged(P_, P)) {
+    in_steady_state_ = true;
+    steady_K_ = K;
+  }
+  P_ = P;
 }
 
 //------------------------------- Prediction --------------------------
 void KalmanFilter::Predict() {
-  predicted_x_ = F_ * x_;                  // A priori state estimate.
+  gemm(F_, x_, 1, noArray(), 0, predicted_x_);  // A priori state estimate.
+  if (in_steady_state_) return;            // Covariance is constant.
   predicted_P_ = F_ * P_ * F_.t() + Q_;    // A priori state covariance.
 }
 
+void KalmanFilter::Extrapolate() {
+  x_ = predicted_x_.clone();
+  P_ = predicted_P_.clone();
+  in_steady_state_ = false;
+}
+
+//------------------------------ Steady state --------------------------
+void KalmanFilter::set_steady_state(bool steady_state) {
+  steady_state_ = steady_state;
+  if (!steady_state) in_steady_state_ = false;
+}
+
+bool KalmanFilter::SolveSteadyState() {
+  Mat P = P_.clone();
+  for (int i = 0; i < kMaxRiccatiIterations; ++i) {
+    Mat predicted_P = F_ * P * F_.t() + Q_;
+    Mat K;
+    Mat next_P;
+    ComputeGain(predicted_P, &K, &next_P);
+    if (HasConverged(P, next_P)) {
+      P_ = next_P;
+      predicted_P_ = F_ * P_ * F_.t() + Q_;
+      steady_K_ = K;
+      steady_state_ = true;
+      in_steady_state_ = true;
+      return true;
+    }
+    P = next_P;
+  }
+  return false;
+}
+
+bool KalmanFilter::in_steady_state() const {
+  return in_steady_state_;
+}
+
+//----------------------------- Private methods -----------------------
+void KalmanFilter::ComputeGain(const cv::Mat &predicted_P, cv::Mat *K,
+                               cv::Mat *P) const {
+  Mat S = H_ * predicted_P * H_.t() + R_;      // Innovation covariance.
+  *K = predicted_P * H_.t() * S.inv();         // Optimal Kalman gain.
+  Mat I = cv::Mat::eye(P_.rows, P_.cols, CV_32F);
+  *P = (I - *K * H_) * predicted_P;            // Updated state covariance.
+}
+
+double KalmanFilter::PositionUncertainty() const {
+  if (predicted_P_.empty() || H_.rows < 2) return -1;
+
+  // Largest of the first two diagonal terms of H P H^T.
+  double variance = 0;
+  for (int i = 0; i < 2; ++i) {
+    const float *h = H_.ptr<float>(i);
+    double row_variance = 0;
+    for (int j = 0; j < H_.cols; ++j) {
+      const float *P = predicted_P_.ptr<float>(j);
+      for (int k = 0; k < H_.cols; ++k) {
+        row_variance += h[j] * P[k] * h[k];
+      }
+    }
+    variance = std::max(variance, row_variance);
+  }
+  return std::sqrt(variance);
+}
+
 //------------------------------ Description --------------------------
 std::string KalmanFilter::ToString() const {
   return "Kalman filter";
 }
 
+//------------------------------- Snapshot ----------------------------
+void KalmanFilter::SaveState(SnapshotWriter *writer) const {
+  Filter::SaveState(writer);
+  writer->WriteMat(P_);
+  writer->WriteMat(predicted_P_);
+  writer->WriteInt(steady_state_);
+  writer->WriteInt(in_steady_state_);
+  writer->WriteMat(steady_K_);
+}
+
+bool KalmanFilter::LoadState(SnapshotReader *reader) {
+  Mat P;
+  Mat predicted_P;
+  int steady_state = 0;
+  int in_steady_state = 0;
+  Mat steady_K;
+  if (!Filter::LoadState(reader) || !reader->ReadMat(&P) ||
+      !reader->ReadMat(&predicted_P) || !reader->ReadInt(&steady_state) ||
+      !reader->ReadInt(&in_steady_state) || !reader->ReadMat(&steady_K)) {
+    return false;
+  }
+  if (P.size() != F_.size() || P.type() != CV_32F) return false;
+  if (!predicted_P.empty() &&
+      (predicted_P.size() != F_.size() || predicted_P.type() != CV_32F)) {
+    return false;
+  }
+  if (in_steady_state &&
+      (steady_K.rows != F_.rows || steady_K.cols != H_.rows ||
+       steady_K.type() != CV_32F)) {
+    return false;
+  }
+
+  P_ = P;
+  predicted_P_ = predicted_P;
+  steady_state_ = (steady_state != 0);
+  in_steady_state_ = (in_steady_state != 0);
+  steady_K_ = steady_K;
+  return true;
+}
+
+bool KalmanFilter::IsValidState(const cv::Mat &x,
+                                const cv::Mat &predicted_x) const {
+  return Filter::IsValidState(x, predicted_x) && x.rows == F_.rows;
+}
+
 }  // namespace tl
@@ -14,6 +14,14 @@
 
 namespace tl {
 
+/*!
+ * \brief Kalman filter with a time-invariant model.
+ *
+ * Since the model does not change, the covariance and the gain converge to
+ * fixed values. In steady-state mode the gain is frozen once reached, and
+ * each step is then a few matrix-vector products instead of the covariance
+ * propagation and the inversion of the innovation covariance.
+ */
 class KalmanFilter : public Filter {
 public:
   //------------------------- Constructors ------------------------
@@ -75,9 +83,31 @@ public:
 
   //------------------------- Initialization ----------------------
   /*!
-   * \brief Initialize with initial state.
+   * \copydoc Filter::Init(const cv::Mat&)
+   * \note Velocities are given by x0 and the covariance is kept.
+   */
+  virtual void Init(const cv::Mat &x0);
+
+  //-------------------------- Steady state -----------------------
+  /*!
+   * \brief Freeze the gain and the covariance once the covariance converges
+   * [def. false]. Results are those of the full filter within the
+   * convergence tolerance.
+   */
+  void set_steady_state(bool steady_state);
+
+  /*!
+   * \brief Solve the discrete Riccati equation of the model by iterating it
+   * from the current covariance, and switch to the steady-state gain.
+   * \return Whether the covariance converged (the filter is left unchanged
+   * otherwise).
+   */
+  bool SolveSteadyState();
+
+  /*!
+   * \brief Whether the gain is frozen.
    */
-  void Init(const cv::Mat &x0);
+  bool in_steady_state() const;
 
   //------------------------- Core functions ----------------------
   /*!
@@ -90,12 +120,46 @@ public:
    */
   virtual void Update(const cv::Mat &z);
 
+  /*!
+   * \copydoc Filter::Extrapolate()
+   * \note The covariance grows as after a prediction, which leaves the steady
+   * state until the covariance converges again.
+   */
+  virtual void Extrapolate();
+
+  /*!
+   * \copydoc Filter::PositionUncertainty()
+   * \note Read on the first two components of the predicted measurement.
+   */
+  virtual double PositionUncertainty() const;
+
   /*!
    * \copydoc Filter::ToString()
    */
   virtual std::string ToString() const;
 
+  //---------------------------- Snapshot -------------------------
+  /*!
+   * \copydoc Filter::SaveState(SnapshotWriter*) const
+   */
+  virtual void SaveState(SnapshotWriter *writer) const;
+
+  /*!
+   * \copydoc Filter::LoadState(SnapshotReader*)
+   */
+  virtual bool LoadState(SnapshotReader *reader);
+
+protected:
+  //------------------------ Protected methods ----------------------
+  virtual bool IsValidState(const cv::Mat &x, const cv::Mat &predicted_x) const;
+
 private:
+  //------------------------ Private methods ----------------------
+  /*!
+   * \brief Gain and updated covariance for a predicted covariance.
+   */
+  void ComputeGain(const cv::Mat &predicted_P, cv::Mat *K, cv::Mat *P) const;
+
   //------------------------ Private members ----------------------
   cv::Mat F_;                 //!< Dynamic model.
   cv::Mat H_;                 //!< Observation model.
@@ -103,6 +167,11 @@ private:
   cv::Mat R_;                 //!< Covariance of observation noise.
   cv::Mat P_;                 //!< State covariance estimate.
   cv::Mat predicted_P_;       //!< Predicted covariance.
+  cv::Mat innovation_;        //!< Innovation of the last update.
+
+  bool steady_state_;         //!< Whether to freeze the gain on convergence.
+  bool in_steady_state_;      //!< Whether the gain is frozen.
+  cv::Mat steady_K_;          //!< Frozen gain.
 
   DISALLOW_COPY_AND_ASSIGN(KalmanFilter);
 };
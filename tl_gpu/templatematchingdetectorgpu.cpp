@@ -6,6 +6,16 @@ using namespace cv;
 
 namespace tl {
 
+namespace {
+
+bool IsMatchMethod(int method) {
+  return method == CV_TM_CCOEFF || method == CV_TM_CCOEFF_NORMED ||
+         method == CV_TM_CCORR || method == CV_TM_CCORR_NORMED ||
+         method == CV_TM_SQDIFF || method == CV_TM_SQDIFF_NORMED;
+}
+
+}  // namespace
+
 //------------------------- Constructor -------------------------
 TemplateMatchingDetectorGpu::TemplateMatchingDetectorGpu(
     const cv::Mat &initial_frame, cv::Rect initial_state) :
@@ -42,15 +52,33 @@ std::string TemplateMatchingDetectorGpu::ToString() const {
   return "template matching detector (gpu)";
 }
 
+//--------------------------- Snapshot --------------------------
+void TemplateMatchingDetectorGpu::SaveState(SnapshotWriter *writer) const {
+  Detector::SaveState(writer);
+  writer->WriteInt(opencv_method_);
+  writer->WriteMat(template_);
+}
+
+bool TemplateMatchingDetectorGpu::LoadState(SnapshotReader *reader) {
+  int method = 0;
+  Mat saved_template;
+  if (!Detector::LoadState(reader) || !reader->ReadInt(&method) ||
+      !reader->ReadMat(&saved_template)) {
+    return false;
+  }
+  if (!IsMatchMethod(method) || saved_template.type() != template_.type() ||
+      saved_template.cols > width() || saved_template.rows > height()) {
+    return false;
+  }
+
+  opencv_method_ = method;
+  template_ = saved_template;
+  return true;
+}
+
 //------------------------ Public accessors -------------------------
 void TemplateMatchingDetectorGpu::set_opencv_method(int opencv_method) {
-  CHECK_MSG(opencv_method == CV_TM_CCOEFF ||
-            opencv_method == CV_TM_CCOEFF_NORMED ||
-            opencv_method == CV_TM_CCORR ||
-            opencv_method == CV_TM_CCORR_NORMED ||
-            opencv_method == CV_TM_SQDIFF ||
-            opencv_method == CV_TM_SQDIFF_NORMED,
-            "invalid method");
+  CHECK_MSG(IsMatchMethod(opencv_method), "invalid method");
   opencv_method_ = opencv_method;
 }
 
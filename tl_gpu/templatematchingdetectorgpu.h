@@ -29,6 +29,10 @@ public:
 
   virtual std::string ToString() const;
 
+  //------------------------- Snapshot --------------------------
+  virtual void SaveState(SnapshotWriter *writer) const;
+  virtual bool LoadState(SnapshotReader *reader);
+
   //--------------------- Public accessors ------------------------
   void set_opencv_method(int opencv_method);
 
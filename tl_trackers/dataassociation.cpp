@@ -0,0 +1,317 @@
+#include "tl_trackers/dataassociation.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "tl_util/conversions.h"
+#include "tl_util/geometry.h"
+
+using namespace cv;
+using namespace tl::internal;
+
+namespace tl {
+
+namespace {
+
+Point2d Center(Rect rect) {
+  return Point2d(rect.x + rect.width / 2., rect.y + rect.height / 2.);
+}
+
+int Root(std::vector<int> *parents, int node) {
+  std::vector<int> &parent = *parents;
+  while (parent[node] != node) {
+    parent[node] = parent[parent[node]];
+    node = parent[node];
+  }
+  return node;
+}
+
+// Minimum-cost assignment of each row of a dense rows x cols cost matrix to a
+// distinct column (rows <= cols), by shortest augmenting paths with dual
+// potentials (Jonker-Volgenant, O(rows^2 cols)).
+void SolveAssignment(const std::vector<double> &costs, int rows, int cols,
+                     std::vector<int> *row_cols) {
+  CHECK(rows <= cols);
+  // Indices are shifted by one: column 0 is the virtual start of each path.
+  std::vector<double> u(rows + 1, 0);
+  std::vector<double> v(cols + 1, 0);
+  std::vector<int> col_rows(cols + 1, 0);
+  std::vector<int> way(cols + 1, 0);
+  std::vector<double> min_v(cols + 1);
+  std::vector<char> used(cols + 1);
+
+  for (int i = 1; i <= rows; ++i) {
+    col_rows[0] = i;
+    int j0 = 0;
+    std::fill(min_v.begin(), min_v.end(), DBL_MAX);
+    std::fill(used.begin(), used.end(), false);
+    do {
+      used[j0] = true;
+      int i0 = col_rows[j0];
+      const double *row = &costs[(i0 - 1) * cols];
+      double delta = DBL_MAX;
+      int j1 = 0;
+      for (int j = 1; j <= cols; ++j) {
+        if (used[j]) continue;
+        double reduced = row[j - 1] - u[i0] - v[j];
+        if (reduced < min_v[j]) {
+          min_v[j] = reduced;
+          way[j] = j0;
+        }
+        if (min_v[j] < delta) {
+          delta = min_v[j];
+          j1 = j;
+        }
+      }
+      for (int j = 0; j <= cols; ++j) {
+        if (used[j]) {
+          u[col_rows[j]] += delta;
+          v[j] -= delta;
+        } else {
+          min_v[j] -= delta;
+        }
+      }
+      j0 = j1;
+    } while (col_rows[j0] != 0);
+
+    // Flip the augmenting path.
+    do {
+      int j1 = way[j0];
+      col_rows[j0] = col_rows[j1];
+      j0 = j1;
+    } while (j0 != 0);
+  }
+
+  row_cols->assign(rows, -1);
+  for (int j = 1; j <= cols; ++j) {
+    if (col_rows[j] != 0) (*row_cols)[col_rows[j] - 1] = j - 1;
+  }
+}
+
+}  // namespace
+
+//--------------------------- Constructors --------------------------
+Association::Association() :
+  track_detections(),
+  detection_tracks() {}
+
+DataAssociation::DataAssociation() :
+  gate_deviations_(3),
+  gate_margin_(16),
+  solver_(TL_ASSIGN_AUTO),
+  max_optimal_size_(64),
+  candidates_(),
+  cluster_labels_(),
+  gate_index_() {}
+
+//------------------------ Public accessors ------------------------
+void DataAssociation::set_gate(double deviations, double margin) {
+  CHECK(deviations >= 0 && margin >= 0);
+  gate_deviations_ = deviations;
+  gate_margin_ = margin;
+}
+
+void DataAssociation::set_solver(AssignmentSolver solver) {
+  solver_ = solver;
+}
+
+void DataAssociation::set_max_optimal_size(int max_optimal_size) {
+  CHECK(max_optimal_size >= 1);
+  max_optimal_size_ = max_optimal_size;
+}
+
+//------------------------- Main functions -------------------------
+void DataAssociation::Associate(const std::vector<cv::Rect> &predictions,
+                                const std::vector<double> &uncertainties,
+                                const std::vector<cv::Rect> &detections,
+                                Association *association) {
+  CHECK_NOTNULL(association);
+  CHECK(predictions.size() == uncertainties.size());
+  int nb_tracks = static_cast<int>(predictions.size());
+  int nb_detections = static_cast<int>(detections.size());
+  association->track_detections.assign(nb_tracks, -1);
+  association->detection_tracks.assign(nb_detections, -1);
+
+  FindCandidates(predictions, uncertainties, detections);
+  if (candidates_.empty()) return;
+  int nb_clusters = FindClusters(nb_tracks, nb_detections);
+
+  std::vector<std::vector<int> > clusters(nb_clusters);
+  for (size_t c = 0; c < candidates_.size(); ++c) {
+    clusters[cluster_labels_[candidates_[c].track]].push_back(
+        static_cast<int>(c));
+  }
+
+  std::vector<int> tracks;
+  std::vector<int> cluster_detections;
+  for (std::vector<int> &cluster : clusters) {
+    if (cluster.empty()) continue;
+    bool optimal = (solver_ == TL_ASSIGN_OPTIMAL);
+    if (solver_ == TL_ASSIGN_AUTO) {
+      tracks.clear();
+      cluster_detections.clear();
+      for (int c : cluster) {
+        tracks.push_back(candidates_[c].track);
+        cluster_detections.push_back(candidates_[c].detection);
+      }
+      std::sort(tracks.begin(), tracks.end());
+      std::sort(cluster_detections.begin(), cluster_detections.end());
+      int size = static_cast<int>(std::max(
+          std::unique(tracks.begin(), tracks.end()) - tracks.begin(),
+          std::unique(cluster_detections.begin(), cluster_detections.end()) -
+          cluster_detections.begin()));
+      optimal = (size <= max_optimal_size_);
+    }
+
+    if (optimal) {
+      SolveOptimal(cluster, association);
+    } else {
+      SolveGreedy(&cluster, association);
+    }
+  }
+}
+
+void DataAssociation::Associate(const std::vector<const Filter *> &filters,
+                                const std::vector<cv::Rect> &detections,
+                                Association *association) {
+  std::vector<Rect> predictions;
+  std::vector<double> uncertainties;
+  predictions.reserve(filters.size());
+  uncertainties.reserve(filters.size());
+  for (const Filter *filter : filters) {
+    CHECK_NOTNULL(filter);
+    predictions.push_back(StateMatToRect(filter->predicted_x()));
+    uncertainties.push_back(filter->PositionUncertainty());
+  }
+  Associate(predictions, uncertainties, detections, association);
+}
+
+//------------------------- Private methods ------------------------
+void DataAssociation::FindCandidates(const std::vector<cv::Rect> &predictions,
+                                     const std::vector<double> &uncertainties,
+                                     const std::vector<cv::Rect> &detections) {
+  candidates_.clear();
+  if (predictions.empty() || detections.empty()) return;
+
+  // Index the gate of each track by its bounding box, with cells about the
+  // size of a gate.
+  std::vector<double> gates(predictions.size());
+  double mean_gate = 0;
+  for (size_t t = 0; t < predictions.size(); ++t) {
+    gates[t] = gate_margin_ +
+               gate_deviations_ * std::max(uncertainties[t], 0.0);
+    mean_gate += gates[t] / predictions.size();
+  }
+  gate_index_.Reset(std::max(1, cvRound(2 * mean_gate)));
+  for (size_t t = 0; t < predictions.size(); ++t) {
+    Point2d center = Center(predictions[t]);
+    int left = cvFloor(center.x - gates[t]);
+    int top = cvFloor(center.y - gates[t]);
+    gate_index_.Insert(Rect(left, top, cvCeil(center.x + gates[t]) - left + 1,
+                            cvCeil(center.y + gates[t]) - top + 1));
+  }
+
+  // Compare each detection to the tracks whose gate box holds its center.
+  std::vector<int> tracks;
+  for (size_t d = 0; d < detections.size(); ++d) {
+    Point2d center = Center(detections[d]);
+    gate_index_.Intersecting(Rect(cvFloor(center.x), cvFloor(center.y), 1, 1),
+                             &tracks);
+    for (int t : tracks) {
+      double distance = CenterDistance(predictions[t], detections[d]);
+      if (distance <= gates[t]) {
+        Candidate candidate = {t, static_cast<int>(d), distance};
+        candidates_.push_back(candidate);
+      }
+    }
+  }
+}
+
+int DataAssociation::FindClusters(int nb_tracks, int nb_detections) {
+  // Union-find over tracks (first) and detections (then). The root of a
+  // cluster is its node of smallest index, hence a track.
+  std::vector<int> parents(nb_tracks + nb_detections);
+  for (int i = 0; i < nb_tracks + nb_detections; ++i) {
+    parents[i] = i;
+  }
+  for (const Candidate &candidate : candidates_) {
+    int a = Root(&parents, candidate.track);
+    int b = Root(&parents, nb_tracks + candidate.detection);
+    if (a != b) parents[std::max(a, b)] = std::min(a, b);
+  }
+
+  int nb_clusters = 0;
+  cluster_labels_.resize(nb_tracks);
+  for (int i = 0; i < nb_tracks; ++i) {
+    int root = Root(&parents, i);
+    cluster_labels_[i] = (root == i) ? nb_clusters++ : cluster_labels_[root];
+  }
+  return nb_clusters;
+}
+
+void DataAssociation::SolveOptimal(const std::vector<int> &candidates,
+                                   Association *association) {
+  std::vector<int> tracks;
+  std::vector<int> detections;
+  double infeasible = 1;
+  for (int c : candidates) {
+    tracks.push_back(candidates_[c].track);
+    detections.push_back(candidates_[c].detection);
+    infeasible += candidates_[c].cost;
+  }
+  std::sort(tracks.begin(), tracks.end());
+  tracks.erase(std::unique(tracks.begin(), tracks.end()), tracks.end());
+  std::sort(detections.begin(), detections.end());
+  detections.erase(std::unique(detections.begin(), detections.end()),
+                   detections.end());
+
+  // Rows are the smaller side. Pairs out of the gates cost more than all the
+  // gated ones together, so that as many gated pairs as possible are made.
+  bool transposed = (tracks.size() > detections.size());
+  int rows = static_cast<int>(std::min(tracks.size(), detections.size()));
+  int cols = static_cast<int>(std::max(tracks.size(), detections.size()));
+  std::vector<double> costs(rows * cols, infeasible);
+  for (int c : candidates) {
+    int t = static_cast<int>(std::lower_bound(tracks.begin(), tracks.end(),
+        candidates_[c].track) - tracks.begin());
+    int d = static_cast<int>(std::lower_bound(detections.begin(),
+        detections.end(), candidates_[c].detection) - detections.begin());
+    if (transposed) {
+      costs[d * cols + t] = candidates_[c].cost;
+    } else {
+      costs[t * cols + d] = candidates_[c].cost;
+    }
+  }
+
+  std::vector<int> row_cols;
+  SolveAssignment(costs, rows, cols, &row_cols);
+  for (int row = 0; row < rows; ++row) {
+    int col = row_cols[row];
+    if (col < 0 || costs[row * cols + col] >= infeasible) continue;
+    int track = transposed ? tracks[col] : tracks[row];
+    int detection = transposed ? detections[row] : detections[col];
+    association->track_detections[track] = detection;
+    association->detection_tracks[detection] = track;
+  }
+}
+
+void DataAssociation::SolveGreedy(std::vector<int> *candidates,
+                                  Association *association) const {
+  std::sort(candidates->begin(), candidates->end(),
+            [this](int a, int b) {
+    return candidates_[a].cost < candidates_[b].cost ||
+           (candidates_[a].cost == candidates_[b].cost && a < b);
+  });
+  for (int c : *candidates) {
+    const Candidate &candidate = candidates_[c];
+    if (association->track_detections[candidate.track] >= 0 ||
+        association->detection_tracks[candidate.detection] >= 0) {
+      continue;
+    }
+    association->track_detections[candidate.track] = candidate.detection;
+    association->detection_tracks[candidate.detection] = candidate.track;
+  }
+}
+
+}  // namespace tl
@@ -0,0 +1,155 @@
+/*!
+ * \file dataassociation.h
+ * \brief Assignment of detections to tracks.
+ * \author Joachim Valente <joachim.valente@gmail.com>
+ */
+
+#ifndef TL_DATAASSOCIATION_H
+#define TL_DATAASSOCIATION_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "common.h"
+#include "tl_core/filter.h"
+#include "tl_util/spatialindex.h"
+
+namespace tl {
+
+enum AssignmentSolver {
+  TL_ASSIGN_AUTO,      //!< Optimal on small clusters, greedy on large ones.
+  TL_ASSIGN_OPTIMAL,   //!< Minimum total cost (shortest augmenting paths).
+  TL_ASSIGN_GREEDY     //!< Closest pairs first.
+};
+
+/*!
+ * \brief Pairs of an association, by index of track and of detection.
+ */
+struct Association {
+  //--------------------------- Constructor --------------------------
+  Association();
+
+  //----------------------------- Members ----------------------------
+  std::vector<int> track_detections;  //!< Detection of each track, -1 if none.
+  std::vector<int> detection_tracks;  //!< Track of each detection, -1 if none.
+};
+
+/*!
+ * \brief Match detections (e.g. foreground blobs) to the predicted states of
+ * tracks, one detection at most per track and conversely.
+ *
+ * The cost of a pair is the distance between the centers of the predicted
+ * state and of the detection. Pairs farther than the gate of the track (a
+ * number of deviations of its predicted position, plus a margin) are never
+ * made.
+ *
+ * Candidate pairs are found with a spatial index over the gates of the
+ * tracks, so that a detection is only compared to the tracks around it. Gated
+ * pairs split tracks and detections into independent clusters, each solved on
+ * its own: optimally with shortest augmenting paths (Jonker-Volgenant) when
+ * it is small, which is nearly always the case since clusters are groups of
+ * objects close to each other, and greedily otherwise.
+ */
+class DataAssociation {
+public:
+  //--------------------------- Constructor --------------------------
+  DataAssociation();
+
+  //------------------------ Public accessors ------------------------
+  /*!
+   * \brief Set the gate of the tracks.
+   * \param deviations Number of deviations of the predicted position
+   * [def. 3].
+   * \param margin Distance added to the gate, in pixels, also the gate of
+   * tracks whose uncertainty is unknown [def. 16].
+   */
+  void set_gate(double deviations, double margin);
+
+  void set_solver(AssignmentSolver solver);
+
+  /*!
+   * \brief Set the largest number of tracks or detections of a cluster solved
+   * optimally in TL_ASSIGN_AUTO mode [def. 64].
+   */
+  void set_max_optimal_size(int max_optimal_size);
+
+  //------------------------- Main functions -------------------------
+  /*!
+   * \brief Associate detections to tracks.
+   * \param predictions Predicted state of each track.
+   * \param uncertainties Deviation of the predicted position of each track in
+   * pixels (see Filter::PositionUncertainty()), negative if unknown.
+   * \param detections Detections of the frame.
+   * \param association Pairs made.
+   */
+  void Associate(const std::vector<cv::Rect> &predictions,
+                 const std::vector<double> &uncertainties,
+                 const std::vector<cv::Rect> &detections,
+                 Association *association);
+
+  /*!
+   * \brief Associate detections to tracks followed by filters.
+   * \param filters Filter of each track, after `Predict()`, with the state
+   * layout of the standard tracking model (see KalmanFilter).
+   * \param detections Detections of the frame.
+   * \param association Pairs made.
+   */
+  void Associate(const std::vector<const Filter *> &filters,
+                 const std::vector<cv::Rect> &detections,
+                 Association *association);
+
+private:
+  //---------------------- Internal structures -----------------------
+  /*!
+   * \brief Gated pair of a track and a detection.
+   */
+  struct Candidate {
+    int track;        //!< Index of the track.
+    int detection;    //!< Index of the detection.
+    double cost;      //!< Distance between centers.
+  };
+
+  //------------------------- Private methods ------------------------
+  /*!
+   * \brief Find the gated pairs.
+   */
+  void FindCandidates(const std::vector<cv::Rect> &predictions,
+                      const std::vector<double> &uncertainties,
+                      const std::vector<cv::Rect> &detections);
+
+  /*!
+   * \brief Label the tracks by connected cluster of gated pairs.
+   * \return Number of clusters.
+   */
+  int FindClusters(int nb_tracks, int nb_detections);
+
+  /*!
+   * \brief Pair the candidates of a cluster with minimum total cost.
+   */
+  void SolveOptimal(const std::vector<int> &candidates,
+                    Association *association);
+
+  /*!
+   * \brief Pair the candidates of a cluster closest first.
+   */
+  void SolveGreedy(std::vector<int> *candidates,
+                   Association *association) const;
+
+  //------------------------- Private members ------------------------
+  double gate_deviations_;              //!< Deviations of the gate.
+  double gate_margin_;                  //!< Margin of the gate, in pixels.
+  AssignmentSolver solver_;             //!< Solver [def. TL_ASSIGN_AUTO].
+  int max_optimal_size_;                //!< Largest cluster solved optimally.
+
+  std::vector<Candidate> candidates_;   //!< Gated pairs of the frame.
+  std::vector<int> cluster_labels_;     //!< Cluster of each track.
+  SpatialIndex gate_index_;             //!< Bounding box of the gate of
+                                        //!< each track (ids are indices).
+
+  DISALLOW_COPY_AND_ASSIGN(DataAssociation);
+};
+
+}  // namespace tl
+
+#endif  // TL_DATAASSOCIATION_H
@@ -0,0 +1,242 @@
+#include "tl_util/bitmask.h"
+
+#include <algorithm>
+#include <bitset>
+
+using namespace cv;
+
+namespace tl {
+
+namespace {
+
+const int kWordBits = 64;
+
+// Word k of a row shifted right by s pixels (pixel x taking the value of
+// pixel x - s), pixels out of the row being 0.
+std::uint64_t ShiftedRight(const std::uint64_t *row, int k, int s) {
+  int q = s / kWordBits;
+  int b = s % kWordBits;
+  std::uint64_t word = 0;
+  if (k - q >= 0) word = row[k - q] << b;
+  if (b != 0 && k - q - 1 >= 0) word |= row[k - q - 1] >> (kWordBits - b);
+  return word;
+}
+
+// Word k of a row shifted left by s pixels (pixel x taking the value of pixel
+// x + s), pixels out of the row being 0.
+std::uint64_t ShiftedLeft(const std::uint64_t *row, int nb_words, int k,
+                          int s) {
+  int q = s / kWordBits;
+  int b = s % kWordBits;
+  std::uint64_t word = 0;
+  if (k + q < nb_words) word = row[k + q] >> b;
+  if (b != 0 && k + q + 1 < nb_words)
+    word |= row[k + q + 1] << (kWordBits - b);
+  return word;
+}
+
+int PopCount(std::uint64_t word) {
+  return static_cast<int>(std::bitset<kWordBits>(word).count());
+}
+
+// Bits from bit first to bit last (inclusive) of a word.
+std::uint64_t BitRange(int first, int last) {
+  std::uint64_t high = (last == kWordBits - 1) ? ~std::uint64_t(0)
+      : (std::uint64_t(1) << (last + 1)) - 1;
+  return high & ~((std::uint64_t(1) << first) - 1);
+}
+
+}  // namespace
+
+//-------------------------- Constructors --------------------------
+BitMask::BitMask() :
+  rows_(0),
+  cols_(0),
+  words_per_row_(0),
+  words_(),
+  buffer_() {}
+
+BitMask::BitMask(cv::Size size) :
+  BitMask() {
+  Reset(size);
+}
+
+BitMask::BitMask(const cv::Mat &mask, int threshold) :
+  BitMask() {
+  Pack(mask, threshold);
+}
+
+void BitMask::Pack(const cv::Mat &mask, int threshold) {
+  CHECK(mask.type() == CV_8UC1);
+  Reset(mask.size());
+  for (int y = 0; y < rows_; ++y) {
+    const uchar *pixels = mask.ptr<uchar>(y);
+    std::uint64_t *row = &words_[y * words_per_row_];
+    for (int x = 0; x < cols_; ++x) {
+      row[x / kWordBits] |=
+          std::uint64_t(pixels[x] > threshold) << (x % kWordBits);
+    }
+  }
+}
+
+//------------------------ Public accessors ------------------------
+cv::Size BitMask::size() const {
+  return Size(cols_, rows_);
+}
+
+bool BitMask::empty() const {
+  return rows_ == 0 || cols_ == 0;
+}
+
+bool BitMask::at(int x, int y) const {
+  CHECK(0 <= x && x < cols_ && 0 <= y && y < rows_);
+  return (words_[y * words_per_row_ + x / kWordBits] >> (x % kWordBits)) & 1;
+}
+
+void BitMask::set(int x, int y, bool value) {
+  CHECK(0 <= x && x < cols_ && 0 <= y && y < rows_);
+  std::uint64_t &word = words_[y * words_per_row_ + x / kWordBits];
+  std::uint64_t bit = std::uint64_t(1) << (x % kWordBits);
+  word = value ? (word | bit) : (word & ~bit);
+}
+
+void BitMask::ToMat(cv::Mat *mask, uchar value) const {
+  CHECK_NOTNULL(mask);
+  mask->create(rows_, cols_, CV_8UC1);
+  for (int y = 0; y < rows_; ++y) {
+    uchar *pixels = mask->ptr<uchar>(y);
+    const std::uint64_t *row = &words_[y * words_per_row_];
+    for (int x = 0; x < cols_; ++x) {
+      pixels[x] = ((row[x / kWordBits] >> (x % kWordBits)) & 1) ? value : 0;
+    }
+  }
+}
+
+//---------------------------- Queries -----------------------------
+int BitMask::Area() const {
+  int area = 0;
+  for (std::uint64_t word : words_) {
+    area += PopCount(word);
+  }
+  return area;
+}
+
+int BitMask::Area(cv::Rect rect) const {
+  rect &= Rect(0, 0, cols_, rows_);
+  if (rect.area() == 0) return 0;
+
+  int first_word = rect.x / kWordBits;
+  int last_word = (rect.x + rect.width - 1) / kWordBits;
+  std::uint64_t first_bits = BitRange(rect.x % kWordBits, kWordBits - 1);
+  std::uint64_t last_bits = BitRange(0, (rect.x + rect.width - 1) %
+                                        kWordBits);
+  int area = 0;
+  for (int y = rect.y; y < rect.y + rect.height; ++y) {
+    const std::uint64_t *row = &words_[y * words_per_row_];
+    if (first_word == last_word) {
+      area += PopCount(row[first_word] & first_bits & last_bits);
+      continue;
+    }
+    area += PopCount(row[first_word] & first_bits);
+    for (int k = first_word + 1; k < last_word; ++k) {
+      area += PopCount(row[k]);
+    }
+    area += PopCount(row[last_word] & last_bits);
+  }
+  return area;
+}
+
+//--------------------------- Morphology ---------------------------
+void BitMask::Dilate(int radius, BitMask *result) const {
+  CHECK_NOTNULL(result);
+  CopyTo(result);
+  result->DilateInPlace(radius);
+}
+
+// Erosion is the complement of the dilation of the complement: pixels out of
+// the mask, 0 for the dilation, act as set for the erosion.
+void BitMask::Erode(int radius, BitMask *result) const {
+  CHECK_NOTNULL(result);
+  CopyTo(result);
+  result->Invert();
+  result->DilateInPlace(radius);
+  result->Invert();
+}
+
+void BitMask::Open(int radius, BitMask *result) const {
+  Erode(radius, result);
+  result->Dilate(radius, result);
+}
+
+void BitMask::Close(int radius, BitMask *result) const {
+  Dilate(radius, result);
+  result->Erode(radius, result);
+}
+
+void BitMask::Invert() {
+  for (std::uint64_t &word : words_) {
+    word = ~word;
+  }
+  ClearPadding();
+}
+
+//------------------------- Private methods ------------------------
+void BitMask::Reset(cv::Size size) {
+  CHECK(size.width >= 0 && size.height >= 0);
+  rows_ = size.height;
+  cols_ = size.width;
+  words_per_row_ = (size.width + kWordBits - 1) / kWordBits;
+  words_.assign(static_cast<size_t>(words_per_row_) * size.height, 0);
+}
+
+void BitMask::CopyTo(BitMask *result) const {
+  if (result == this) return;
+  result->rows_ = rows_;
+  result->cols_ = cols_;
+  result->words_per_row_ = words_per_row_;
+  result->words_.assign(words_.begin(), words_.end());
+}
+
+// Dilation by a square is separable: each row is dilated by whole words into
+// buffer_, then each row is the union of the 2 * radius + 1 rows of buffer_
+// around it.
+void BitMask::DilateInPlace(int radius) {
+  CHECK(radius >= 0);
+  buffer_.resize(words_.size());
+  for (int y = 0; y < rows_; ++y) {
+    const std::uint64_t *row = &words_[y * words_per_row_];
+    std::uint64_t *dilated = &buffer_[y * words_per_row_];
+    for (int k = 0; k < words_per_row_; ++k) {
+      std::uint64_t word = row[k];
+      for (int s = 1; s <= radius; ++s) {
+        word |= ShiftedRight(row, k, s) |
+                ShiftedLeft(row, words_per_row_, k, s);
+      }
+      dilated[k] = word;
+    }
+  }
+
+  std::fill(words_.begin(), words_.end(), 0);
+  for (int y = 0; y < rows_; ++y) {
+    std::uint64_t *row = &words_[y * words_per_row_];
+    int last = std::min(rows_ - 1, y + radius);
+    for (int i = std::max(0, y - radius); i <= last; ++i) {
+      const std::uint64_t *source = &buffer_[i * words_per_row_];
+      for (int k = 0; k < words_per_row_; ++k) {
+        row[k] |= source[k];
+      }
+    }
+  }
+  ClearPadding();
+}
+
+void BitMask::ClearPadding() {
+  int used = cols_ % kWordBits;
+  if (used == 0) return;
+  std::uint64_t bits = BitRange(0, used - 1);
+  for (int y = 0; y < rows_; ++y) {
+    words_[(y + 1) * words_per_row_ - 1] &= bits;
+  }
+}
+
+}  // namespace tl
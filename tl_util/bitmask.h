@@ -0,0 +1,132 @@
+/*!
+ * \file bitmask.h
+ * \brief Binary mask packed with one bit per pixel.
+ * \author Joachim Valente <joachim.valente@gmail.com>
+ */
+
+#ifndef TL_BITMASK_H
+#define TL_BITMASK_H
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "common.h"
+
+namespace tl {
+
+/*!
+ * \brief Binary mask with one bit per pixel, e.g. a foreground mask.
+ *
+ * Each row is stored in 64-bit words, pixel x of a row being bit x % 64 of
+ * word x / 64. Morphology works on whole words, i.e. on 64 pixels per
+ * operation, and reads and writes 8 times less memory than on an 8-bit
+ * `cv::Mat`. Bits past the last column of a row are always 0.
+ *
+ * Structuring elements are squares of side 2 * radius + 1, centered, and
+ * pixels out of the mask never change the result (as with the default border
+ * of `cv::erode()` and `cv::dilate()`), so that results are those of OpenCV
+ * with `getStructuringElement(MORPH_RECT, ...)`. The result of an operation
+ * may be the mask itself and keeps its storage, so that cleaning a mask at
+ * every frame allocates nothing once the first frame is done.
+ */
+class BitMask {
+public:
+  //-------------------------- Constructors --------------------------
+  BitMask();
+
+  /*!
+   * \brief Mask of a given size, all pixels cleared.
+   */
+  explicit BitMask(cv::Size size);
+
+  /*!
+   * \brief Pack an 8-bit single-channel mask.
+   * \param threshold Value above which a pixel is set.
+   */
+  explicit BitMask(const cv::Mat &mask, int threshold = 0);
+
+  /*!
+   * \brief Pack an 8-bit single-channel mask into this one, reusing its
+   * storage.
+   * \param threshold Value above which a pixel is set.
+   */
+  void Pack(const cv::Mat &mask, int threshold = 0);
+
+  //------------------------ Public accessors ------------------------
+  cv::Size size() const;
+  bool empty() const;
+  bool at(int x, int y) const;
+  void set(int x, int y, bool value);
+
+  /*!
+   * \brief Unpack into an 8-bit single-channel mask.
+   * \param mask Mask, reallocated only if its size or type differ.
+   * \param value Value of the pixels set (others are 0).
+   */
+  void ToMat(cv::Mat *mask, uchar value = 255) const;
+
+  //---------------------------- Queries -----------------------------
+  /*!
+   * \brief Number of pixels set.
+   */
+  int Area() const;
+
+  /*!
+   * \brief Number of pixels set in a rect (clipped to the mask).
+   */
+  int Area(cv::Rect rect) const;
+
+  //--------------------------- Morphology ---------------------------
+  void Erode(int radius, BitMask *result) const;
+  void Dilate(int radius, BitMask *result) const;
+
+  /*!
+   * \brief Erosion then dilation, removing small foreground specks.
+   */
+  void Open(int radius, BitMask *result) const;
+
+  /*!
+   * \brief Dilation then erosion, filling small holes.
+   */
+  void Close(int radius, BitMask *result) const;
+
+  /*!
+   * \brief Flip all pixels.
+   */
+  void Invert();
+
+private:
+  //------------------------- Private methods ------------------------
+  /*!
+   * \brief Resize to a number of pixels, all cleared, keeping the storage.
+   */
+  void Reset(cv::Size size);
+
+  /*!
+   * \brief Copy into another mask, keeping its storage.
+   */
+  void CopyTo(BitMask *result) const;
+
+  /*!
+   * \brief Dilate in place, through buffer_.
+   */
+  void DilateInPlace(int radius);
+
+  /*!
+   * \brief Clear the bits past the last column of each row.
+   */
+  void ClearPadding();
+
+  //------------------------- Private members ------------------------
+  int rows_;                          //!< Height.
+  int cols_;                          //!< Width.
+  int words_per_row_;                 //!< 64-bit words of a row.
+  std::vector<std::uint64_t> words_;  //!< Rows of words, top to bottom.
+  std::vector<std::uint64_t> buffer_; //!< Rows dilated horizontally.
+};
+
+}  // namespace tl
+
+#endif  // TL_BITMASK_H
@@ -0,0 +1,260 @@
+#include "tl_util/blobextractor.h"
+
+#include <algorithm>
+#include <climits>
+
+using namespace cv;
+
+namespace tl {
+
+namespace {
+
+// Fewest rows of a band. Bands are not worth a thread below.
+const int kMinBandHeight = 32;
+
+// Foreground pixels of a row, from column start to column end (inclusive).
+struct Run {
+  int start;
+  int end;
+  int label;    // Component of the run (not always the root).
+};
+
+// Union-find node and statistics of a component (valid at roots only).
+struct Component {
+  int parent;
+  int area;
+  double sum_x;
+  double sum_y;
+  int left;
+  int top;
+  int right;
+  int bottom;
+  int first;    // Raster index of the first pixel.
+};
+
+// Components of a band, and the runs of its first and last rows to merge it
+// with its neighbors.
+struct Band {
+  Band() : components(), first_runs(), last_runs() {}
+
+  std::vector<Component> components;
+  std::vector<Run> first_runs;
+  std::vector<Run> last_runs;
+};
+
+int Find(std::vector<Component> *components, int label) {
+  std::vector<Component> &c = *components;
+  while (c[label].parent != label) {
+    c[label].parent = c[c[label].parent].parent;
+    label = c[label].parent;
+  }
+  return label;
+}
+
+void Union(std::vector<Component> *components, int a, int b) {
+  a = Find(components, a);
+  b = Find(components, b);
+  if (a == b) return;
+  if (b < a) std::swap(a, b);
+
+  Component &root = (*components)[a];
+  const Component &other = (*components)[b];
+  root.area += other.area;
+  root.sum_x += other.sum_x;
+  root.sum_y += other.sum_y;
+  root.left = std::min(root.left, other.left);
+  root.top = std::min(root.top, other.top);
+  root.right = std::max(root.right, other.right);
+  root.bottom = std::max(root.bottom, other.bottom);
+  root.first = std::min(root.first, other.first);
+  (*components)[b].parent = a;
+}
+
+// Join each run of a row to the runs it touches on the previous row, creating
+// a component for runs touching none.
+void ConnectRuns(const std::vector<Run> &previous, int gap, int y, int cols,
+                 std::vector<Run> *runs, std::vector<Component> *components) {
+  size_t j = 0;
+  for (Run &run : *runs) {
+    while (j < previous.size() && previous[j].end + gap < run.start) ++j;
+    for (size_t k = j;
+         k < previous.size() && previous[k].start <= run.end + gap; ++k) {
+      if (run.label < 0) {
+        run.label = Find(components, previous[k].label);
+      } else {
+        Union(components, run.label, previous[k].label);
+      }
+    }
+
+    int length = run.end - run.start + 1;
+    if (run.label < 0) {
+      Component component = {static_cast<int>(components->size()), 0, 0, 0,
+                             run.start, y, run.end, y, y * cols + run.start};
+      run.label = component.parent;
+      components->push_back(component);
+    }
+    Component &root = (*components)[Find(components, run.label)];
+    root.area += length;
+    root.sum_x += 0.5 * length * (run.start + run.end);
+    root.sum_y += static_cast<double>(length) * y;
+    root.left = std::min(root.left, run.start);
+    root.right = std::max(root.right, run.end);
+    root.bottom = std::max(root.bottom, y);
+  }
+}
+
+// Join the components of the runs of two consecutive rows that touch.
+void JoinRows(const std::vector<Run> &above, const std::vector<Run> &below,
+              int gap, std::vector<Component> *components) {
+  size_t j = 0;
+  for (const Run &run : below) {
+    while (j < above.size() && above[j].end + gap < run.start) ++j;
+    for (size_t k = j;
+         k < above.size() && above[k].start <= run.end + gap; ++k) {
+      Union(components, run.label, above[k].label);
+    }
+  }
+}
+
+// Scan the rows of bands of a mask, for `cv::parallel_for_()`.
+class BandScanner : public ParallelLoopBody {
+public:
+  BandScanner(const Mat &mask, int threshold, int gap,
+              const std::vector<int> &band_rows, std::vector<Band> &bands) :
+    mask_(mask),
+    threshold_(threshold),
+    gap_(gap),
+    band_rows_(band_rows),
+    bands_(bands) {}
+
+  virtual void operator()(const Range &range) const {
+    std::vector<Run> previous;
+    std::vector<Run> runs;
+    for (int b = range.start; b < range.end; ++b) {
+      Band &band = bands_[b];
+      previous.clear();
+      for (int y = band_rows_[b]; y < band_rows_[b + 1]; ++y) {
+        const uchar *row = mask_.ptr<uchar>(y);
+        runs.clear();
+        for (int x = 0; x < mask_.cols; ++x) {
+          if (row[x] <= threshold_) continue;
+          Run run = {x, x, -1};
+          while (x + 1 < mask_.cols && row[x + 1] > threshold_) ++x;
+          run.end = x;
+          runs.push_back(run);
+        }
+        ConnectRuns(previous, gap_, y, mask_.cols, &runs, &band.components);
+        if (y == band_rows_[b]) band.first_runs = runs;
+        previous.swap(runs);
+      }
+      band.last_runs = previous;
+    }
+  }
+
+private:
+  const Mat &mask_;
+  int threshold_;
+  int gap_;
+  const std::vector<int> &band_rows_;
+  std::vector<Band> &bands_;
+};
+
+}  // namespace
+
+//--------------------------- Constructors --------------------------
+Blob::Blob() :
+  bounding_box(),
+  area(0),
+  centroid() {}
+
+BlobExtractor::BlobExtractor() :
+  min_area_(1),
+  max_area_(INT_MAX),
+  threshold_(0),
+  connectivity_(8) {}
+
+//------------------------ Public accessors ------------------------
+void BlobExtractor::set_area_range(int min_area, int max_area) {
+  CHECK(0 <= min_area && min_area <= max_area);
+  min_area_ = min_area;
+  max_area_ = max_area;
+}
+
+void BlobExtractor::set_threshold(int threshold) {
+  CHECK(0 <= threshold && threshold < 255);
+  threshold_ = threshold;
+}
+
+void BlobExtractor::set_connectivity(int connectivity) {
+  CHECK_MSG(connectivity == 4 || connectivity == 8,
+            "connectivity must be 4 or 8");
+  connectivity_ = connectivity;
+}
+
+//------------------------- Main functions -------------------------
+void BlobExtractor::Extract(const cv::Mat &mask,
+                            std::vector<Blob> *blobs) const {
+  CHECK_NOTNULL(blobs);
+  CHECK(mask.type() == CV_8UC1);
+  blobs->clear();
+  if (mask.empty()) return;
+
+  // Scan bands in parallel.
+  int nb_bands = std::max(1, std::min(getNumThreads(),
+                                      mask.rows / kMinBandHeight));
+  std::vector<int> band_rows(nb_bands + 1);
+  for (int b = 0; b <= nb_bands; ++b) {
+    band_rows[b] = b * mask.rows / nb_bands;
+  }
+  std::vector<Band> bands(nb_bands);
+  int gap = (connectivity_ == 8) ? 1 : 0;
+  parallel_for_(Range(0, nb_bands),
+                BandScanner(mask, threshold_, gap, band_rows, bands));
+
+  // Gather the components of all bands, and merge those touching across the
+  // border of two bands.
+  std::vector<Component> components;
+  for (size_t b = 0; b < bands.size(); ++b) {
+    Band &band = bands[b];
+    int offset = static_cast<int>(components.size());
+    for (Component &component : band.components) {
+      component.parent += offset;
+      components.push_back(component);
+    }
+    for (Run &run : band.first_runs) {
+      run.label += offset;
+    }
+    for (Run &run : band.last_runs) {
+      run.label += offset;
+    }
+    if (b > 0) {
+      JoinRows(bands[b - 1].last_runs, band.first_runs, gap, &components);
+    }
+  }
+
+  std::vector<int> roots;
+  for (int i = 0; i < static_cast<int>(components.size()); ++i) {
+    const Component &component = components[i];
+    if (component.parent == i && min_area_ <= component.area &&
+        component.area <= max_area_) {
+      roots.push_back(i);
+    }
+  }
+  std::sort(roots.begin(), roots.end(), [&components](int a, int b) {
+    return components[a].first < components[b].first;
+  });
+
+  for (int root : roots) {
+    const Component &component = components[root];
+    Blob blob;
+    blob.bounding_box = Rect(component.left, component.top,
+                             component.right - component.left + 1,
+                             component.bottom - component.top + 1);
+    blob.area = component.area;
+    blob.centroid = Point2d(component.sum_x / component.area,
+                            component.sum_y / component.area);
+    blobs->push_back(blob);
+  }
+}
+
+}  // namespace tl
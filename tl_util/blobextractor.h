@@ -0,0 +1,86 @@
+/*!
+ * \file blobextractor.h
+ * \brief Connected components of a foreground mask.
+ * \author Joachim Valente <joachim.valente@gmail.com>
+ */
+
+#ifndef TL_BLOBEXTRACTOR_H
+#define TL_BLOBEXTRACTOR_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "common.h"
+
+namespace tl {
+
+/*!
+ * \brief Connected component of a mask.
+ */
+struct Blob {
+  //--------------------------- Constructor --------------------------
+  Blob();
+
+  //----------------------------- Members ----------------------------
+  cv::Rect bounding_box;    //!< Smallest rect holding the component.
+  int area;                 //!< Number of pixels.
+  cv::Point2d centroid;     //!< Mean of the coordinates of the pixels.
+};
+
+/*!
+ * \brief Extract the blobs of a foreground mask, e.g. the mask of moving
+ * pixels computed by a BackgroundSubtractor (`background()`), as object
+ * proposals.
+ *
+ * The mask is read once, row by row, as runs of foreground pixels. Each run
+ * is joined to the runs it touches on the previous row, and the statistics of
+ * the components are accumulated as runs are found, so that neither labels
+ * nor contours are ever written per pixel. Horizontal bands of the mask are
+ * scanned in parallel, and components cut by the border of two bands are
+ * merged from the runs of the rows on each side of it.
+ */
+class BlobExtractor {
+public:
+  //--------------------------- Constructor --------------------------
+  BlobExtractor();
+
+  //------------------------ Public accessors ------------------------
+  /*!
+   * \brief Keep only the blobs of an area in a range, in pixels
+   * [def. 1 and no maximum].
+   */
+  void set_area_range(int min_area, int max_area);
+
+  /*!
+   * \brief Set the value above which a pixel is foreground [def. 0], e.g. 127
+   * to leave out the shadows marked by some OpenCV background subtractors.
+   */
+  void set_threshold(int threshold);
+
+  /*!
+   * \brief Set the connectivity of the pixels of a blob, 4 or 8 [def. 8].
+   */
+  void set_connectivity(int connectivity);
+
+  //------------------------- Main functions -------------------------
+  /*!
+   * \brief Extract the blobs of a mask.
+   * \param mask 8-bit single-channel mask.
+   * \param blobs Blobs kept, in the order of their first pixel.
+   */
+  void Extract(const cv::Mat &mask, std::vector<Blob> *blobs) const;
+
+private:
+  //------------------------- Private members ------------------------
+  int min_area_;          //!< Smallest area kept.
+  int max_area_;          //!< Largest area kept.
+  int threshold_;         //!< Value above which a pixel is foreground.
+  int connectivity_;      //!< 4 or 8.
+
+  DISALLOW_COPY_AND_ASSIGN(BlobExtractor);
+};
+
+}  // namespace tl
+
+#endif  // TL_BLOBEXTRACTOR_H
@@ -23,13 +23,19 @@ cv::Rect StateMatToRect(const cv::Mat &mat) {
 }
 
 cv::Mat StateRectToMat(cv::Rect rect) {
-  Mat mat = Mat::zeros(4, 1, CV_32F);
-  Mat_<float> mat_d(mat);
+  Mat mat;
+  StateRectToMat(rect, &mat);
+  return mat;
+}
+
+void StateRectToMat(cv::Rect rect, cv::Mat *mat) {
+  CHECK_NOTNULL(mat);
+  mat->create(4, 1, CV_32F);
+  Mat_<float> mat_d(*mat);
   mat_d.at<float>(0, 0) = rect.x;
   mat_d.at<float>(0, 1) = rect.y;
   mat_d.at<float>(0, 2) = rect.width;
   mat_d.at<float>(0, 3) = rect.height;
-  return mat;
 }
 
 cv::Mat StateRectToStandardMat(cv::Rect rect) {
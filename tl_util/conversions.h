@@ -15,6 +15,13 @@ namespace internal {
 //------------ Conversions between state-rect and state-matrix ---------------
 cv::Rect StateMatToRect(const cv::Mat &mat);
 cv::Mat StateRectToMat(cv::Rect rect);
+
+/*!
+ * \brief Same as StateRectToMat(cv::Rect), into a matrix reallocated only if
+ * it is not 4x1 CV_32F.
+ */
+void StateRectToMat(cv::Rect rect, cv::Mat *mat);
+
 cv::Mat StateRectToStandardMat(cv::Rect rect);
 
 }  // namespace internal
@@ -0,0 +1,427 @@
+#include "tl_util/framecache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+// Mapping files and listing the cache directory rely on POSIX. Elsewhere no
+// video can be opened, so callers decode them as usual.
+#if defined(__unix__) || defined(__APPLE__)
+# define TL_POSIX_FRAME_CACHE
+# include <dirent.h>
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+# include <utime.h>
+#endif
+
+#include <opencv2/highgui/highgui.hpp>
+
+using namespace cv;
+
+namespace tl {
+
+namespace {
+
+const int kCacheMagic = 0x43464C54;  // "TLFC".
+const int kCacheVersion = 1;
+const char kCacheExtension[] = ".tlfc";
+
+const int64 kDefaultMaxBytes = static_cast<int64>(4) << 30;
+
+// Frames start on a page, and each frame on a cache line.
+const size_t kPageSize = 4096;
+const size_t kFrameAlignment = 64;
+
+// Start of a cache file, followed by the path of the source and, from
+// data_offset on, by the frames.
+struct CacheHeader {
+  int magic;
+  int version;
+  int nb_frames;
+  int rows;
+  int cols;
+  int type;
+  int source_length;    // Bytes of the path of the source.
+  int reserved;         // Padding, 0.
+  int64 source_size;    // Size of the source when it was decoded.
+  int64 source_time;    // Modification time of the source then.
+  int64 frame_stride;
+  int64 data_offset;
+};
+
+#ifdef TL_POSIX_FRAME_CACHE
+// File of the cache directory.
+struct CacheFile {
+  time_t time;          // Last opened.
+  int64 size;
+  std::string path;
+};
+
+size_t Align(size_t size, size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+// Serializes the decoding of a video by the threads of this process.
+std::mutex &BuildMutex(const std::string &cache_path) {
+  static std::mutex mutexes_mutex;
+  static std::map<std::string, std::unique_ptr<std::mutex> > mutexes;
+  std::lock_guard<std::mutex> lock(mutexes_mutex);
+  std::unique_ptr<std::mutex> &mutex = mutexes[cache_path];
+  if (!mutex) mutex.reset(new std::mutex);
+  return *mutex;
+}
+
+// Video found too large for the cache by this process, so that it is not
+// decoded again at every run.
+struct Rejection {
+  int64 source_size;    // Size of the source then.
+  int64 source_time;    // Modification time of the source then.
+  int64 max_bytes;      // Size of the cache it did not fit in.
+};
+
+std::mutex rejections_mutex;
+std::map<std::string, Rejection> rejections;  // By cache file.
+
+bool IsRejected(const std::string &cache_path, int64 source_size,
+                int64 source_time, int64 max_bytes) {
+  std::lock_guard<std::mutex> lock(rejections_mutex);
+  std::map<std::string, Rejection>::const_iterator it =
+      rejections.find(cache_path);
+  return it != rejections.end() && it->second.source_size == source_size &&
+         it->second.source_time == source_time &&
+         max_bytes <= it->second.max_bytes;
+}
+
+void Reject(const std::string &cache_path, int64 source_size,
+            int64 source_time, int64 max_bytes) {
+  std::lock_guard<std::mutex> lock(rejections_mutex);
+  Rejection rejection = {source_size, source_time, max_bytes};
+  rejections[cache_path] = rejection;
+}
+#endif  // TL_POSIX_FRAME_CACHE
+
+}  // namespace
+
+//------------------------ Constructor/Destructor -------------------
+FrameCache::FrameCache() :
+  directory_(),
+  max_bytes_(kDefaultMaxBytes),
+  mapping_(nullptr),
+  mapping_size_(0),
+  nb_frames_(0),
+  rows_(0),
+  cols_(0),
+  type_(0),
+  data_offset_(0),
+  frame_stride_(0) {}
+
+FrameCache::~FrameCache() {
+  Close();
+}
+
+//------------------------ Public accessors ------------------------
+void FrameCache::set_directory(const std::string &directory) {
+  directory_ = directory;
+}
+
+const std::string &FrameCache::directory() const {
+  return directory_;
+}
+
+void FrameCache::set_max_bytes(int64 max_bytes) {
+  CHECK(max_bytes >= 0);
+  max_bytes_ = max_bytes;
+}
+
+int64 FrameCache::max_bytes() const {
+  return max_bytes_;
+}
+
+bool FrameCache::is_open() const {
+  return mapping_ != nullptr;
+}
+
+int FrameCache::nb_frames() const {
+  return nb_frames_;
+}
+
+cv::Mat FrameCache::frame(int index) const {
+  CHECK(is_open() && 0 <= index && index < nb_frames_);
+  uchar *data = static_cast<uchar *>(mapping_) + data_offset_ +
+                static_cast<size_t>(index) * frame_stride_;
+  return Mat(rows_, cols_, type_, data);
+}
+
+//-------------------------- Main functions ------------------------
+#ifdef TL_POSIX_FRAME_CACHE
+bool FrameCache::Open(const std::string &video_path, std::string *error) {
+  CHECK_NOTNULL(error);
+  Close();
+  if (directory_.empty()) {
+    *error = "no cache directory";
+    return false;
+  }
+
+  // Files are named after the canonical path of the video.
+  char *resolved = realpath(video_path.c_str(), nullptr);
+  if (resolved == nullptr) {
+    *error = "could not find " + video_path;
+    return false;
+  }
+  std::string source(resolved);
+  std::free(resolved);
+  struct stat status;
+  if (stat(source.c_str(), &status) != 0) {
+    *error = "could not find " + video_path;
+    return false;
+  }
+  int64 source_size = static_cast<int64>(status.st_size);
+  int64 source_time = static_cast<int64>(status.st_mtime);
+
+  std::ostringstream name;
+  name << directory_ << '/' << std::hex << std::setw(16) <<
+          std::setfill('0') << std::hash<std::string>()(source) <<
+          kCacheExtension;
+  const std::string cache_path = name.str();
+
+  std::lock_guard<std::mutex> lock(BuildMutex(cache_path));
+  if (!Map(cache_path, source, source_size, source_time)) {
+    if (IsRejected(cache_path, source_size, source_time, max_bytes_)) {
+      *error = source + " does not fit in the cache";
+      return false;
+    }
+    if (!Build(cache_path, source, source_size, source_time, error))
+      return false;
+    if (!Map(cache_path, source, source_size, source_time)) {
+      *error = "could not map " + cache_path;
+      return false;
+    }
+  }
+
+  // The modification time of a file is when it was last opened.
+  utime(cache_path.c_str(), nullptr);
+  Evict(cache_path);
+  return true;
+}
+
+void FrameCache::Close() {
+  if (mapping_ != nullptr) munmap(mapping_, mapping_size_);
+  mapping_ = nullptr;
+  mapping_size_ = 0;
+  nb_frames_ = 0;
+}
+
+//------------------------- Private methods ------------------------
+bool FrameCache::Map(const std::string &cache_path, const std::string &source,
+                     int64 source_size, int64 source_time) {
+  int fd = open(cache_path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat status;
+  if (fstat(fd, &status) != 0 ||
+      status.st_size < static_cast<off_t>(sizeof(CacheHeader))) {
+    close(fd);
+    return false;
+  }
+  size_t size = static_cast<size_t>(status.st_size);
+  void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                       fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) return false;
+
+  const CacheHeader &header = *static_cast<const CacheHeader *>(mapping);
+  const char *path = static_cast<const char *>(mapping) + sizeof(CacheHeader);
+  bool valid =
+      header.magic == kCacheMagic && header.version == kCacheVersion &&
+      header.source_size == source_size &&
+      header.source_time == source_time &&
+      header.source_length == static_cast<int>(source.size()) &&
+      sizeof(CacheHeader) + source.size() <= size &&
+      std::memcmp(path, source.data(), source.size()) == 0 &&
+      header.nb_frames > 0 && header.data_offset > 0 &&
+      header.frame_stride >= static_cast<int64>(
+          header.rows * header.cols * CV_ELEM_SIZE(header.type)) &&
+      header.data_offset + header.nb_frames * header.frame_stride <=
+          static_cast<int64>(size);
+  if (!valid) {
+    munmap(mapping, size);
+    return false;
+  }
+
+  mapping_ = mapping;
+  mapping_size_ = size;
+  nb_frames_ = header.nb_frames;
+  rows_ = header.rows;
+  cols_ = header.cols;
+  type_ = header.type;
+  data_offset_ = static_cast<size_t>(header.data_offset);
+  frame_stride_ = static_cast<size_t>(header.frame_stride);
+  return true;
+}
+
+// Write to a temporary file first so that a crash or a concurrent reader
+// never sees a truncated cache file.
+bool FrameCache::Build(const std::string &cache_path,
+                       const std::string &source, int64 source_size,
+                       int64 source_time, std::string *error) const {
+  VideoCapture capture;
+  Mat frame;
+  if (!capture.open(source)) {
+    *error = "could not open " + source;
+    return false;
+  }
+  capture >> frame;
+  if (frame.empty()) {
+    *error = source + " is empty";
+    return false;
+  }
+
+  CacheHeader header = CacheHeader();
+  header.magic = kCacheMagic;
+  header.version = kCacheVersion;
+  header.rows = frame.rows;
+  header.cols = frame.cols;
+  header.type = frame.type();
+  header.source_length = static_cast<int>(source.size());
+  header.source_size = source_size;
+  header.source_time = source_time;
+  size_t row_bytes = frame.cols * frame.elemSize();
+  size_t frame_bytes = frame.rows * row_bytes;
+  header.frame_stride = static_cast<int64>(Align(frame_bytes,
+                                                 kFrameAlignment));
+  header.data_offset = static_cast<int64>(
+      Align(sizeof(CacheHeader) + source.size(), kPageSize));
+
+  // Reject videos too large before decoding them, if their length is known.
+  int64 nb_frames = static_cast<int64>(capture.get(CV_CAP_PROP_FRAME_COUNT));
+  if (nb_frames > 0 &&
+      header.data_offset + nb_frames * header.frame_stride > max_bytes_) {
+    Reject(cache_path, source_size, source_time, max_bytes_);
+    *error = source + " does not fit in the cache";
+    return false;
+  }
+
+  std::ostringstream temporary;
+  temporary << cache_path << ".tmp" << getpid();
+  const std::string temporary_path = temporary.str();
+  std::ofstream out(temporary_path.c_str(), std::ios::binary);
+  if (!out) {
+    *error = "could not write in " + directory_;
+    return false;
+  }
+  std::vector<char> zeros(kPageSize, 0);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(CacheHeader));
+  out.write(source.data(), source.size());
+  out.write(zeros.data(), header.data_offset - sizeof(CacheHeader) -
+                          source.size());
+
+  int64 total = header.data_offset;
+  while (!frame.empty() && !out.fail()) {
+    std::string issue;
+    if (frame.rows != header.rows || frame.cols != header.cols ||
+        frame.type() != header.type) {
+      issue = source + " has frames of different sizes";
+    } else if (total + header.frame_stride > max_bytes_) {
+      Reject(cache_path, source_size, source_time, max_bytes_);
+      issue = source + " does not fit in the cache";
+    }
+    if (!issue.empty()) {
+      out.close();
+      std::remove(temporary_path.c_str());
+      *error = issue;
+      return false;
+    }
+
+    for (int y = 0; y < frame.rows; ++y) {
+      out.write(frame.ptr<char>(y), row_bytes);
+    }
+    out.write(zeros.data(), header.frame_stride - frame_bytes);
+    total += header.frame_stride;
+    ++header.nb_frames;
+    capture >> frame;  // Reused: frames are written right away.
+  }
+
+  out.seekp(0);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(CacheHeader));
+  out.close();
+  if (out.fail() ||
+      std::rename(temporary_path.c_str(), cache_path.c_str()) != 0) {
+    std::remove(temporary_path.c_str());
+    *error = "could not write " + cache_path;
+    return false;
+  }
+  return true;
+}
+
+void FrameCache::Evict(const std::string &kept_path) const {
+  DIR *dir = opendir(directory_.c_str());
+  if (dir == nullptr) return;
+
+  const size_t extension_length = std::strlen(kCacheExtension);
+  std::vector<CacheFile> files;
+  int64 total = 0;
+  while (const dirent *entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name.size() <= extension_length ||
+        name.compare(name.size() - extension_length, extension_length,
+                     kCacheExtension) != 0) {
+      continue;
+    }
+    CacheFile file = {0, 0, directory_ + "/" + name};
+    struct stat status;
+    if (stat(file.path.c_str(), &status) != 0) continue;
+    file.time = status.st_mtime;
+    file.size = static_cast<int64>(status.st_size);
+    total += file.size;
+    if (file.path != kept_path) files.push_back(file);
+  }
+  closedir(dir);
+
+  std::sort(files.begin(), files.end(),
+            [](const CacheFile &a, const CacheFile &b) {
+    return a.time < b.time;
+  });
+  for (const CacheFile &file : files) {
+    if (total <= max_bytes_) break;
+    if (std::remove(file.path.c_str()) == 0) total -= file.size;
+  }
+}
+#else
+bool FrameCache::Open(const std::string &, std::string *error) {
+  CHECK_NOTNULL(error);
+  Close();
+  *error = "frame caches need a POSIX system";
+  return false;
+}
+
+void FrameCache::Close() {
+  mapping_ = nullptr;
+  mapping_size_ = 0;
+  nb_frames_ = 0;
+}
+
+bool FrameCache::Map(const std::string &, const std::string &, int64,
+                     int64) {
+  return false;
+}
+
+bool FrameCache::Build(const std::string &, const std::string &, int64,
+                       int64, std::string *) const {
+  return false;
+}
+
+void FrameCache::Evict(const std::string &) const {}
+#endif  // TL_POSIX_FRAME_CACHE
+
+}  // namespace tl
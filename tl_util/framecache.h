@@ -0,0 +1,130 @@
+/*!
+ * \file framecache.h
+ * \brief Decoded frames of videos, memory-mapped from a cache on disk.
+ * \author Joachim Valente <joachim.valente@gmail.com>
+ */
+
+#ifndef TL_FRAMECACHE_H
+#define TL_FRAMECACHE_H
+
+#include <string>
+
+#include <opencv2/core/core.hpp>
+
+#include "common.h"
+
+namespace tl {
+
+/*!
+ * \brief Cache of the decoded frames of videos, to decode each video once
+ * whatever the number of runs on it.
+ *
+ * The first time a video is opened, all its frames are decoded and written
+ * raw to a file of the cache directory, named after the path of the video.
+ * The file is then mapped in memory and frames are `cv::Mat` headers over the
+ * mapping, so that reading a frame copies nothing: pages are loaded by the
+ * system on first access and shared by all the processes reading the same
+ * video. Frames are mapped copy-on-write, so writing to one never changes the
+ * cache.
+ *
+ * A cached video is decoded again when the video changes (size or
+ * modification time). The files of the cache take at most a given number of
+ * bytes: the least recently opened ones are removed to make room, and videos
+ * too large to fit are not cached. A video is rejected before being decoded
+ * when its number of frames is known, and a process does not try again to
+ * cache a video it found too large.
+ *
+ * Several threads or processes may open the same video at the same time. Only
+ * one thread of a process decodes a given video; processes may decode it
+ * concurrently, the last to finish replacing the file of the others.
+ * Requires a POSIX system: elsewhere, Open() fails and videos are decoded as
+ * usual.
+ */
+class FrameCache {
+public:
+  //------------------------ Constructor/Destructor -------------------
+  FrameCache();
+  ~FrameCache();
+
+  //------------------------ Public accessors ------------------------
+  /*!
+   * \brief Set the existing directory holding the cache files.
+   */
+  void set_directory(const std::string &directory);
+  const std::string &directory() const;
+
+  /*!
+   * \brief Set the number of bytes the files of the cache may take [def. 4
+   * GiB].
+   */
+  void set_max_bytes(int64 max_bytes);
+  int64 max_bytes() const;
+
+  bool is_open() const;
+
+  /*!
+   * \brief Number of frames of the open video.
+   */
+  int nb_frames() const;
+
+  /*!
+   * \brief Frame of the open video, without copy.
+   * \param index Index of the frame, starting at 0.
+   * \return Header over the mapping, valid until the video is closed.
+   */
+  cv::Mat frame(int index) const;
+
+  //-------------------------- Main functions ------------------------
+  /*!
+   * \brief Open a video from the cache, decoding it into the cache first if
+   * needed. Closes the video open before, if any.
+   * \param video_path Path of the video.
+   * \param error Why the video could not be cached, if it could not.
+   * \return Whether the video is open. If not, it should be decoded as usual.
+   */
+  bool Open(const std::string &video_path, std::string *error);
+
+  /*!
+   * \brief Unmap the open video, invalidating its frames.
+   */
+  void Close();
+
+private:
+  //------------------------- Private methods ------------------------
+  /*!
+   * \brief Map a cache file, if it holds the frames of a source.
+   */
+  bool Map(const std::string &cache_path, const std::string &source,
+           int64 source_size, int64 source_time);
+
+  /*!
+   * \brief Decode a video into a cache file.
+   */
+  bool Build(const std::string &cache_path, const std::string &source,
+             int64 source_size, int64 source_time, std::string *error) const;
+
+  /*!
+   * \brief Remove the least recently opened files until the cache fits its
+   * size, except a given one.
+   */
+  void Evict(const std::string &kept_path) const;
+
+  //------------------------- Private members ------------------------
+  std::string directory_;     //!< Directory of the cache files.
+  int64 max_bytes_;           //!< Bytes of cache files allowed.
+
+  void *mapping_;             //!< Mapped cache file, nullptr if none.
+  size_t mapping_size_;       //!< Bytes mapped.
+  int nb_frames_;             //!< Frames of the open video.
+  int rows_;                  //!< Height of the frames.
+  int cols_;                  //!< Width of the frames.
+  int type_;                  //!< OpenCV type of the frames.
+  size_t data_offset_;        //!< Offset of the first frame in the mapping.
+  size_t frame_stride_;       //!< Bytes between two frames.
+
+  DISALLOW_COPY_AND_ASSIGN(FrameCache);
+};
+
+}  // namespace tl
+
+#endif  // TL_FRAMECACHE_H
@@ -0,0 +1,132 @@
+#include "tl_util/framering.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <thread>
+
+using namespace cv;
+
+namespace tl {
+
+namespace {
+
+// Checks of a position spinning, then yielding, before sleeping between
+// checks. Handoffs take well under a microsecond while spinning; a consumer
+// waiting for a decode is better off sleeping.
+const int kSpins = 64;
+const int kYields = 64;
+const int kSleepMicroseconds = 50;
+
+void Backoff(int *attempts) {
+  ++*attempts;
+  if (*attempts <= kSpins) return;
+  if (*attempts <= kSpins + kYields) {
+    std::this_thread::yield();
+  } else {
+    std::this_thread::sleep_for(
+        std::chrono::microseconds(kSleepMicroseconds));
+  }
+}
+
+}  // namespace
+
+//--------------------------- Constructors --------------------------
+FrameSlot::FrameSlot() :
+  frame(),
+  index(0),
+  timestamp(-1) {}
+
+FrameRing::Cursor::Cursor() :
+  position(0) {}
+
+// Vectors do not align their elements beyond 16 bytes in C++11: tails are
+// built in a buffer one cursor larger than needed, at its first aligned byte.
+FrameRing::FrameRing(int capacity, int nb_consumers) :
+  slots_(std::max(capacity, 1)),
+  nb_consumers_(std::max(nb_consumers, 1)),
+  tail_storage_((nb_consumers_ + 1) * sizeof(Cursor)),
+  tails_(nullptr),
+  closed_(false),
+  head_(),
+  min_tail_(0) {
+  CHECK(capacity >= 1 && nb_consumers >= 1);
+  void *storage = tail_storage_.data();
+  size_t space = tail_storage_.size();
+  storage = std::align(alignof(Cursor), nb_consumers_ * sizeof(Cursor),
+                       storage, space);
+  CHECK_NOTNULL(storage);
+  tails_ = static_cast<Cursor *>(storage);
+  for (int i = 0; i < nb_consumers_; ++i) {
+    new (tails_ + i) Cursor;
+  }
+}
+
+//------------------------ Public accessors ------------------------
+int FrameRing::capacity() const {
+  return static_cast<int>(slots_.size());
+}
+
+int FrameRing::nb_consumers() const {
+  return nb_consumers_;
+}
+
+bool FrameRing::closed() const {
+  return closed_.load(std::memory_order_acquire);
+}
+
+//----------------------------- Producer ---------------------------
+FrameSlot *FrameRing::BeginWrite(RingWait wait) {
+  std::uint64_t head = head_.position.load(std::memory_order_relaxed);
+  int attempts = 0;
+  while (!closed()) {
+    if (head - min_tail_ < slots_.size())
+      return &slots_[head % slots_.size()];
+
+    // Only the slowest consumer keeps the slot, read again all tails.
+    min_tail_ = head;
+    for (int i = 0; i < nb_consumers_; ++i) {
+      min_tail_ = std::min(min_tail_,
+                           tails_[i].position.load(std::memory_order_acquire));
+    }
+    if (head - min_tail_ < slots_.size()) continue;
+    if (wait == TL_RING_NO_WAIT) return nullptr;
+    Backoff(&attempts);
+  }
+  return nullptr;
+}
+
+void FrameRing::EndWrite() {
+  std::uint64_t head = head_.position.load(std::memory_order_relaxed);
+  head_.position.store(head + 1, std::memory_order_release);
+}
+
+//----------------------------- Consumers --------------------------
+const FrameSlot *FrameRing::BeginRead(int consumer, RingWait wait) {
+  CHECK(0 <= consumer && consumer < nb_consumers());
+  std::uint64_t tail =
+      tails_[consumer].position.load(std::memory_order_relaxed);
+  int attempts = 0;
+  while (true) {
+    // Closed is read first: frames published before closing are seen.
+    bool was_closed = closed();
+    if (head_.position.load(std::memory_order_acquire) > tail)
+      return &slots_[tail % slots_.size()];
+    if (was_closed || wait == TL_RING_NO_WAIT) return nullptr;
+    Backoff(&attempts);
+  }
+}
+
+void FrameRing::EndRead(int consumer) {
+  CHECK(0 <= consumer && consumer < nb_consumers());
+  Cursor &tail = tails_[consumer];
+  std::uint64_t position = tail.position.load(std::memory_order_relaxed);
+  tail.position.store(position + 1, std::memory_order_release);
+}
+
+void FrameRing::Close() {
+  closed_.store(true, std::memory_order_release);
+}
+
+}  // namespace tl
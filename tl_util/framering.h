@@ -0,0 +1,144 @@
+/*!
+ * \file framering.h
+ * \brief Lock-free ring of frames between a decoding thread and tracking
+ * threads.
+ * \author Joachim Valente <joachim.valente@gmail.com>
+ */
+
+#ifndef TL_FRAMERING_H
+#define TL_FRAMERING_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "common.h"
+
+namespace tl {
+
+/*!
+ * \brief What to do when a frame cannot be written or read yet.
+ */
+enum RingWait {
+  TL_RING_WAIT = 0,   //!< Wait until it can, or the ring is closed.
+  TL_RING_NO_WAIT     //!< Return nullptr at once.
+};
+
+/*!
+ * \brief Slot of a FrameRing.
+ */
+struct FrameSlot {
+  //--------------------------- Constructor --------------------------
+  FrameSlot();
+
+  //----------------------------- Members ----------------------------
+  cv::Mat frame;        //!< Frame, its buffer reused by the next frames.
+  int index;            //!< Number of the frame in its source.
+  double timestamp;     //!< Position in the source in ms, -1 if unknown.
+};
+
+/*!
+ * \brief Fixed ring of frame slots written by one thread and read, in the
+ * same order, by one or more threads.
+ *
+ * The producer fills a slot in place, e.g. decoding into its frame, whose
+ * buffer is then reused when the slot comes round again, and publishes it.
+ * Each consumer reads every frame: with several consumers, e.g. trackers of
+ * different objects sharing a decode, a slot is written again only once all
+ * of them are done with it. Positions are atomic counters, each on its own
+ * cache line, so that neither side ever takes a lock.
+ *
+ * Waiting spins briefly, then yields, then sleeps between checks. Either side
+ * may close the ring: the producer at the end of the source, consumers to
+ * stop it early. Consumers still read the frames published before.
+ *
+ * A frame must not be used after the slot holding it was released: copy it
+ * to keep it (Tracker::Track() does).
+ *
+ * The cursors are aligned on cache lines, and so is the ring. Create it on
+ * the stack or as a static object, not with `new`, which does not align
+ * beyond 16 bytes in C++11 (the compiler warns with -Waligned-new).
+ */
+class FrameRing {
+public:
+  //--------------------------- Constructor --------------------------
+  /*!
+   * \param capacity Number of slots (at least 1).
+   * \param nb_consumers Number of consumers reading each frame (at least 1).
+   */
+  FrameRing(int capacity, int nb_consumers = 1);
+
+  //------------------------ Public accessors ------------------------
+  int capacity() const;
+  int nb_consumers() const;
+
+  /*!
+   * \brief Whether the ring was closed. Frames published before may still be
+   * there to read.
+   */
+  bool closed() const;
+
+  //----------------------------- Producer ---------------------------
+  /*!
+   * \brief Slot to fill with the next frame, then publish with EndWrite().
+   * \return nullptr if the ring is closed, or full and not waiting.
+   */
+  FrameSlot *BeginWrite(RingWait wait);
+
+  /*!
+   * \brief Publish the slot returned by BeginWrite().
+   */
+  void EndWrite();
+
+  //----------------------------- Consumers --------------------------
+  /*!
+   * \brief Next frame for a consumer, to release with EndRead().
+   * \param consumer Index of the consumer.
+   * \return nullptr if the ring is closed and all its frames were read, or
+   * empty and not waiting.
+   */
+  const FrameSlot *BeginRead(int consumer, RingWait wait);
+
+  /*!
+   * \brief Release the slot returned by BeginRead() to a consumer.
+   */
+  void EndRead(int consumer);
+
+  /*!
+   * \brief Stop the producer: no frame is written after.
+   */
+  void Close();
+
+private:
+  //------------------------ Private structure -----------------------
+  /*!
+   * \brief Number of frames written or read, alone on its cache line.
+   */
+  struct alignas(64) Cursor {
+    Cursor();
+
+    std::atomic<std::uint64_t> position;
+  };
+
+  //------------------------- Private members ------------------------
+  // Read by all threads, written at most once after construction.
+  std::vector<FrameSlot> slots_;      //!< Slots, preallocated.
+  int nb_consumers_;                  //!< Number of consumers.
+  std::vector<char> tail_storage_;    //!< Bytes holding the tails, with room
+                                      //!< to align them.
+  Cursor *tails_;                     //!< Frames released, by consumer, in
+                                      //!< tail_storage_.
+  std::atomic<bool> closed_;          //!< Whether the ring was closed.
+
+  Cursor head_;                       //!< Frames published.
+  std::uint64_t min_tail_;            //!< Slowest tail last seen by the
+                                      //!< producer.
+
+  DISALLOW_COPY_AND_ASSIGN(FrameRing);
+};
+
+}  // namespace tl
+
+#endif  // TL_FRAMERING_H
@@ -1,5 +1,8 @@
 #include "tl_util/geometry.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "common.h"
 
 using namespace cv;
@@ -12,5 +15,29 @@ bool IsRectInsideFrame(cv::Rect rect, const cv::Mat &frame) {
       0 <= rect.tl().y && rect.br().y <= frame.rows;
 }
 
+double Overlap(cv::Rect a, cv::Rect b) {
+  double intersection = (a & b).area();
+  double union_area = a.area() + b.area() - intersection;
+  return (union_area > 0) ? intersection / union_area : 0;
+}
+
+double CenterDistance(cv::Rect a, cv::Rect b) {
+  double dx = (a.x + 0.5 * a.width) - (b.x + 0.5 * b.width);
+  double dy = (a.y + 0.5 * a.height) - (b.y + 0.5 * b.height);
+  return std::sqrt(dx * dx + dy * dy);
+}
+
+cv::Rect WindowPositions(cv::Rect search_region, cv::Size window_size,
+                         cv::Size frame_size) {
+  Rect frame_rect(Point(0, 0), frame_size);
+  Rect region = (search_region.area() > 0) ? (search_region & frame_rect)
+                                           : frame_rect;
+  int left = std::min(region.x, frame_size.width - window_size.width);
+  int top = std::min(region.y, frame_size.height - window_size.height);
+  int right = std::max(region.x + region.width - window_size.width, left);
+  int bottom = std::max(region.y + region.height - window_size.height, top);
+  return Rect(left, top, right - left + 1, bottom - top + 1);
+}
+
 }  // namespace internal
 }  // namespace tl
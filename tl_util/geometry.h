@@ -17,6 +17,28 @@ namespace internal {
  */
 bool IsRectInsideFrame(cv::Rect rect, const cv::Mat &frame);
 
+/*!
+ * \brief Area of the intersection over area of the union of two rects (0 if
+ * both are empty).
+ */
+double Overlap(cv::Rect a, cv::Rect b);
+
+/*!
+ * \brief Distance between the centers of two rects.
+ */
+double CenterDistance(cv::Rect a, cv::Rect b);
+
+/*!
+ * \brief Top-left corners of the windows of a given size inside a search
+ * region, as a rect (e.g. the part of a template matching result to compute).
+ * \param search_region Region clipped to the frame and grown to hold a window
+ * if needed. Empty for the whole frame.
+ * \param window_size Size of the windows, not larger than the frame.
+ * \param frame_size Size of the frame.
+ */
+cv::Rect WindowPositions(cv::Rect search_region, cv::Size window_size,
+                         cv::Size frame_size);
+
 }  // namespace internal
 }  // namespace tl
 
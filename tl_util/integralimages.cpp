@@ -0,0 +1,152 @@
+#include "tl_util/integralimages.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "tl_util/matpool.h"
+
+using namespace cv;
+
+namespace tl {
+
+//-------------------------- Constructors --------------------------
+IntegralImages::IntegralImages() :
+  frame_(),
+  sum_(PooledMat()),
+  square_sum_(PooledMat()),
+  computed_(false),
+  mutex_() {}
+
+IntegralImages::IntegralImages(const cv::Mat &frame) :
+  frame_(frame),
+  sum_(PooledMat()),
+  square_sum_(PooledMat()),
+  computed_(false),
+  mutex_() {}
+
+//------------------------ Public accessors ------------------------
+const cv::Mat &IntegralImages::frame() const {
+  return frame_;
+}
+
+void IntegralImages::Reset(const cv::Mat &frame) {
+  frame_ = frame;
+  sum_.release();
+  square_sum_.release();
+  computed_ = false;
+}
+
+//------------------------- Main functions -------------------------
+void IntegralImages::MatchTemplate(const cv::Mat &templ, int method,
+                                   cv::Mat *result) const {
+  CHECK_NOTNULL(result);
+  CHECK(templ.type() == frame_.type());
+  CHECK(templ.cols <= frame_.cols && templ.rows <= frame_.rows);
+
+  // Correlation term, the only one depending on the template and the frame.
+  matchTemplate(frame_, templ, *result, CV_TM_CCORR);
+  CompleteMatch(templ, method, Point(0, 0), result);
+}
+
+// Same computation as the end of cv::matchTemplate, with the window sums read
+// on the shared integral images instead of integrals computed for each call.
+void IntegralImages::CompleteMatch(const cv::Mat &templ, int method,
+                                   cv::Point offset,
+                                   cv::Mat *correlation) const {
+  CHECK_NOTNULL(correlation);
+  CHECK(correlation->type() == CV_32F);
+  CHECK(templ.type() == frame_.type());
+  CHECK(offset.x >= 0 && offset.y >= 0 &&
+        offset.x + correlation->cols + templ.cols - 1 <= frame_.cols &&
+        offset.y + correlation->rows + templ.rows - 1 <= frame_.rows);
+  if (method == CV_TM_CCORR) return;
+  Precompute();
+
+  bool normed = (method == CV_TM_SQDIFF_NORMED ||
+                 method == CV_TM_CCORR_NORMED ||
+                 method == CV_TM_CCOEFF_NORMED);
+  bool coeff = (method == CV_TM_CCOEFF || method == CV_TM_CCOEFF_NORMED);
+  bool sqdiff = (method == CV_TM_SQDIFF || method == CV_TM_SQDIFF_NORMED);
+
+  // Statistics of the template.
+  int cn = frame_.channels();
+  double inv_area = 1. / (static_cast<double>(templ.rows) * templ.cols);
+  Scalar templ_mean;
+  Scalar templ_sdv;
+  meanStdDev(templ, templ_mean, templ_sdv);
+  double templ_norm = 0;
+  double templ_sum2 = 0;
+  for (int c = 0; c < cn; ++c) {
+    templ_norm += templ_sdv[c] * templ_sdv[c];
+    templ_sum2 += templ_sdv[c] * templ_sdv[c] +
+                  templ_mean[c] * templ_mean[c];
+  }
+  if (method == CV_TM_CCOEFF_NORMED && templ_norm < DBL_EPSILON) {
+    *correlation = Scalar::all(1);
+    return;
+  }
+  if (!coeff) {
+    templ_mean = Scalar::all(0);
+    templ_norm = templ_sum2;
+  }
+  templ_sum2 /= inv_area;
+  templ_norm = std::sqrt(templ_norm) / std::sqrt(inv_area);
+
+  // Combine with the sums over each window.
+  int row_step = static_cast<int>(sum_.step / sizeof(double));
+  int width = templ.cols * cn;
+  int height = templ.rows * row_step;
+  for (int y = 0; y < correlation->rows; ++y) {
+    float *row = correlation->ptr<float>(y);
+    const double *s = sum_.ptr<double>(offset.y + y) + offset.x * cn;
+    const double *q = square_sum_.ptr<double>(offset.y + y) + offset.x * cn;
+    for (int x = 0; x < correlation->cols; ++x, s += cn, q += cn) {
+      double num = row[x];
+      double wnd_mean2 = 0;
+      double wnd_sum2 = 0;
+      for (int c = 0; c < cn; ++c) {
+        if (coeff) {
+          double t = s[c] - s[c + width] - s[c + height] +
+                     s[c + height + width];
+          wnd_mean2 += t * t;
+          num -= t * templ_mean[c];
+        }
+        if (normed || sqdiff) {
+          wnd_sum2 += q[c] - q[c + width] - q[c + height] +
+                      q[c + height + width];
+        }
+      }
+      wnd_mean2 *= inv_area;
+      if (sqdiff)
+        num = std::max(wnd_sum2 - 2 * num + templ_sum2, 0.0);
+
+      if (normed) {
+        double t = std::sqrt(std::max(wnd_sum2 - wnd_mean2, 0.0)) *
+                   templ_norm;
+        if (std::fabs(num) < t)
+          num /= t;
+        else if (std::fabs(num) < t * 1.125)
+          num = (num > 0) ? 1 : -1;
+        else
+          num = (method != CV_TM_SQDIFF_NORMED) ? 0 : 1;
+      }
+      row[x] = static_cast<float>(num);
+    }
+  }
+}
+
+void IntegralImages::Precompute() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!computed_) Compute();
+  computed_ = true;
+}
+
+//------------------------- Private methods ------------------------
+void IntegralImages::Compute() const {
+  integral(frame_, sum_, square_sum_, CV_64F);
+}
+
+}  // namespace tl
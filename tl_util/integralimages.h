@@ -0,0 +1,102 @@
+/*!
+ * \file integralimages.h
+ * \brief Window statistics of a frame shared by several detectors.
+ * \author Joachim Valente <joachim.valente@gmail.com>
+ */
+
+#ifndef TL_INTEGRALIMAGES_H
+#define TL_INTEGRALIMAGES_H
+
+#include <mutex>
+
+#include <opencv2/core/core.hpp>
+
+#include "common.h"
+
+namespace tl {
+
+/*!
+ * \brief Integral and squared integral images of a frame.
+ *
+ * Template matching methods other than CV_TM_CCORR combine the correlation of
+ * the template with every window of the frame with statistics of that window,
+ * which only depend on the frame. Computing them once per frame from integral
+ * images lets all detectors matching templates on that frame pay only for the
+ * correlation.
+ *
+ * Integral images are computed on first use. All methods but `Reset()` are
+ * thread-safe.
+ */
+class IntegralImages {
+public:
+  //-------------------------- Constructors --------------------------
+  /*!
+   * \brief No frame, to be given with `Reset()`.
+   */
+  IntegralImages();
+
+  /*!
+   * \param frame Frame, not copied: it must be left unchanged while this
+   * object is used.
+   */
+  explicit IntegralImages(const cv::Mat &frame);
+
+  //------------------------ Public accessors ------------------------
+  const cv::Mat &frame() const;
+
+  /*!
+   * \brief Start over with another frame, e.g. the next one of a sequence.
+   * The buffers of the integral images go back to the pool.
+   * \param frame Frame, not copied, or an empty matrix to only release the
+   * previous one.
+   */
+  void Reset(const cv::Mat &frame);
+
+  //------------------------- Main functions -------------------------
+  /*!
+   * \brief Same as `cv::matchTemplate()` on the frame.
+   * \param templ Template of the same type as the frame, not larger.
+   * \param method OpenCV comparison method (CV_TM_*).
+   * \param result Comparison result (CV_32F).
+   */
+  void MatchTemplate(const cv::Mat &templ, int method, cv::Mat *result) const;
+
+  /*!
+   * \brief Turn the correlation of a template with windows of the frame into
+   * the result of another comparison method.
+   * \param templ Template of the same type as the frame.
+   * \param method OpenCV comparison method (CV_TM_*).
+   * \param offset Top-left corner in the frame of the window of the first
+   * element of correlation.
+   * \param correlation CV_TM_CCORR result (CV_32F) on a block of windows
+   * inside the frame, replaced by the result of method.
+   */
+  void CompleteMatch(const cv::Mat &templ, int method, cv::Point offset,
+                     cv::Mat *correlation) const;
+
+  /*!
+   * \brief Compute the integral images now rather than on the first match
+   * needing them, e.g. to keep them out of a timed section.
+   */
+  void Precompute() const;
+
+private:
+  //------------------------- Private methods ------------------------
+  /*!
+   * \brief Compute the integral images.
+   */
+  void Compute() const;
+
+  //------------------------- Private members ------------------------
+  cv::Mat frame_;                      //!< Frame (shared data).
+  mutable cv::Mat sum_;                //!< Integral of the frame (CV_64F).
+  mutable cv::Mat square_sum_;         //!< Integral of its squares (CV_64F).
+  mutable bool computed_;              //!< Whether integrals were computed.
+  mutable std::mutex mutex_;           //!< Guards the integrals.
+
+  DISALLOW_COPY_AND_ASSIGN(IntegralImages);
+};
+
+}  // namespace tl
+
+#endif  // TL_INTEGRALIMAGES_H
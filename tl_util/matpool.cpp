@@ -0,0 +1,170 @@
+#include "tl_util/matpool.h"
+
+using namespace cv;
+
+namespace tl {
+
+namespace {
+
+// Bytes before the data of a buffer, holding its size class. Keeps the data
+// as aligned as the buffer.
+const size_t kHeaderBytes = 64;
+
+// Smallest size class, 2^kMinExponent bytes.
+const int kMinExponent = 8;
+
+// Size classes per power of two.
+const int kClassesPerExponent = 4;
+
+const int kNbSizeClasses = (64 - kMinExponent) * kClassesPerExponent;
+
+const int64 kDefaultMaxCachedBytes = static_cast<int64>(512) << 20;
+
+}  // namespace
+
+//--------------------------- Constructors --------------------------
+MatPoolStats::MatPoolStats() :
+  nb_allocations(0),
+  nb_reused(0),
+  nb_system_allocations(0),
+  nb_system_frees(0),
+  bytes_in_use(0),
+  bytes_cached(0) {}
+
+MatPool::MatPool() :
+  mutex_(),
+  free_blocks_(kNbSizeClasses),
+  max_cached_bytes_(kDefaultMaxCachedBytes),
+  stats_() {}
+
+//---------------------------- Instance ----------------------------
+MatPool &MatPool::Instance() {
+  static MatPool *pool = new MatPool;
+  return *pool;
+}
+
+//------------------------ Public accessors ------------------------
+void MatPool::set_max_cached_bytes(int64 max_cached_bytes) {
+  CHECK(max_cached_bytes >= 0);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_cached_bytes_ = max_cached_bytes;
+    if (stats_.bytes_cached <= max_cached_bytes_) return;
+  }
+  Trim();
+}
+
+MatPoolStats MatPool::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void MatPool::ResetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.nb_allocations = 0;
+  stats_.nb_reused = 0;
+  stats_.nb_system_allocations = 0;
+  stats_.nb_system_frees = 0;
+}
+
+void MatPool::Trim() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t c = 0; c < free_blocks_.size(); ++c) {
+    for (uchar *block : free_blocks_[c]) {
+      fastFree(block);
+      stats_.bytes_cached -= ClassBytes(static_cast<int>(c));
+      ++stats_.nb_system_frees;
+    }
+    free_blocks_[c].clear();
+  }
+}
+
+//-------------------- cv::MatAllocator interface ------------------
+// Buffers are laid out as the header, the data and the reference count.
+void MatPool::allocate(int dims, const int *sizes, int type, int *&refcount,
+                       uchar *&datastart, uchar *&data, size_t *step) {
+  size_t total = CV_ELEM_SIZE(type);
+  for (int i = dims - 1; i >= 0; --i) {
+    step[i] = total;
+    total *= sizes[i];
+  }
+  size_t data_bytes = alignSize(total, sizeof(int));
+  int size_class = SizeClass(kHeaderBytes + data_bytes + sizeof(int));
+  size_t bytes = ClassBytes(size_class);
+
+  uchar *block = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.nb_allocations;
+    stats_.bytes_in_use += bytes;
+    std::vector<uchar *> &blocks = free_blocks_[size_class];
+    if (!blocks.empty()) {
+      block = blocks.back();
+      blocks.pop_back();
+      stats_.bytes_cached -= bytes;
+      ++stats_.nb_reused;
+    } else {
+      ++stats_.nb_system_allocations;
+    }
+  }
+  if (block == nullptr) {
+    block = static_cast<uchar *>(fastMalloc(bytes));
+    *reinterpret_cast<int *>(block) = size_class;
+  }
+
+  datastart = data = block + kHeaderBytes;
+  refcount = reinterpret_cast<int *>(data + data_bytes);
+  *refcount = 1;
+}
+
+void MatPool::deallocate(int *, uchar *datastart, uchar *) {
+  uchar *block = datastart - kHeaderBytes;
+  int size_class = *reinterpret_cast<const int *>(block);
+  size_t bytes = ClassBytes(size_class);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.bytes_in_use -= bytes;
+    if (stats_.bytes_cached + static_cast<int64>(bytes) <= max_cached_bytes_) {
+      free_blocks_[size_class].push_back(block);
+      stats_.bytes_cached += bytes;
+      return;
+    }
+    ++stats_.nb_system_frees;
+  }
+  fastFree(block);
+}
+
+//------------------------- Private methods ------------------------
+int MatPool::SizeClass(size_t bytes) {
+  if (bytes <= (static_cast<size_t>(1) << kMinExponent)) return 0;
+
+  // 2^exponent < bytes <= 2^(exponent + 1), split in quarters.
+  int exponent = kMinExponent;
+  while ((static_cast<size_t>(1) << (exponent + 1)) < bytes) ++exponent;
+  size_t power = static_cast<size_t>(1) << exponent;
+  size_t quarter = power / kClassesPerExponent;
+  int index = static_cast<int>((bytes - power + quarter - 1) / quarter);
+  return (exponent - kMinExponent) * kClassesPerExponent + index;
+}
+
+size_t MatPool::ClassBytes(int size_class) {
+  int exponent = kMinExponent + size_class / kClassesPerExponent;
+  size_t quarter = (static_cast<size_t>(1) << exponent) / kClassesPerExponent;
+  return quarter * (kClassesPerExponent + size_class % kClassesPerExponent);
+}
+
+//---------------------------- Matrices ----------------------------
+cv::Mat PooledMat() {
+  Mat mat;
+  mat.allocator = &MatPool::Instance();
+  return mat;
+}
+
+cv::Mat PooledClone(const cv::Mat &mat) {
+  Mat copy = PooledMat();
+  mat.copyTo(copy);
+  return copy;
+}
+
+}  // namespace tl
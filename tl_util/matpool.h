@@ -0,0 +1,121 @@
+/*!
+ * \file matpool.h
+ * \brief Pool of the buffers of the matrices allocated at every frame.
+ * \author Joachim Valente <joachim.valente@gmail.com>
+ */
+
+#ifndef TL_MATPOOL_H
+#define TL_MATPOOL_H
+
+#include <mutex>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "common.h"
+
+namespace tl {
+
+/*!
+ * \brief Counters of a MatPool.
+ */
+struct MatPoolStats {
+  //--------------------------- Constructor --------------------------
+  MatPoolStats();
+
+  //----------------------------- Members ----------------------------
+  int64 nb_allocations;         //!< Buffers requested by matrices.
+  int64 nb_reused;              //!< Requests served with a free buffer.
+  int64 nb_system_allocations;  //!< Requests that allocated a new buffer.
+  int64 nb_system_frees;        //!< Buffers given back to the system.
+  int64 bytes_in_use;           //!< Bytes of the buffers of live matrices.
+  int64 bytes_cached;           //!< Bytes of the free buffers kept.
+};
+
+/*!
+ * \brief Allocator keeping the buffers of released matrices for the next
+ * matrices of the same size class.
+ *
+ * Tracking allocates and frees the same full-frame temporaries at every frame
+ * (copies of the frame, derived images, match and back projection results).
+ * Matrices created through the pool (see PooledMat()) take their buffer from
+ * a free list of its size class and give it back when released, so that once
+ * every size has been seen, tracking no longer calls the system allocator.
+ * Size classes are spaced by a quarter of a power of two, so that a buffer is
+ * at most 25% larger than requested.
+ *
+ * The pool is shared by all threads: each allocation and release takes a
+ * lock, which is negligible next to the processing of a frame. Free buffers
+ * are kept up to a number of bytes, past which released buffers are freed.
+ */
+class MatPool : public cv::MatAllocator {
+public:
+  //--------------------------- Instance ---------------------------
+  /*!
+   * \brief Pool of the process, never destroyed so that it outlives all
+   * matrices.
+   */
+  static MatPool &Instance();
+
+  //------------------------ Public accessors ------------------------
+  /*!
+   * \brief Set the number of bytes of free buffers kept [def. 512 MiB].
+   */
+  void set_max_cached_bytes(int64 max_cached_bytes);
+
+  MatPoolStats stats() const;
+
+  /*!
+   * \brief Reset the counters of requests, e.g. once tracking reached its
+   * steady state, so that they count its allocations only.
+   */
+  void ResetStats();
+
+  /*!
+   * \brief Free all the free buffers.
+   */
+  void Trim();
+
+  //-------------------- cv::MatAllocator interface ------------------
+  virtual void allocate(int dims, const int *sizes, int type, int *&refcount,
+                        uchar *&datastart, uchar *&data, size_t *step);
+  virtual void deallocate(int *refcount, uchar *datastart, uchar *data);
+
+private:
+  //--------------------------- Constructor --------------------------
+  MatPool();
+
+  //------------------------- Private methods ------------------------
+  /*!
+   * \brief Smallest size class holding a number of bytes.
+   */
+  static int SizeClass(size_t bytes);
+
+  /*!
+   * \brief Bytes of the buffers of a size class.
+   */
+  static size_t ClassBytes(int size_class);
+
+  //------------------------- Private members ------------------------
+  mutable std::mutex mutex_;          //!< Guards all members below.
+  std::vector<std::vector<uchar *> > free_blocks_;  //!< By size class.
+  int64 max_cached_bytes_;            //!< Bytes of free buffers kept.
+  MatPoolStats stats_;                //!< Counters.
+
+  DISALLOW_COPY_AND_ASSIGN(MatPool);
+};
+
+/*!
+ * \brief Empty matrix whose buffer, once created (e.g. as the output of an
+ * OpenCV function), comes from the pool.
+ */
+cv::Mat PooledMat();
+
+/*!
+ * \brief Copy of a matrix into a buffer of the pool.
+ */
+cv::Mat PooledClone(const cv::Mat &mat);
+
+}  // namespace tl
+
+#endif  // TL_MATPOOL_H
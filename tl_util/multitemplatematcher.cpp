@@ -0,0 +1,253 @@
+#include "tl_util/multitemplatematcher.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "tl_util/geometry.h"
+
+using namespace cv;
+using namespace tl::internal;
+
+namespace tl {
+
+namespace {
+
+// Windows per side of a tile in spatial mode. The pixels of a tile and of a
+// template stay in cache while all templates of a group are matched on it.
+const int kTileSize = 64;
+
+// Relative cost per pixel of the padded frame of the spectrum product and
+// inverse DFT done for each template in FFT mode.
+const double kFftCost = 4;
+
+bool LowerIsBetter(int method) {
+  return method == CV_TM_SQDIFF || method == CV_TM_SQDIFF_NORMED;
+}
+
+// DFT of each channel of an image padded with zeros to dft_size.
+void ComputeSpectra(const Mat &image, Size dft_size,
+                    std::vector<Mat> *spectra) {
+  Mat converted;
+  image.convertTo(converted, CV_32F);
+  std::vector<Mat> channels;
+  split(converted, channels);
+  spectra->resize(channels.size());
+  for (size_t c = 0; c < channels.size(); ++c) {
+    Mat padded;
+    copyMakeBorder(channels[c], padded, 0, dft_size.height - image.rows,
+                   0, dft_size.width - image.cols, BORDER_CONSTANT,
+                   Scalar::all(0));
+    dft(padded, (*spectra)[c], 0, image.rows);
+  }
+}
+
+}  // namespace
+
+//--------------------------- Constructors --------------------------
+TemplateMatch::TemplateMatch() :
+  location(),
+  score(0) {}
+
+MultiTemplateMatcher::Entry::Entry(const cv::Mat &entry_templ,
+                                   int entry_method,
+                                   cv::Rect entry_search_region) :
+  templ(entry_templ),
+  method(entry_method),
+  search_region(entry_search_region),
+  spectra() {}
+
+MultiTemplateMatcher::MultiTemplateMatcher() :
+  entries_(),
+  mode_(TL_MATCH_AUTO),
+  dft_size_(),
+  frame_spectra_() {}
+
+//------------------------ Public accessors ------------------------
+int MultiTemplateMatcher::AddTemplate(const cv::Mat &templ, int method,
+                                      cv::Rect search_region) {
+  CHECK_NOTNULL(templ.data);
+  CHECK_MSG(method == CV_TM_CCOEFF || method == CV_TM_CCOEFF_NORMED ||
+            method == CV_TM_CCORR || method == CV_TM_CCORR_NORMED ||
+            method == CV_TM_SQDIFF || method == CV_TM_SQDIFF_NORMED,
+            "invalid method");
+  entries_.push_back(Entry(templ, method, search_region));
+  return static_cast<int>(entries_.size()) - 1;
+}
+
+void MultiTemplateMatcher::set_search_region(int index,
+                                             cv::Rect search_region) {
+  CHECK(0 <= index && index < size());
+  entries_[index].search_region = search_region;
+}
+
+void MultiTemplateMatcher::set_mode(TemplateMatchingMode mode) {
+  mode_ = mode;
+}
+
+int MultiTemplateMatcher::size() const {
+  return static_cast<int>(entries_.size());
+}
+
+void MultiTemplateMatcher::Clear() {
+  entries_.clear();
+}
+
+//------------------------- Main functions -------------------------
+void MultiTemplateMatcher::Match(const cv::Mat &frame,
+                                 std::vector<TemplateMatch> *matches) {
+  IntegralImages integral_images(frame);
+  Match(integral_images, matches);
+}
+
+void MultiTemplateMatcher::Match(const IntegralImages &integral_images,
+                                 std::vector<TemplateMatch> *matches) {
+  CHECK_NOTNULL(matches);
+  const Mat &frame = integral_images.frame();
+  CHECK_NOTNULL(frame.data);
+
+  // Group templates by size and type.
+  matches->assign(entries_.size(), TemplateMatch());
+  std::vector<std::vector<int> > groups;
+  for (int i = 0; i < size(); ++i) {
+    const Mat &templ = entries_[i].templ;
+    CHECK(templ.type() == frame.type());
+    CHECK(templ.cols <= frame.cols && templ.rows <= frame.rows);
+    (*matches)[i].score = LowerIsBetter(entries_[i].method) ? DBL_MAX
+                                                            : -DBL_MAX;
+
+    size_t g = 0;
+    while (g < groups.size() &&
+           (entries_[groups[g][0]].templ.size() != templ.size() ||
+            entries_[groups[g][0]].templ.type() != templ.type())) {
+      ++g;
+    }
+    if (g == groups.size()) groups.push_back(std::vector<int>());
+    groups[g].push_back(i);
+  }
+
+  for (const std::vector<int> &group : groups) {
+    bool fft = (mode_ == TL_MATCH_FFT ||
+                (mode_ == TL_MATCH_AUTO && PreferFft(group, frame.size())));
+    if (fft) {
+      MatchFft(integral_images, group, matches);
+    } else {
+      MatchSpatial(integral_images, group, matches);
+    }
+  }
+  frame_spectra_.clear();
+}
+
+//------------------------- Private methods ------------------------
+void MultiTemplateMatcher::MatchSpatial(
+    const IntegralImages &integral_images, const std::vector<int> &group,
+    std::vector<TemplateMatch> *matches) const {
+  const Mat &frame = integral_images.frame();
+  Size templ_size = entries_[group[0]].templ.size();
+
+  std::vector<Rect> regions;
+  for (int i : group) {
+    const Entry &entry = entries_[i];
+    regions.push_back(WindowPositions(entry.search_region, entry.templ.size(),
+                                      frame.size()));
+  }
+  Rect bounds = regions[0];
+  for (const Rect &region : regions) {
+    bounds |= region;
+  }
+
+  // One pass over the windows searched by the group, tile by tile.
+  Mat scores;
+  for (int y = bounds.y; y < bounds.y + bounds.height; y += kTileSize) {
+    for (int x = bounds.x; x < bounds.x + bounds.width; x += kTileSize) {
+      Rect tile(x, y, kTileSize, kTileSize);
+      for (size_t k = 0; k < group.size(); ++k) {
+        Rect part = tile & regions[k];
+        if (part.area() == 0) continue;
+
+        const Entry &entry = entries_[group[k]];
+        Rect windows(part.x, part.y, part.width + templ_size.width - 1,
+                     part.height + templ_size.height - 1);
+        matchTemplate(frame(windows), entry.templ, scores, CV_TM_CCORR);
+        integral_images.CompleteMatch(entry.templ, entry.method, part.tl(),
+                                      &scores);
+        KeepBest(entry, scores, part.tl(), &(*matches)[group[k]]);
+      }
+    }
+  }
+}
+
+void MultiTemplateMatcher::MatchFft(const IntegralImages &integral_images,
+                                    const std::vector<int> &group,
+                                    std::vector<TemplateMatch> *matches) {
+  const Mat &frame = integral_images.frame();
+
+  // The correlation is circular: padding to the frame size is enough for the
+  // windows inside the frame not to wrap around.
+  if (frame_spectra_.empty()) {
+    dft_size_ = Size(getOptimalDFTSize(frame.cols),
+                     getOptimalDFTSize(frame.rows));
+    ComputeSpectra(frame, dft_size_, &frame_spectra_);
+  }
+
+  Mat product;
+  Mat correlation;
+  for (int i : group) {
+    Entry &entry = entries_[i];
+    if (entry.spectra.empty() || entry.spectra[0].size() != dft_size_)
+      ComputeSpectra(entry.templ, dft_size_, &entry.spectra);
+
+    Mat accumulated = Mat::zeros(dft_size_, CV_32F);
+    for (size_t c = 0; c < frame_spectra_.size(); ++c) {
+      mulSpectrums(frame_spectra_[c], entry.spectra[c], product, 0, true);
+      accumulated += product;
+    }
+    idft(accumulated, correlation, DFT_SCALE | DFT_REAL_OUTPUT);
+
+    Rect region = WindowPositions(entry.search_region, entry.templ.size(),
+                                  frame.size());
+    Mat scores = correlation(region);
+    integral_images.CompleteMatch(entry.templ, entry.method, region.tl(),
+                                  &scores);
+    KeepBest(entry, scores, region.tl(), &(*matches)[i]);
+  }
+}
+
+bool MultiTemplateMatcher::PreferFft(const std::vector<int> &group,
+                                     cv::Size frame_size) const {
+  double dft_area = static_cast<double>(getOptimalDFTSize(frame_size.width)) *
+                    getOptimalDFTSize(frame_size.height);
+  double spatial_cost = 0;
+  double fft_cost = 0;
+  for (int i : group) {
+    const Entry &entry = entries_[i];
+    Rect region = WindowPositions(entry.search_region, entry.templ.size(),
+                                  frame_size);
+    spatial_cost += static_cast<double>(region.area()) * entry.templ.total();
+    fft_cost += kFftCost * dft_area * std::log2(dft_area);
+  }
+  return fft_cost < spatial_cost;
+}
+
+void MultiTemplateMatcher::KeepBest(const Entry &entry, const cv::Mat &scores,
+                                    cv::Point offset,
+                                    TemplateMatch *match) const {
+  double min_score = 0;
+  double max_score = 0;
+  Point min_location;
+  Point max_location;
+  minMaxLoc(scores, &min_score, &max_score, &min_location, &max_location);
+  if (LowerIsBetter(entry.method)) {
+    if (min_score < match->score) {
+      match->score = min_score;
+      match->location = offset + min_location;
+    }
+  } else if (max_score > match->score) {
+    match->score = max_score;
+    match->location = offset + max_location;
+  }
+}
+
+}  // namespace tl
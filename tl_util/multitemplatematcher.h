@@ -0,0 +1,159 @@
+/*!
+ * \file multitemplatematcher.h
+ * \brief Matching of many templates against the same frame.
+ * \author Joachim Valente <joachim.valente@gmail.com>
+ */
+
+#ifndef TL_MULTITEMPLATEMATCHER_H
+#define TL_MULTITEMPLATEMATCHER_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "common.h"
+#include "tl_util/integralimages.h"
+
+namespace tl {
+
+enum TemplateMatchingMode {
+  TL_MATCH_AUTO,      //!< Cheapest of the two below for each template size.
+  TL_MATCH_SPATIAL,   //!< Correlation computed tile by tile on the frame.
+  TL_MATCH_FFT        //!< Correlation computed from the frame spectrum.
+};
+
+/*!
+ * \brief Best window of a template.
+ */
+struct TemplateMatch {
+  //--------------------------- Constructor --------------------------
+  TemplateMatch();
+
+  //----------------------------- Members ----------------------------
+  cv::Point location;   //!< Top-left corner of the best window.
+  double score;         //!< Its comparison result.
+};
+
+/*!
+ * \brief Match many templates, each in its own search region, against the
+ * same frame.
+ *
+ * Templates are grouped by size. In spatial mode, each group makes a single
+ * pass over the frame by tiles small enough to stay in cache, matching all
+ * its templates searching a tile before moving to the next one. In FFT mode,
+ * the spectrum of the frame is computed once for all templates, and the
+ * spectrum of each template once for all frames.
+ *
+ * Results are the same as matching each template with `cv::matchTemplate()`
+ * on its search region, up to ties and rounding, so that several
+ * TemplateMatchingDetector's tracking objects in the same stream can be run as
+ * one batch:
+ * \code
+ *   matcher.AddTemplate(detector->template_image(), detector->opencv_method());
+ *   ...
+ *   matcher.Match(frame, &matches);
+ *   detector->set_state(matches[i].location);
+ * \endcode
+ */
+class MultiTemplateMatcher {
+public:
+  //--------------------------- Constructor --------------------------
+  MultiTemplateMatcher();
+
+  //------------------------ Public accessors ------------------------
+  /*!
+   * \brief Add a template.
+   * \param templ Template, of the type of the frames. Not copied: it must be
+   * left unchanged while it is matched.
+   * \param method OpenCV comparison method (CV_TM_*).
+   * \param search_region Windows where to search the template, or an empty
+   * rect for the whole frame. It is clipped to the frame and grown to hold the
+   * template if needed.
+   * \return Index of the template.
+   */
+  int AddTemplate(const cv::Mat &templ, int method,
+                  cv::Rect search_region = cv::Rect());
+
+  void set_search_region(int index, cv::Rect search_region);
+  void set_mode(TemplateMatchingMode mode);
+  int size() const;
+
+  /*!
+   * \brief Remove all templates.
+   */
+  void Clear();
+
+  //------------------------- Main functions -------------------------
+  /*!
+   * \brief Find the best window of every template in a frame.
+   * \param frame Frame, at least as large as the templates.
+   * \param matches Best window of each template, by index.
+   */
+  void Match(const cv::Mat &frame, std::vector<TemplateMatch> *matches);
+
+  /*!
+   * \brief Find the best window of every template in a frame.
+   * \param integral_images Integral images of the frame, e.g. shared with
+   * detectors.
+   * \param matches Best window of each template, by index.
+   */
+  void Match(const IntegralImages &integral_images,
+             std::vector<TemplateMatch> *matches);
+
+private:
+  //---------------------- Internal structures -----------------------
+  struct Entry {
+    Entry(const cv::Mat &entry_templ, int entry_method,
+          cv::Rect entry_search_region);
+
+    cv::Mat templ;                      //!< Template.
+    int method;                         //!< Comparison method (CV_TM_*).
+    cv::Rect search_region;             //!< Search region, empty for all.
+    std::vector<cv::Mat> spectra;       //!< DFT of each channel of the
+                                        //!< padded template.
+  };
+
+  //------------------------- Private methods ------------------------
+  /*!
+   * \brief Match a group of templates of the same size tile by tile.
+   */
+  void MatchSpatial(const IntegralImages &integral_images,
+                    const std::vector<int> &group,
+                    std::vector<TemplateMatch> *matches) const;
+
+  /*!
+   * \brief Match a group of templates of the same size with the spectrum of
+   * the frame, computed on first call for each frame.
+   */
+  void MatchFft(const IntegralImages &integral_images,
+                const std::vector<int> &group,
+                std::vector<TemplateMatch> *matches);
+
+  /*!
+   * \brief Whether the FFT is cheaper than the spatial correlation for a group.
+   */
+  bool PreferFft(const std::vector<int> &group, cv::Size frame_size) const;
+
+  /*!
+   * \brief Keep the best of the comparison results of an entry on a block of
+   * windows.
+   * \param offset Top-left corner of the first window of the block.
+   */
+  void KeepBest(const Entry &entry, const cv::Mat &scores, cv::Point offset,
+                TemplateMatch *match) const;
+
+  //------------------------- Private members ------------------------
+  std::vector<Entry> entries_;          //!< Templates by index.
+  TemplateMatchingMode mode_;           //!< Mode [def. TL_MATCH_AUTO].
+
+  cv::Size dft_size_;                   //!< Size of the spectra.
+  std::vector<cv::Mat> frame_spectra_;  //!< DFT of each channel of the padded
+                                        //!< current frame, empty if not
+                                        //!< computed yet.
+
+  DISALLOW_COPY_AND_ASSIGN(MultiTemplateMatcher);
+};
+
+}  // namespace tl
+
+#endif  // TL_MULTITEMPLATEMATCHER_H
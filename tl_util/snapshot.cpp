@@ -0,0 +1,120 @@
+#include "tl_util/snapshot.h"
+
+#include <cstring>
+
+using namespace cv;
+
+namespace tl {
+
+//----------------------------- Writer -----------------------------
+SnapshotWriter::SnapshotWriter() :
+  data_() {}
+
+void SnapshotWriter::WriteInt(int value) {
+  WriteBytes(&value, sizeof(value));
+}
+
+void SnapshotWriter::WriteFloat(float value) {
+  WriteBytes(&value, sizeof(value));
+}
+
+void SnapshotWriter::WriteDouble(double value) {
+  WriteBytes(&value, sizeof(value));
+}
+
+void SnapshotWriter::WriteRect(const cv::Rect &rect) {
+  WriteInt(rect.x);
+  WriteInt(rect.y);
+  WriteInt(rect.width);
+  WriteInt(rect.height);
+}
+
+void SnapshotWriter::WriteMat(const cv::Mat &mat) {
+  CHECK_MSG(mat.dims <= 2, "only 2D matrices can be written");
+  WriteInt(mat.type());
+  WriteInt(mat.rows);
+  WriteInt(mat.cols);
+  size_t row_size = mat.cols * mat.elemSize();
+  for (int i = 0; i < mat.rows; ++i) {
+    WriteBytes(mat.ptr(i), row_size);
+  }
+}
+
+void SnapshotWriter::WriteBytes(const void *bytes, size_t size) {
+  data_.append(static_cast<const char *>(bytes), size);
+}
+
+const std::string &SnapshotWriter::data() const {
+  return data_;
+}
+
+//----------------------------- Reader -----------------------------
+SnapshotReader::SnapshotReader(const std::string &data) :
+  data_(data),
+  pos_(0),
+  ok_(true) {}
+
+bool SnapshotReader::ReadInt(int *value) {
+  return ReadBytes(value, sizeof(*value));
+}
+
+bool SnapshotReader::ReadFloat(float *value) {
+  return ReadBytes(value, sizeof(*value));
+}
+
+bool SnapshotReader::ReadDouble(double *value) {
+  return ReadBytes(value, sizeof(*value));
+}
+
+bool SnapshotReader::ReadRect(cv::Rect *rect) {
+  int values[4];
+  if (!ReadBytes(values, sizeof(values))) return false;
+  *rect = Rect(values[0], values[1], values[2], values[3]);
+  return true;
+}
+
+bool SnapshotReader::ReadMat(cv::Mat *mat) {
+  int type = 0;
+  int rows = 0;
+  int cols = 0;
+  if (!ReadInt(&type) || !ReadInt(&rows) || !ReadInt(&cols)) return false;
+  if (rows < 0 || cols < 0 || CV_MAT_DEPTH(type) == CV_USRTYPE1 ||
+      (type & ~CV_MAT_TYPE_MASK) != 0) {
+    ok_ = false;
+    return false;
+  }
+
+  // Divide rather than multiply, which could wrap around for hostile sizes.
+  size_t elem_size = CV_ELEM_SIZE(type);
+  size_t max_elements = (data_.size() - pos_) / elem_size;
+  if (cols > 0 &&
+      static_cast<size_t>(rows) > max_elements / static_cast<size_t>(cols)) {
+    ok_ = false;
+    return false;
+  }
+  size_t size = static_cast<size_t>(rows) * cols * elem_size;
+  Mat result(rows, cols, type);
+  if (size > 0 && !ReadBytes(result.data, size)) return false;
+  *mat = result;
+  return true;
+}
+
+bool SnapshotReader::ReadBytes(void *bytes, size_t size) {
+  if (!ok_ || size > data_.size() - pos_) {
+    ok_ = false;
+    return false;
+  }
+  memcpy(bytes, data_.data() + pos_, size);
+  pos_ += size;
+  return true;
+}
+
+bool SnapshotReader::ok() const {
+  return ok_;
+}
+
+bool SnapshotReader::AtEnd() const {
+  return pos_ == data_.size();
+}
+
+}  // namespace tl
@@ -0,0 +1,96 @@
+/*!
+ * \file snapshot.h
+ * \brief Compact binary serialization of the internal state of trackers.
+ * \author Joachim Valente <joachim.valente@gmail.com>
+ */
+
+#ifndef TL_SNAPSHOT_H
+#define TL_SNAPSHOT_H
+
+#include <cstddef>
+#include <string>
+
+#include <opencv2/core/core.hpp>
+
+#include "common.h"
+
+namespace tl {
+
+/*!
+ * \brief Append values to a binary snapshot.
+ *
+ * Values are written in host byte order without padding, so snapshots are
+ * meant to be restored on the same kind of machine. Matrices are written
+ * with their exact bytes so that a restored tracker gives identical results.
+ */
+class SnapshotWriter {
+public:
+  //--------------------------- Constructor --------------------------
+  SnapshotWriter();
+
+  //----------------------------- Writing ----------------------------
+  void WriteInt(int value);
+  void WriteFloat(float value);
+  void WriteDouble(double value);
+  void WriteRect(const cv::Rect &rect);
+
+  /*!
+   * \brief Write a matrix of at most 2 dimensions (type, size and data).
+   */
+  void WriteMat(const cv::Mat &mat);
+
+  void WriteBytes(const void *bytes, size_t size);
+
+  //------------------------- Public accessors -----------------------
+  const std::string &data() const;
+
+private:
+  std::string data_;                  //!< Bytes written so far.
+
+  DISALLOW_COPY_AND_ASSIGN(SnapshotWriter);
+};
+
+/*!
+ * \brief Read values from a binary snapshot, in the order they were written.
+ *
+ * All functions return false, and leave the output unchanged, if the snapshot
+ * is too short or malformed. Once a read failed, all subsequent reads fail.
+ */
+class SnapshotReader {
+public:
+  //--------------------------- Constructor --------------------------
+  /*!
+   * \param data Snapshot. Must outlive the reader.
+   */
+  explicit SnapshotReader(const std::string &data);
+
+  //----------------------------- Reading ----------------------------
+  bool ReadInt(int *value);
+  bool ReadFloat(float *value);
+  bool ReadDouble(double *value);
+  bool ReadRect(cv::Rect *rect);
+  bool ReadMat(cv::Mat *mat);
+  bool ReadBytes(void *bytes, size_t size);
+
+  //------------------------- Public accessors -----------------------
+  /*!
+   * \brief Whether all reads so far succeeded.
+   */
+  bool ok() const;
+
+  /*!
+   * \brief Whether the whole snapshot was read.
+   */
+  bool AtEnd() const;
+
+private:
+  const std::string &data_;           //!< Snapshot.
+  size_t pos_;                        //!< Position of the next read.
+  bool ok_;                           //!< Whether all reads succeeded.
+
+  DISALLOW_COPY_AND_ASSIGN(SnapshotReader);
+};
+
+}  // namespace tl
+
+#endif  // TL_SNAPSHOT_H
@@ -0,0 +1,247 @@
+#include "tl_util/spatialindex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <utility>
+
+using namespace cv;
+
+namespace tl {
+
+namespace {
+
+// Division rounded towards minus infinity, for cells left of or above 0.
+int FloorDiv(int a, int b) {
+  int quotient = a / b;
+  if (a % b != 0 && a < 0) --quotient;
+  return quotient;
+}
+
+}  // namespace
+
+//--------------------------- Constructor --------------------------
+SpatialIndex::SpatialIndex(int cell_size) :
+  cell_size_(cell_size),
+  rects_(),
+  cells_(),
+  free_ids_(),
+  size_(0),
+  bounds_(),
+  grid_() {
+  CHECK(cell_size >= 1);
+}
+
+//------------------------ Public accessors ------------------------
+int SpatialIndex::Insert(cv::Rect rect) {
+  int id = static_cast<int>(rects_.size());
+  if (!free_ids_.empty()) {
+    std::pop_heap(free_ids_.begin(), free_ids_.end(), std::greater<int>());
+    id = free_ids_.back();
+    free_ids_.pop_back();
+  } else {
+    rects_.push_back(Rect());
+    cells_.push_back(Rect());
+  }
+
+  rects_[id] = rect;
+  cells_[id] = CellRange(rect);
+  AddToCells(id, cells_[id]);
+  ++size_;
+  return id;
+}
+
+void SpatialIndex::Update(int id, cv::Rect rect) {
+  CHECK(contains(id));
+  rects_[id] = rect;
+  Rect cells = CellRange(rect);
+  if (cells == cells_[id]) return;
+
+  RemoveFromCells(id, cells_[id]);
+  cells_[id] = cells;
+  AddToCells(id, cells);
+}
+
+void SpatialIndex::Remove(int id) {
+  CHECK(contains(id));
+  RemoveFromCells(id, cells_[id]);
+  cells_[id] = Rect();
+  free_ids_.push_back(id);
+  std::push_heap(free_ids_.begin(), free_ids_.end(), std::greater<int>());
+  --size_;
+}
+
+void SpatialIndex::Reset(int cell_size) {
+  CHECK(cell_size >= 1);
+  cell_size_ = cell_size;
+  rects_.clear();
+  cells_.clear();
+  free_ids_.clear();
+  size_ = 0;
+  bounds_ = Rect();
+  grid_.clear();
+}
+
+cv::Rect SpatialIndex::rect(int id) const {
+  CHECK(contains(id));
+  return rects_[id];
+}
+
+bool SpatialIndex::contains(int id) const {
+  return 0 <= id && id < static_cast<int>(cells_.size()) &&
+         cells_[id].area() > 0;
+}
+
+int SpatialIndex::cell_size() const {
+  return cell_size_;
+}
+
+int SpatialIndex::size() const {
+  return size_;
+}
+
+//-------------------------- Queries -------------------------------
+void SpatialIndex::Intersecting(cv::Rect query, std::vector<int> *ids) const {
+  CHECK_NOTNULL(ids);
+  ids->clear();
+  if (query.area() <= 0 || size_ == 0) return;
+
+  Rect range = CellRange(query) & bounds_;
+  for (int y = range.y; y < range.y + range.height; ++y) {
+    for (int x = range.x; x < range.x + range.width; ++x) {
+      auto cell = grid_.find(Key(x, y));
+      if (cell == grid_.end()) continue;
+      for (int id : cell->second) {
+        // A rect spanning several cells is reported in the first of them
+        // visited only.
+        const Rect &cells = cells_[id];
+        if (x != std::max(cells.x, range.x) ||
+            y != std::max(cells.y, range.y)) {
+          continue;
+        }
+        if ((rects_[id] & query).area() > 0) ids->push_back(id);
+      }
+    }
+  }
+}
+
+void SpatialIndex::Nearest(cv::Point2d point, int k,
+                           std::vector<int> *ids) const {
+  CHECK_NOTNULL(ids);
+  ids->clear();
+  if (k <= 0 || size_ == 0) return;
+  k = std::min(k, size_);
+
+  int px = static_cast<int>(std::floor(point.x / cell_size_));
+  int py = static_cast<int>(std::floor(point.y / cell_size_));
+  int max_ring = std::max(
+      std::max(px - bounds_.x, bounds_.x + bounds_.width - 1 - px),
+      std::max(py - bounds_.y, bounds_.y + bounds_.height - 1 - py));
+
+  std::vector<std::pair<double, int> > nearest;   // Max-heap of k best.
+  auto consider = [&](int id) {
+    const Rect &rect = rects_[id];
+    double dx = rect.x + 0.5 * rect.width - point.x;
+    double dy = rect.y + 0.5 * rect.height - point.y;
+    std::pair<double, int> candidate(dx * dx + dy * dy, id);
+    if (static_cast<int>(nearest.size()) < k) {
+      nearest.push_back(candidate);
+      std::push_heap(nearest.begin(), nearest.end());
+    } else if (candidate < nearest.front()) {
+      std::pop_heap(nearest.begin(), nearest.end());
+      nearest.back() = candidate;
+      std::push_heap(nearest.begin(), nearest.end());
+    }
+  };
+
+  // Rings of cells around the point, each rect being visited in the cell of
+  // its center. Cells of ring r + 1 are at least r cells away from the point.
+  int nb_seen = 0;
+  for (int ring = 0; ring <= std::max(max_ring, 0); ++ring) {
+    if (8 * ring > size_) {
+      // Rings now cost more than the rects left, e.g. far outliers: check
+      // those directly.
+      for (int id = 0; id < static_cast<int>(rects_.size()); ++id) {
+        if (!contains(id)) continue;
+        const Rect &rect = rects_[id];
+        int x = FloorDiv(rect.x + rect.width / 2, cell_size_);
+        int y = FloorDiv(rect.y + rect.height / 2, cell_size_);
+        if (std::max(std::abs(x - px), std::abs(y - py)) >= ring)
+          consider(id);
+      }
+      break;
+    }
+
+    for (int y = py - ring; y <= py + ring; ++y) {
+      bool edge = (y == py - ring || y == py + ring);
+      for (int x = px - ring; x <= px + ring;
+           x += edge ? 1 : 2 * ring) {
+        if (!bounds_.contains(Point(x, y))) continue;
+        auto cell = grid_.find(Key(x, y));
+        if (cell == grid_.end()) continue;
+        for (int id : cell->second) {
+          const Rect &rect = rects_[id];
+          if (FloorDiv(rect.x + rect.width / 2, cell_size_) != x ||
+              FloorDiv(rect.y + rect.height / 2, cell_size_) != y) {
+            continue;
+          }
+          ++nb_seen;
+          consider(id);
+        }
+      }
+    }
+
+    // Stop once no farther rect can be nearer, or all were seen.
+    double reach = static_cast<double>(ring) * cell_size_;
+    if (nb_seen == size_ || (static_cast<int>(nearest.size()) == k &&
+                             nearest.front().first <= reach * reach)) {
+      break;
+    }
+  }
+
+  std::sort_heap(nearest.begin(), nearest.end());
+  for (const std::pair<double, int> &neighbor : nearest) {
+    ids->push_back(neighbor.second);
+  }
+}
+
+//------------------------- Private methods ------------------------
+cv::Rect SpatialIndex::CellRange(cv::Rect rect) const {
+  int x0 = FloorDiv(rect.x, cell_size_);
+  int y0 = FloorDiv(rect.y, cell_size_);
+  int x1 = FloorDiv(rect.x + std::max(rect.width, 1) - 1, cell_size_);
+  int y1 = FloorDiv(rect.y + std::max(rect.height, 1) - 1, cell_size_);
+  return Rect(x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+}
+
+std::uint64_t SpatialIndex::Key(int x, int y) {
+  return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(y)) << 32) |
+         static_cast<std::uint32_t>(x);
+}
+
+void SpatialIndex::AddToCells(int id, cv::Rect cells) {
+  for (int y = cells.y; y < cells.y + cells.height; ++y) {
+    for (int x = cells.x; x < cells.x + cells.width; ++x) {
+      grid_[Key(x, y)].push_back(id);
+    }
+  }
+  bounds_ = (bounds_.area() > 0) ? (bounds_ | cells) : cells;
+}
+
+void SpatialIndex::RemoveFromCells(int id, cv::Rect cells) {
+  for (int y = cells.y; y < cells.y + cells.height; ++y) {
+    for (int x = cells.x; x < cells.x + cells.width; ++x) {
+      auto cell = grid_.find(Key(x, y));
+      CHECK(cell != grid_.end());
+      std::vector<int> &ids = cell->second;
+      auto position = std::find(ids.begin(), ids.end(), id);
+      CHECK(position != ids.end());
+      *position = ids.back();
+      ids.pop_back();
+      if (ids.empty()) grid_.erase(cell);
+    }
+  }
+}
+
+}  // namespace tl
@@ -0,0 +1,114 @@
+/*!
+ * \file spatialindex.h
+ * \brief Index of moving rects for intersection and nearest-neighbor queries.
+ * \author Joachim Valente <joachim.valente@gmail.com>
+ */
+
+#ifndef TL_SPATIALINDEX_H
+#define TL_SPATIALINDEX_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "common.h"
+
+namespace tl {
+
+/*!
+ * \brief Uniform grid over rects (e.g. the states of many trackers), updated
+ * as they move.
+ *
+ * Rects are stored contiguously by id, and each cell of the grid lists the
+ * ids of the rects overlapping it. Only non-empty cells are allocated, so the
+ * grid is unbounded. Moving a rect only touches the grid when the range of
+ * cells it overlaps changes, which is rare for a tracked object between two
+ * frames if cells are a few times larger than the motion.
+ *
+ * Queries cost the number of cells they overlap plus the number of rects
+ * listed there, instead of the number of rects. Cells about the size of the
+ * rects are a good choice.
+ */
+class SpatialIndex {
+public:
+  //--------------------------- Constructor --------------------------
+  /*!
+   * \param cell_size Side of the cells of the grid, in pixels.
+   */
+  explicit SpatialIndex(int cell_size = 64);
+
+  //------------------------ Public accessors ------------------------
+  /*!
+   * \brief Add a rect.
+   * \return Its id, the smallest one not in use.
+   */
+  int Insert(cv::Rect rect);
+
+  /*!
+   * \brief Move a rect.
+   */
+  void Update(int id, cv::Rect rect);
+
+  /*!
+   * \brief Remove a rect. Its id may be given to the next inserted one.
+   */
+  void Remove(int id);
+
+  /*!
+   * \brief Remove all rects, and set the side of the cells.
+   */
+  void Reset(int cell_size);
+
+  cv::Rect rect(int id) const;
+  bool contains(int id) const;
+  int cell_size() const;
+
+  /*!
+   * \brief Number of rects.
+   */
+  int size() const;
+
+  //-------------------------- Queries -------------------------------
+  /*!
+   * \brief Ids of the rects intersecting a rect, in no particular order.
+   */
+  void Intersecting(cv::Rect query, std::vector<int> *ids) const;
+
+  /*!
+   * \brief Ids of the k rects whose centers are the nearest to a point, from
+   * the nearest (fewer if there are fewer rects).
+   */
+  void Nearest(cv::Point2d point, int k, std::vector<int> *ids) const;
+
+private:
+  //------------------------- Private methods ------------------------
+  /*!
+   * \brief Cells overlapped by a rect, as a rect of cell coordinates.
+   */
+  cv::Rect CellRange(cv::Rect rect) const;
+
+  static std::uint64_t Key(int x, int y);
+
+  void AddToCells(int id, cv::Rect cells);
+  void RemoveFromCells(int id, cv::Rect cells);
+
+  //------------------------- Private members ------------------------
+  int cell_size_;                       //!< Side of the cells.
+  std::vector<cv::Rect> rects_;         //!< Rects by id.
+  std::vector<cv::Rect> cells_;         //!< Cell range of each rect, empty
+                                        //!< for ids not in use.
+  std::vector<int> free_ids_;           //!< Ids not in use (min-heap).
+  int size_;                            //!< Number of rects.
+  cv::Rect bounds_;                     //!< Cells ever used (nearest-neighbor
+                                        //!< queries stop beyond).
+  std::unordered_map<std::uint64_t, std::vector<int> > grid_;
+                                        //!< Ids of the rects in each cell.
+
+  DISALLOW_COPY_AND_ASSIGN(SpatialIndex);
+};
+
+}  // namespace tl
+
+#endif  // TL_SPATIALINDEX_H
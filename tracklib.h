@@ -17,18 +17,40 @@
 #include "tl_core/backgroundsubtractor.h"
 #include "tl_core/detector.h"
 #include "tl_core/filter.h"
+#include "tl_core/framecontext.h"
 #include "tl_core/tracker.h"
+#include "tl_util/matpool.h"
 
 //----------------------- Detectors ---------------------
 #include "tl_detectors/meanshiftdetector.h"
 #include "tl_detectors/nodetector.h"
 #include "tl_detectors/templatematchingdetector.h"
 
+//------------------------ Matching ---------------------
+#include "tl_util/multitemplatematcher.h"
+
 //------------------------ Filters ----------------------
+#include "tl_filters/constantvelocityfilter.h"
 #include "tl_filters/kalmanfilter.h"
 
+//------------------ Multi-object tracking --------------
+#include "tl_trackers/dataassociation.h"
+#include "tl_util/spatialindex.h"
+
 //----------------- Background Subtractors --------------
 #include "tl_backgroundsubtractors/onlinebackgroundsubtractor.h"
+#include "tl_util/bitmask.h"
+#include "tl_util/blobextractor.h"
+
+//----------------------- Evaluation --------------------
+#include "tl_evaluation/evaluation.h"
+
+//------------------------- Batch -----------------------
+#include "tl_batch/batchjob.h"
+#include "tl_batch/batchrunner.h"
+#include "tl_batch/sweep.h"
+#include "tl_util/framecache.h"
+#include "tl_util/framering.h"
 
 //-------------------------- Gpu ------------------------
 #ifdef TL_CUDA